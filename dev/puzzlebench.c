@@ -0,0 +1,851 @@
+/*
+ * puzzlebench.c: headless benchmark driver for the puzzle backends.
+ *
+ * Walks every game and every preset in its preset menu, generates a
+ * fixed number of puzzles per preset from fixed seeds, runs the
+ * game's own solver on each one, and reports generation and solve
+ * timings plus allocation counts as CSV or JSON. Since the seeds are
+ * fixed, two runs of the same tree generate the same puzzles, which
+ * makes this usable as a before/after check for performance work.
+ *
+ * Usage: puzzlebench [options] [game...]
+ *        puzzlebench [options] --generate <game> <params>
+ *
+ *   -n <count>     puzzles per preset (default 5)
+ *   -s <seed>      base seed string (default "puzzlebench")
+ *   -j <threads>   worker threads for --generate (default 1)
+ *   --json         JSON output instead of CSV
+ *   --no-solve     only time generation
+ *   --list         list the available game names and exit
+ *   --draw         count drawing calls per redraw instead
+ *   --replay       time loading a save file with a long undo chain
+ *
+ * Game names are matched case-insensitively; with none given, all
+ * games are benchmarked.
+ *
+ * The --generate form is for bulk export: it generates <count>
+ * puzzles with the given parameters using batch_generate(), and
+ * prints one line per puzzle as it completes, giving the seed index,
+ * the seed-based game ID and the description-based game ID. The
+ * puzzles are the same whatever -j is set to; only the order of the
+ * lines differs.
+ *
+ * With --draw, each game's default puzzle is instead laid out on a
+ * canvas the size of an e-reader screen and redrawn twice through a
+ * counting drawing API; the second redraw is counted, so that tiles
+ * cached by draw_cached_tile() during the first are blitted. Besides
+ * the number of drawing requests of each kind, it reports how many
+ * InkView calls the frontend would make for them: 'rowwise' is one
+ * call per pixel row for rectangles, polygons and circles as the
+ * frontend used to do, 'batched' is the current frontend with
+ * FillArea blocks. Polygon fills are counted at one call per row in
+ * both, so the batched figure is an upper bound. A blit is one call.
+ *
+ * With --replay, each game's default puzzle is played with random
+ * taps, long presses and presses of the game's own keys until its undo chain holds
+ * REPLAY_MOVES moves (or until the taps run out, for games where most
+ * taps do nothing), and saved. Reported is the size of the save file
+ * and how long it takes to load it into a fresh midend, which replays
+ * every move in it; the load is repeated <count> times.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "puzzles.h"
+
+extern const game abcd, ascent, binary, blackbox, boats, bricks, bridges,
+                  clusters, crossnum, cube, dominosa, fifteen, filling,
+                  flip, flood, flow, galaxies, guess, inertia, keen,
+                  lightup, loopy, magnets, map, mathrax, mines, mosaic,
+                  net, palisade, pattern, pearl, pegs, range, rect, rome,
+                  salad, samegame, signpost, singles, sixteen, slant,
+                  solo, spokes, sticks, tents, towers, tracks, twiddle,
+                  undead, unequal, unruly, untangle, walls;
+
+const game *gamelist[] = {
+    &abcd, &ascent, &binary, &blackbox, &boats, &bricks, &bridges,
+    &clusters, &crossnum, &cube, &dominosa, &fifteen, &filling,
+    &flip, &flood, &flow, &galaxies, &guess, &inertia, &keen,
+    &lightup, &loopy, &magnets, &map, &mathrax, &mines, &mosaic,
+    &net, &palisade, &pattern, &pearl, &pegs, &range, &rect, &rome,
+    &salad, &samegame, &signpost, &singles, &sixteen, &slant,
+    &solo, &spokes, &sticks, &tents, &towers, &tracks, &twiddle,
+    &undead, &unequal, &unruly, &untangle, &walls,
+};
+const int gamecount = lenof(gamelist);
+
+/* ----------------------------------------------------------------------
+ * Frontend stubs. There is no frontend, and nothing here ever
+ * reaches a screen, so these are never expected to do anything much.
+ */
+
+void fatal(const char *fmt, ...)
+{
+    fprintf(stderr, "puzzlebench: fatal error: %s\n", fmt);
+    exit(1);
+}
+
+void frontend_default_colour(frontend *fe, float *output)
+{
+    output[0] = output[1] = output[2] = 0.9F;
+}
+
+void activate_timer(frontend *fe) { }
+void deactivate_timer(frontend *fe) { }
+
+void get_random_seed(void **randseed, int *randseedsize)
+{
+    struct timeval *tvp = snew(struct timeval);
+    gettimeofday(tvp, NULL);
+    *randseed = (void *)tvp;
+    *randseedsize = sizeof(struct timeval);
+}
+
+/* ---------------------------------------------------------------------- */
+
+struct options {
+    int count;
+    const char *seed;
+    int threads;
+    bool json;
+    bool solve;
+    bool draw;
+    bool replay;
+};
+
+struct sample {
+    double gen_ms, solve_ms;
+    unsigned long gen_allocs, solve_allocs;
+    bool solved;
+};
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static long peak_rss_kb(void)
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru))
+        return -1;
+    return ru.ru_maxrss;
+}
+
+static int compare_doubles(const void *av, const void *bv)
+{
+    double a = *(const double *)av, b = *(const double *)bv;
+    return a < b ? -1 : a > b ? +1 : 0;
+}
+
+struct stats {
+    double min, median, p95, max;
+};
+
+static struct stats summarise(double *vals, int n)
+{
+    struct stats st;
+    int p95;
+
+    qsort(vals, n, sizeof(double), compare_doubles);
+    st.min = vals[0];
+    st.max = vals[n-1];
+    st.median = (n % 2 ? vals[n/2] : (vals[n/2-1] + vals[n/2]) / 2);
+    p95 = (95 * n + 99) / 100 - 1;     /* nearest-rank percentile */
+    st.p95 = vals[p95 < 0 ? 0 : p95];
+    return st;
+}
+
+/*
+ * Print a string as a CSV or JSON field, quoting as necessary. Preset
+ * titles and parameter strings are plain ASCII, so we only have to
+ * worry about the quote character itself.
+ */
+static void print_quoted(const char *s, bool json)
+{
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"')
+            fputs(json ? "\\\"" : "\"\"", stdout);
+        else if (json && *s == '\\')
+            fputs("\\\\", stdout);
+        else
+            putchar(*s);
+    }
+    putchar('"');
+}
+
+static bool first_record = true;
+
+static void print_header(const struct options *opts)
+{
+    if (opts->json)
+        printf("[\n");
+    else if (opts->draw)
+        printf("game,width,height,text,rect,line,polygon,circle,blit,"
+               "rowwise_calls,batched_calls\n");
+    else if (opts->replay)
+        printf("game,moves,save_bytes,load_min_ms,load_median_ms,"
+               "load_p95_ms,load_max_ms,load_failures,peak_rss_kb\n");
+    else
+        printf("game,preset,params,count,"
+               "gen_min_ms,gen_median_ms,gen_p95_ms,gen_max_ms,"
+               "solve_min_ms,solve_median_ms,solve_p95_ms,solve_max_ms,"
+               "solve_failures,gen_allocs,solve_allocs,peak_rss_kb\n");
+}
+
+static void print_footer(const struct options *opts)
+{
+    if (opts->json)
+        printf("\n]\n");
+}
+
+static void print_record(const struct options *opts, const game *g,
+                         const char *title, const char *paramstr,
+                         struct sample *samples, int n)
+{
+    double *vals = snewn(n, double);
+    struct stats gen, solve;
+    unsigned long gen_allocs = 0, solve_allocs = 0;
+    int i, failures = 0;
+
+    for (i = 0; i < n; i++) {
+        vals[i] = samples[i].gen_ms;
+        gen_allocs += samples[i].gen_allocs;
+        solve_allocs += samples[i].solve_allocs;
+        if (!samples[i].solved)
+            failures++;
+    }
+    gen = summarise(vals, n);
+    for (i = 0; i < n; i++)
+        vals[i] = samples[i].solve_ms;
+    solve = summarise(vals, n);
+    sfree(vals);
+
+    if (opts->json) {
+        printf("%s  {\"game\": ", first_record ? "" : ",\n");
+        print_quoted(g->name, true);
+        printf(", \"preset\": ");
+        print_quoted(title, true);
+        printf(", \"params\": ");
+        print_quoted(paramstr, true);
+        printf(", \"count\": %d,\n"
+               "   \"gen_ms\": {\"min\": %.3f, \"median\": %.3f,"
+               " \"p95\": %.3f, \"max\": %.3f},\n"
+               "   \"solve_ms\": {\"min\": %.3f, \"median\": %.3f,"
+               " \"p95\": %.3f, \"max\": %.3f},\n"
+               "   \"solve_failures\": %d, \"gen_allocs\": %lu,"
+               " \"solve_allocs\": %lu, \"peak_rss_kb\": %ld}",
+               n, gen.min, gen.median, gen.p95, gen.max,
+               solve.min, solve.median, solve.p95, solve.max,
+               failures, gen_allocs / n, solve_allocs / n, peak_rss_kb());
+    } else {
+        print_quoted(g->name, false);
+        putchar(',');
+        print_quoted(title, false);
+        putchar(',');
+        print_quoted(paramstr, false);
+        printf(",%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%lu,%lu,%ld\n",
+               n, gen.min, gen.median, gen.p95, gen.max,
+               solve.min, solve.median, solve.p95, solve.max,
+               failures, gen_allocs / n, solve_allocs / n, peak_rss_kb());
+    }
+    fflush(stdout);
+    first_record = false;
+}
+
+/*
+ * Solve one generated puzzle from scratch, i.e. without the aux
+ * string, so that we time the real solver rather than the shortcut
+ * most games take when they already know the answer.
+ */
+static void solve_one(midend *me, const game *g, const game_params *params,
+                      const char *desc, struct sample *smp)
+{
+    game_state *state;
+    const char *err = NULL;
+    char *move;
+    unsigned long allocs;
+    double t;
+
+    state = g->new_game(me, params, desc);
+    allocs = smalloc_count();
+    t = now_ms();
+    move = g->solve(state, state, NULL, &err);
+    smp->solve_ms = now_ms() - t;
+    smp->solve_allocs = smalloc_count() - allocs;
+    smp->solved = (move != NULL);
+    sfree(move);
+    g->free_game(state);
+}
+
+static char *bench_seed(const struct options *opts, int i)
+{
+    char *seed = snewn(strlen(opts->seed) + MAX_DIGITS(int) + 2, char);
+    sprintf(seed, "%s-%d", opts->seed, i);
+    return seed;
+}
+
+static void bench_serial(const struct options *opts, midend *me,
+                         const game *g, const game_params *params,
+                         struct sample *samples)
+{
+    int i;
+
+    for (i = 0; i < opts->count; i++) {
+        struct sample *smp = &samples[i];
+        char *seed = bench_seed(opts, i);
+        random_state *rs = random_new(seed, strlen(seed));
+        char *aux = NULL, *desc;
+        unsigned long allocs;
+        double t;
+
+        allocs = smalloc_count();
+        t = now_ms();
+        desc = g->new_desc(params, rs, &aux, false);
+        smp->gen_ms = now_ms() - t;
+        smp->gen_allocs = smalloc_count() - allocs;
+
+        smp->solve_ms = 0.0;
+        smp->solve_allocs = 0;
+        smp->solved = true;
+        if (opts->solve && g->can_solve)
+            solve_one(me, g, params, desc, smp);
+
+        sfree(desc);
+        sfree(aux);
+        random_free(rs);
+        sfree(seed);
+    }
+}
+
+static void bench_preset(const struct options *opts, midend *me,
+                         const game *g, const char *title,
+                         const game_params *params)
+{
+    struct sample *samples = snewn(opts->count, struct sample);
+    char *paramstr = g->encode_params(params, true);
+
+    bench_serial(opts, me, g, params, samples);
+    print_record(opts, g, title, paramstr, samples, opts->count);
+
+    sfree(paramstr);
+    sfree(samples);
+}
+
+static void bench_menu(const struct options *opts, midend *me, const game *g,
+                       struct preset_menu *menu, const char *prefix)
+{
+    int i;
+
+    for (i = 0; i < menu->n_entries; i++) {
+        struct preset_menu_entry *e = &menu->entries[i];
+        char *title = snewn(strlen(prefix) + strlen(e->title) + 4, char);
+
+        sprintf(title, "%s%s%s", prefix, *prefix ? " / " : "", e->title);
+        if (e->params)
+            bench_preset(opts, me, g, title, e->params);
+        else
+            bench_menu(opts, me, g, e->submenu, title);
+        sfree(title);
+    }
+}
+
+static void bench_game(const struct options *opts, const game *g)
+{
+    midend *me = midend_new(NULL, g, NULL, NULL);
+    struct preset_menu *menu = midend_get_presets(me, NULL);
+
+    if (menu->n_entries > 0) {
+        bench_menu(opts, me, g, menu, "");
+    } else {
+        game_params *params = g->default_params();
+        bench_preset(opts, me, g, "Default", params);
+        g->free_params(params);
+    }
+
+    midend_free(me);
+}
+
+/* ----------------------------------------------------------------------
+ * Counting the drawing calls made by a redraw.
+ */
+
+#define DRAW_WIDTH 1072                /* PocketBook screen, less furniture */
+#define DRAW_HEIGHT 1200
+
+struct blitter {
+    int w, h;
+};
+
+struct drawcount {
+    long text, rect, line, polygon, circle, blit;
+    long rowwise, batched;
+};
+
+static void dc_text(void *handle, int x, int y, int fonttype, int fontsize,
+                    int align, int colour, const char *text)
+{
+    struct drawcount *dc = (struct drawcount *)handle;
+    dc->text++;
+    dc->rowwise++;
+    dc->batched++;
+}
+
+static void dc_rect(void *handle, int x, int y, int w, int h, int colour)
+{
+    struct drawcount *dc = (struct drawcount *)handle;
+    dc->rect++;
+    if (w > 0 && h > 0) {
+        dc->rowwise += h;
+        dc->batched++;
+    }
+}
+
+static void dc_line(void *handle, int x1, int y1, int x2, int y2, int colour)
+{
+    struct drawcount *dc = (struct drawcount *)handle;
+    dc->line++;
+    dc->rowwise++;
+    dc->batched++;
+}
+
+static void dc_polygon(void *handle, const int *coords, int npoints,
+                       int fillcolour, int outlinecolour)
+{
+    struct drawcount *dc = (struct drawcount *)handle;
+    int i, miny = coords[1], maxy = coords[1];
+
+    dc->polygon++;
+    for (i = 1; i < npoints; i++) {
+        if (miny > coords[2*i+1]) miny = coords[2*i+1];
+        if (maxy < coords[2*i+1]) maxy = coords[2*i+1];
+    }
+    dc->rowwise += npoints;
+    dc->batched += npoints;
+    if (fillcolour >= 0) {
+        dc->rowwise += maxy - miny + 1;
+        dc->batched += maxy - miny;
+    }
+}
+
+static void dc_circle(void *handle, int cx, int cy, int radius,
+                      int fillcolour, int outlinecolour)
+{
+    struct drawcount *dc = (struct drawcount *)handle;
+    int dy, x, nx;
+
+    dc->circle++;
+    dc->rowwise += 2 * (2*radius + 1);
+    dc->batched += radius > 0 ? 4 * radius : 1;
+    if (fillcolour >= 0) {
+        /* One block per band of rows sharing a half-width, mirrored
+         * about the centre except for the band containing it. */
+        dc->rowwise += 2*radius + 1;
+        dc->batched--;
+        for (x = radius, dy = 1; dy <= radius+1; dy++) {
+            int v = radius*radius - dy*dy;
+            for (nx = x; nx > 0 && nx*nx - nx >= v; nx--);
+            if (dy > radius || nx != x)
+                dc->batched += 2;
+            x = nx;
+        }
+    }
+}
+
+static void dc_nothing(void *handle) { }
+static void dc_rectop(void *handle, int x, int y, int w, int h) { }
+static void dc_status_bar(void *handle, const char *text) { }
+
+static blitter *dc_blitter_new(void *handle, int w, int h)
+{
+    blitter *bl = snew(blitter);
+    bl->w = w;
+    bl->h = h;
+    return bl;
+}
+
+static void dc_blitter_free(void *handle, blitter *bl)
+{
+    sfree(bl);
+}
+
+static void dc_blitter_save(void *handle, blitter *bl, int x, int y) { }
+
+static void dc_blitter_load(void *handle, blitter *bl, int x, int y)
+{
+    struct drawcount *dc = (struct drawcount *)handle;
+    dc->blit++;
+    dc->rowwise++;
+    dc->batched++;
+}
+
+static const struct drawing_api count_drawing = {
+    dc_text, dc_rect, dc_line, dc_polygon, dc_circle,
+    dc_rectop, dc_rectop, dc_nothing, dc_nothing, dc_nothing,
+    dc_status_bar, dc_blitter_new, dc_blitter_free,
+    dc_blitter_save, dc_blitter_load, NULL, NULL,
+};
+
+/*
+ * Start the game's default puzzle from the first bench seed. The game
+ * ID needs the parameters in front of the seed, since an empty
+ * parameter string isn't valid for every game.
+ */
+static void start_default_game(const struct options *opts, midend *me,
+                               const game *g)
+{
+    game_params *params = g->default_params();
+    char *parstr = g->encode_params(params, true);
+    char *seed = bench_seed(opts, 0), *id;
+
+    id = snewn(strlen(parstr) + strlen(seed) + 2, char);
+    sprintf(id, "%s#%s", parstr, seed);
+    midend_game_id(me, id);
+    midend_new_game(me);
+
+    sfree(id);
+    sfree(seed);
+    sfree(parstr);
+    g->free_params(params);
+}
+
+static void draw_game(const struct options *opts, const game *g)
+{
+    struct drawcount dc;
+    midend *me = midend_new(NULL, g, &count_drawing, &dc);
+    int w = DRAW_WIDTH, h = DRAW_HEIGHT;
+
+    start_default_game(opts, me, g);
+    midend_size(me, &w, &h, true, 1.0);
+
+    /* Count the second redraw, once cached tiles have been built */
+    midend_force_redraw(me);
+    memset(&dc, 0, sizeof(dc));
+    midend_force_redraw(me);
+
+    if (opts->json) {
+        printf("%s  {\"game\": ", first_record ? "" : ",\n");
+        print_quoted(g->name, true);
+        printf(", \"width\": %d, \"height\": %d, \"text\": %ld,"
+               " \"rect\": %ld, \"line\": %ld, \"polygon\": %ld,"
+               " \"circle\": %ld, \"blit\": %ld, \"rowwise_calls\": %ld,"
+               " \"batched_calls\": %ld}",
+               w, h, dc.text, dc.rect, dc.line, dc.polygon, dc.circle,
+               dc.blit, dc.rowwise, dc.batched);
+    } else {
+        print_quoted(g->name, false);
+        printf(",%d,%d,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld\n",
+               w, h, dc.text, dc.rect, dc.line, dc.polygon, dc.circle,
+               dc.blit, dc.rowwise, dc.batched);
+    }
+    fflush(stdout);
+    first_record = false;
+
+    midend_free(me);
+}
+
+/* ----------------------------------------------------------------------
+ * Timing the load of a save file with a long undo chain.
+ */
+
+#define REPLAY_MOVES 10000
+
+struct savefile {
+    char *data;
+    int len, size, pos;
+};
+
+static void save_write(void *ctx, const void *buf, int len)
+{
+    struct savefile *sf = (struct savefile *)ctx;
+
+    if (sf->len + len > sf->size) {
+        sf->size = (sf->len + len) * 5 / 4 + 1024;
+        sf->data = sresize(sf->data, sf->size, char);
+    }
+    memcpy(sf->data + sf->len, buf, len);
+    sf->len += len;
+}
+
+static bool save_read(void *ctx, void *buf, int len)
+{
+    struct savefile *sf = (struct savefile *)ctx;
+
+    if (sf->pos + len > sf->len)
+        return false;
+    memcpy(buf, sf->data + sf->pos, len);
+    sf->pos += len;
+    return true;
+}
+
+/* Save the midend's game, and return the number of moves in it. */
+static int save_game(midend *me, struct savefile *sf)
+{
+    const char *p;
+    int len;
+
+    sf->len = sf->pos = 0;
+    midend_serialise(me, save_write, sf);
+    save_write(sf, "", 1);
+    sf->len--;
+
+    /* Records are "KEY     :<length>:<value>\n". */
+    p = strstr(sf->data, "\nNSTATES :");
+    if (!p || sscanf(p + 10, "%*d:%d", &len) != 1)
+        return 0;
+    return len - 1;
+}
+
+static void replay_game(const struct options *opts, const game *g)
+{
+    struct drawcount dc;
+    midend *me = midend_new(NULL, g, &count_drawing, &dc);
+    struct savefile sf;
+    char *seed = bench_seed(opts, 0);
+    random_state *rs;
+    key_label *keys;
+    int w = DRAW_WIDTH, h = DRAW_HEIGHT;
+    int i, nkeys, moves = 0, failures = 0;
+    double *vals;
+    struct stats st;
+
+    start_default_game(opts, me, g);
+    midend_size(me, &w, &h, true, 1.0);
+    keys = midend_request_keys(me, &nkeys);
+
+    sf.data = NULL;
+    sf.size = 0;
+    rs = random_new(seed, strlen(seed));
+    for (i = 0; i < 4 * REPLAY_MOVES; i++) {
+        int x = random_upto(rs, w), y = random_upto(rs, h);
+
+        switch (random_upto(rs, nkeys > 0 ? 3 : 2)) {
+          case 0:
+            midend_process_key(me, x, y, LEFT_BUTTON, false);
+            midend_process_key(me, x, y, LEFT_RELEASE, false);
+            break;
+          case 1:
+            midend_process_key(me, x, y, RIGHT_BUTTON, false);
+            midend_process_key(me, x, y, RIGHT_RELEASE, false);
+            break;
+          default:
+            midend_process_key(me, x, y, LEFT_BUTTON, false);
+            midend_process_key(me, x, y, LEFT_RELEASE, false);
+            midend_process_key(me, 0, 0,
+                               keys[random_upto(rs, nkeys)].button, false);
+            break;
+        }
+        if (i % 256 == 255 && (moves = save_game(me, &sf)) >= REPLAY_MOVES)
+            break;
+    }
+    moves = save_game(me, &sf);
+    free_keys(keys, nkeys);
+    random_free(rs);
+    midend_free(me);
+
+    vals = snewn(opts->count, double);
+    for (i = 0; i < opts->count; i++) {
+        midend *me2 = midend_new(NULL, g, NULL, NULL);
+        double t;
+
+        sf.pos = 0;
+        t = now_ms();
+        if (midend_deserialise(me2, save_read, &sf))
+            failures++;
+        vals[i] = now_ms() - t;
+        midend_free(me2);
+    }
+    st = summarise(vals, opts->count);
+
+    if (opts->json) {
+        printf("%s  {\"game\": ", first_record ? "" : ",\n");
+        print_quoted(g->name, true);
+        printf(", \"moves\": %d, \"save_bytes\": %d,\n"
+               "   \"load_ms\": {\"min\": %.3f, \"median\": %.3f,"
+               " \"p95\": %.3f, \"max\": %.3f},\n"
+               "   \"load_failures\": %d, \"peak_rss_kb\": %ld}",
+               moves, sf.len, st.min, st.median, st.p95, st.max,
+               failures, peak_rss_kb());
+    } else {
+        print_quoted(g->name, false);
+        printf(",%d,%d,%.3f,%.3f,%.3f,%.3f,%d,%ld\n",
+               moves, sf.len, st.min, st.median, st.p95, st.max,
+               failures, peak_rss_kb());
+    }
+    fflush(stdout);
+    first_record = false;
+
+    sfree(vals);
+    sfree(sf.data);
+    sfree(seed);
+}
+
+struct export_ctx {
+    char *paramstr;
+};
+
+static void export_result(void *vctx, int index, const char *seed,
+                          const char *desc, const char *aux)
+{
+    struct export_ctx *ctx = (struct export_ctx *)vctx;
+
+    printf("%d\t%s#%s\t%s:%s\n", index, ctx->paramstr, seed,
+           ctx->paramstr, desc);
+}
+
+static int export_games(const struct options *opts, const game *g,
+                        const char *paramstr)
+{
+    game_params *params = g->default_params();
+    struct export_ctx ctx;
+    char **seeds;
+    const char *err;
+    double t;
+    int i;
+
+    g->decode_params(params, paramstr);
+    err = g->validate_params(params, true);
+    if (err) {
+        fprintf(stderr, "puzzlebench: %s: %s\n", paramstr, err);
+        g->free_params(params);
+        return 1;
+    }
+    ctx.paramstr = g->encode_params(params, true);
+
+    seeds = snewn(opts->count, char *);
+    for (i = 0; i < opts->count; i++)
+        seeds[i] = bench_seed(opts, i);
+
+    t = now_ms();
+    batch_generate(g, params, (const char *const *)seeds, opts->count,
+                   opts->threads, export_result, &ctx);
+    fprintf(stderr, "puzzlebench: %d puzzles on %d thread%s in %.1f ms\n",
+            opts->count, opts->threads, opts->threads == 1 ? "" : "s",
+            now_ms() - t);
+
+    for (i = 0; i < opts->count; i++)
+        sfree(seeds[i]);
+    sfree(seeds);
+    sfree(ctx.paramstr);
+    g->free_params(params);
+    return 0;
+}
+
+static const game *find_game(const char *name)
+{
+    int i;
+
+    for (i = 0; i < gamecount; i++)
+        if (!strcasecmp(gamelist[i]->name, name))
+            return gamelist[i];
+    return NULL;
+}
+
+static void usage(const char *pname)
+{
+    fprintf(stderr, "usage: %s [-n count] [-s seed] [--json]"
+            " [--no-solve] [--draw] [--replay] [--list] [game...]\n"
+            "       %s [-n count] [-s seed] [-j threads]"
+            " --generate game params\n", pname, pname);
+}
+
+int main(int argc, char **argv)
+{
+    struct options opts;
+    const game **games = snewn(gamecount, const game *);
+    const char *genparams = NULL;
+    int ngames = 0, i;
+
+    opts.count = 5;
+    opts.seed = "puzzlebench";
+    opts.threads = 1;
+    opts.json = false;
+    opts.solve = true;
+    opts.draw = false;
+    opts.replay = false;
+
+    for (i = 1; i < argc; i++) {
+        const char *p = argv[i];
+
+        if (!strcmp(p, "-n") && i+1 < argc) {
+            opts.count = atoi(argv[++i]);
+            if (opts.count <= 0) {
+                fprintf(stderr, "%s: '-n' expects a positive number\n",
+                        argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(p, "-s") && i+1 < argc) {
+            opts.seed = argv[++i];
+        } else if (!strcmp(p, "-j") && i+1 < argc) {
+            opts.threads = atoi(argv[++i]);
+            if (opts.threads <= 0) {
+                fprintf(stderr, "%s: '-j' expects a positive number\n",
+                        argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(p, "--generate") && i+2 < argc) {
+            const game *g = find_game(argv[++i]);
+            if (!g) {
+                fprintf(stderr, "%s: unknown game '%s'\n", argv[0], argv[i]);
+                return 1;
+            }
+            games[0] = g;
+            genparams = argv[++i];
+        } else if (!strcmp(p, "--json")) {
+            opts.json = true;
+        } else if (!strcmp(p, "--no-solve")) {
+            opts.solve = false;
+        } else if (!strcmp(p, "--draw")) {
+            opts.draw = true;
+        } else if (!strcmp(p, "--replay")) {
+            opts.replay = true;
+        } else if (!strcmp(p, "--list")) {
+            for (i = 0; i < gamecount; i++)
+                printf("%s\n", gamelist[i]->name);
+            return 0;
+        } else if (p[0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            const game *g = find_game(p);
+            if (!g) {
+                fprintf(stderr, "%s: unknown game '%s'\n", argv[0], p);
+                return 1;
+            }
+            games[ngames++] = g;
+        }
+    }
+
+    if (genparams) {
+        int ret = export_games(&opts, games[0], genparams);
+        sfree(games);
+        return ret;
+    }
+
+    if (!ngames)
+        for (ngames = 0; ngames < gamecount; ngames++)
+            games[ngames] = gamelist[ngames];
+
+    print_header(&opts);
+    for (i = 0; i < ngames; i++) {
+        if (opts.draw)
+            draw_game(&opts, games[i]);
+        else if (opts.replay)
+            replay_game(&opts, games[i]);
+        else
+            bench_game(&opts, games[i]);
+    }
+    print_footer(&opts);
+
+    sfree(games);
+    return 0;
+}
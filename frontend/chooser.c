@@ -9,7 +9,7 @@
 
 void chooserResetDialogHandler(int button) {
     if (button == 1) {
-        configDel();
+        stateReset();
         chooserSetupButtons();
         chooserRefreshCanvas();
     }
@@ -2,6 +2,9 @@
 #include <stdlib.h>
 #include <math.h>
 #include <stdbool.h>
+#ifdef DRAWSTATS
+#include <stdio.h>
+#endif
 
 #include "inkview.h"
 #include "frontend/game.h"
@@ -39,22 +42,144 @@ int convertColor(int colindex) {
     return col;
 }
 
+/*
+ * Convert the midend's colour table to InkView colours once per game,
+ * so the drawing callbacks only need an array lookup.
+ */
+static void gameBuildPalette() {
+    int i;
+    sfree(fe->colours);
+    sfree(fe->palette);
+    fe->colours = midend_colours(me, &fe->ncolours);
+    fe->palette = snewn(fe->ncolours, int);
+    for (i = 0; i < fe->ncolours; i++)
+        fe->palette[i] = convertColor(i);
+}
+
 /* ----------------------------
    Drawing callbacks
    ---------------------------- */
 
+#ifdef DRAWSTATS
+/*
+ * Count the InkView calls made by each redraw and report them on
+ * stderr when it finishes; build with -DDRAWSTATS to compare drawing
+ * strategies on the device.
+ */
+static struct {
+    long lines, fills, texts;
+    long fonthits, fontmisses, metricshits, metricsmisses;
+} drawstats;
+#define DRAWSTAT(counter) (drawstats.counter++)
+
+/* Start of the last gameResumeGame, until the game screen is shown. */
+static struct timeval resume_start;
+#else
+#define DRAWSTAT(counter) ((void)0)
+#endif
+
+static void ink_fill(int x, int y, int w, int h, int colour) {
+    if (w <= 0 || h <= 0) return;
+    DRAWSTAT(fills);
+    FillArea(fe->xoffset+x, fe->yoffset+y, w, h, colour);
+}
+
+static void ink_line(int x1, int y1, int x2, int y2, int colour) {
+    DRAWSTAT(lines);
+    DrawLine(fe->xoffset+x1, fe->yoffset+y1, fe->xoffset+x2, fe->yoffset+y2, colour);
+}
+
+/*
+ * ink_draw_text() is called for every number and letter in a grid, so
+ * opening a font and measuring the string each time adds up. Fonts
+ * are kept open in a small LRU cache until the game screen is freed,
+ * and the sizes of short strings (digits, pencil marks) are
+ * remembered in a direct-mapped table, keyed on everything that
+ * StringWidth and TextRectHeight depend on.
+ */
+static const char *const fontfaces[] = {
+    "LiberationSans", "LiberationSans-Bold", "LiberationMono", "LiberationMono-Bold"
+};
+#define FACE_BOLD 1
+#define FACE_MONO 2
+
+static ifont *gameGetFont(int face, int size) {
+    struct cachedfont *cf, *victim = NULL;
+    int i;
+
+    fe->fontclock++;
+    for (i = 0; i < FONTCACHE_SIZE; i++) {
+        cf = &fe->fontcache[i];
+        if (cf->font != NULL && cf->face == face && cf->size == size) {
+            DRAWSTAT(fonthits);
+            cf->lastuse = fe->fontclock;
+            return cf->font;
+        }
+        if (victim == NULL ||
+            (victim->font != NULL && (cf->font == NULL || cf->lastuse < victim->lastuse)))
+            victim = cf;
+    }
+
+    DRAWSTAT(fontmisses);
+    if (victim->font != NULL) CloseFont(victim->font);
+    victim->face = face;
+    victim->size = size;
+    victim->font = OpenFont(fontfaces[face], size, 0);
+    victim->lastuse = fe->fontclock;
+    return victim->font;
+}
+
+/* The font must already be selected with SetFont. */
+static void gameGetTextSize(int face, int size, int flags, const char *text, int *width, int *height) {
+    struct textmetrics *tm;
+    unsigned h;
+    const char *p;
+
+    if (strlen(text) > METRICS_MAXLEN) {
+        *width = StringWidth(text);
+        *height = TextRectHeight(*width, text, flags);
+        return;
+    }
+
+    h = (face * 31 + size) * 31 + flags;
+    for (p = text; *p; p++) h = h * 31 + (unsigned char)*p;
+    tm = &fe->metricscache[h % METRICSCACHE_SIZE];
+
+    if (tm->size == size && tm->face == face && tm->flags == flags && strcmp(tm->text, text) == 0) {
+        DRAWSTAT(metricshits);
+    } else {
+        DRAWSTAT(metricsmisses);
+        tm->face = face;
+        tm->size = size;
+        tm->flags = flags;
+        strcpy(tm->text, text);
+        tm->width = StringWidth(text);
+        tm->height = TextRectHeight(tm->width, text, flags);
+    }
+    *width = tm->width;
+    *height = tm->height;
+}
+
+static void gameFreeFonts() {
+    int i;
+    for (i = 0; i < FONTCACHE_SIZE; i++) {
+        if (fe->fontcache[i].font != NULL) CloseFont(fe->fontcache[i].font);
+        fe->fontcache[i].font = NULL;
+    }
+    for (i = 0; i < METRICSCACHE_SIZE; i++)
+        fe->metricscache[i].size = 0;
+    fe->fontclock = 0;
+}
+
 void ink_draw_text(void *handle, int x, int y, int fonttype, int fontsize,
                int align, int colour, const char *text) {
   ifont *tempfont;
   int sw, sh, flags;
   bool is_bold = (fonttype == FONT_FIXED) || (fonttype == FONT_VARIABLE);
   bool is_mono = (fonttype == FONT_FIXED) || (fonttype == FONT_FIXED_NORMAL);
+  int face = (is_bold ? FACE_BOLD : 0) | (is_mono ? FACE_MONO : 0);
 
-  tempfont = OpenFont( is_mono && is_bold ? "LiberationMono-Bold" : 
-                       is_bold            ? "LiberationSans-Bold" :
-                       is_mono            ? "LiberationMono" :
-                                            "LiberationSans",
-                       fontsize, 0);
+  tempfont = gameGetFont(face, fontsize);
 
   flags = 0x000;
   if (align & ALIGN_VNORMAL) flags |= VALIGN_TOP;
@@ -63,9 +188,8 @@ void ink_draw_text(void *handle, int x, int y, int fonttype, int fontsize,
   if (align & ALIGN_HCENTRE) flags |= ALIGN_CENTER;
   if (align & ALIGN_HRIGHT)  flags |= ALIGN_RIGHT;
 
-  SetFont(tempfont, convertColor(colour));
-  sw = StringWidth(text);
-  sh = TextRectHeight(sw, text, flags);
+  SetFont(tempfont, fe->palette[colour]);
+  gameGetTextSize(face, fontsize, flags, text, &sw, &sh);
   if      (align & ALIGN_VNORMAL) y -= sh;
   else if (align & ALIGN_VCENTRE) y -= sh/2;
   if      (align & ALIGN_HCENTRE) x -= sw/2;
@@ -73,110 +197,177 @@ void ink_draw_text(void *handle, int x, int y, int fonttype, int fontsize,
   /* Bad hack to fix strange vertical misalign between bold and normal fonts */
   if (!is_bold) y -= fontsize/12;
 
+  DRAWSTAT(texts);
   DrawString(fe->xoffset + x, fe->yoffset + y, text);
-
-  CloseFont(tempfont);
 }
 
 void ink_draw_rect(void *handle, int x, int y, int w, int h, int colour) {
-    int i;
-    for (i=0;i<h;i++) DrawLine(fe->xoffset+x,fe->yoffset+y+i,
-                        fe->xoffset+x+w-1,fe->yoffset+y+i,convertColor(colour));
+    ink_fill(x, y, w, h, fe->palette[colour]);
 }
 void ink_draw_rect_outline(void *handle, int x, int y, int w, int h, int colour) {
-    DrawRect(fe->xoffset+x, fe->yoffset+y, w, h, convertColor(colour));
+    DrawRect(fe->xoffset+x, fe->yoffset+y, w, h, fe->palette[colour]);
 }
 
 void ink_draw_line(void *handle, int x1, int y1, int x2, int y2, int colour) {
-    DrawLine(fe->xoffset+x1, fe->yoffset+y1, fe->xoffset+x2, fe->yoffset+y2, convertColor(colour));
+    ink_line(x1, y1, x2, y2, fe->palette[colour]);
 }
 
-static void extendrow(int y, int x1, int y1, int x2, int y2, int *minxptr, int *maxxptr) {
-  int x;
-  typedef long NUM;
-  NUM num;
-
-  if (((y < y1) || (y > y2)) && ((y < y2) || (y > y1)))
-    return;
-
-  if (y1 == y2) {
-    if (*minxptr > x1) *minxptr = x1;
-    if (*minxptr > x2) *minxptr = x2;
-    if (*maxxptr < x1) *maxxptr = x1;
-    if (*maxxptr < x2) *maxxptr = x2;
-    return;
-  }
-
-  if (x1 == x2) {
-    if (*minxptr > x1) *minxptr = x1;
-    if (*maxxptr < x1) *maxxptr = x1;
-    return;
-  }
+/*
+ * Polygon edges for the scanline filler. Each edge covers the
+ * scanlines ytop <= y < yend, so a vertex shared by two edges is only
+ * counted once; the bottom row is left to the outline. x is the
+ * intersection with the current scanline in 16.16 fixed point.
+ */
+struct polyedge {
+    int ytop, yend;
+    long x, dx;
+};
 
-  num = ((NUM) (y - y1)) * (x2 - x1);
-  x = x1 + num / (y2 - y1);
-  if (*minxptr > x) *minxptr = x;
-  if (*maxxptr < x) *maxxptr = x;
-}
+#define POLY_FRACBITS 16
 
-void ink_draw_polygon(void *handle, const int *icoords, int npoints,
+void ink_draw_polygon(void *handle, const int *coords, int npoints,
                   int fillcolour, int outlinecolour) {
-  MWPOINT *coords = (MWPOINT *)icoords;
-
-  MWPOINT *pp;
-  int miny;
-  int maxy;
-  int minx;
-  int maxx;
-  int i;
-
-  if (fillcolour!=-1) {
-    if (npoints <= 0) return;
-
-    pp = coords;
-    miny = pp->y;
-    maxy = pp->y;
-    for (i = npoints; i-- > 0; pp++) {
-        if (miny > pp->y) miny = pp->y;
-        if (maxy < pp->y) maxy = pp->y;
-    }
-
-    for (; miny <= maxy; miny++) {
-        minx = 32767;
-        maxx = -32768;
-        pp = coords;
-        for (i = npoints; --i > 0; pp++)
-            extendrow(miny, pp[0].x, pp[0].y, pp[1].x, pp[1].y, &minx, &maxx);
-        extendrow(miny, pp[0].x, pp[0].y, coords[0].x, coords[0].y, &minx, &maxx);
-
-        if (minx <= maxx) {
-            DrawLine(fe->xoffset+minx, fe->yoffset+miny, fe->xoffset+maxx, fe->yoffset+miny, convertColor(fillcolour));
+  struct polyedge edgebuf[16], *edges, *e, **active, *activebuf[16];
+  int nedges, nactive, next, miny, maxy, y, i, j;
+  int spanx1 = 0, spanx2 = -1, spany = 0, spanh = 0;
+
+  if (npoints <= 0) return;
+
+  if (fillcolour != -1 && npoints >= 3) {
+    edges = npoints <= lenof(edgebuf) ? edgebuf : snewn(npoints, struct polyedge);
+    active = npoints <= lenof(activebuf) ? activebuf : snewn(npoints, struct polyedge *);
+
+    /* Build the edge table, leaving out horizontal edges, sorted by ytop. */
+    nedges = 0;
+    miny = maxy = coords[1];
+    for (i = 0; i < npoints; i++) {
+      int x1 = coords[2*i], y1 = coords[2*i+1];
+      int x2 = coords[(2*i+2) % (2*npoints)], y2 = coords[(2*i+3) % (2*npoints)];
+      struct polyedge edge;
+
+      if (miny > y1) miny = y1;
+      if (maxy < y1) maxy = y1;
+      if (y1 == y2) continue;
+      if (y1 > y2) {
+        int t;
+        t = x1; x1 = x2; x2 = t;
+        t = y1; y1 = y2; y2 = t;
+      }
+      edge.ytop = y1;
+      edge.yend = y2;
+      edge.dx = (long)(x2 - x1) * (1L << POLY_FRACBITS) / (y2 - y1);
+      edge.x = (long)x1 * (1L << POLY_FRACBITS) + (1L << (POLY_FRACBITS-1));
+      for (j = nedges++; j > 0 && edges[j-1].ytop > edge.ytop; j--)
+        edges[j] = edges[j-1];
+      edges[j] = edge;
+    }
+
+    /*
+     * Walk down the polygon keeping a list of the edges crossing the
+     * current scanline, sorted by x, and fill between each pair.
+     * Convex shapes have exactly one span per row, and consecutive
+     * rows with the same span are merged into a single FillArea.
+     */
+    nactive = next = 0;
+    for (y = miny; y < maxy; y++) {
+      while (next < nedges && edges[next].ytop == y)
+        active[nactive++] = &edges[next++];
+      for (i = j = 0; i < nactive; i++)
+        if (active[i]->yend > y) active[j++] = active[i];
+      nactive = j;
+
+      for (i = 1; i < nactive; i++) {
+        e = active[i];
+        for (j = i; j > 0 && active[j-1]->x > e->x; j--)
+          active[j] = active[j-1];
+        active[j] = e;
+      }
+
+      if (nactive == 2 &&
+          spanh > 0 && spany + spanh == y &&
+          spanx1 == (int)(active[0]->x >> POLY_FRACBITS) &&
+          spanx2 == (int)(active[1]->x >> POLY_FRACBITS)) {
+        spanh++;
+      } else {
+        ink_fill(spanx1, spany, spanx2 - spanx1 + 1, spanh, fe->palette[fillcolour]);
+        spanh = 0;
+        if (nactive == 2) {
+          spanx1 = active[0]->x >> POLY_FRACBITS;
+          spanx2 = active[1]->x >> POLY_FRACBITS;
+          spany = y;
+          spanh = 1;
+        } else {
+          for (i = 0; i+1 < nactive; i += 2) {
+            int x1 = active[i]->x >> POLY_FRACBITS;
+            int x2 = active[i+1]->x >> POLY_FRACBITS;
+            ink_fill(x1, y, x2 - x1 + 1, 1, fe->palette[fillcolour]);
+          }
         }
+      }
+
+      for (i = 0; i < nactive; i++)
+        active[i]->x += active[i]->dx;
     }
+    ink_fill(spanx1, spany, spanx2 - spanx1 + 1, spanh, fe->palette[fillcolour]);
+
+    if (edges != edgebuf) sfree(edges);
+    if (active != activebuf) sfree(active);
   }
 
   for (i = 0; i < npoints-1; i++) {
-    DrawLine(fe->xoffset+coords[i].x, fe->yoffset+coords[i].y, fe->xoffset+coords[i+1].x, fe->yoffset+coords[i+1].y, convertColor(outlinecolour));
+    ink_line(coords[2*i], coords[2*i+1], coords[2*i+2], coords[2*i+3], fe->palette[outlinecolour]);
   }
-  DrawLine(fe->xoffset+coords[i].x, fe->yoffset+coords[i].y, fe->xoffset+coords[0].x, fe->yoffset+coords[0].y, convertColor(outlinecolour));
+  ink_line(coords[2*i], coords[2*i+1], coords[0], coords[1], fe->palette[outlinecolour]);
 }
 
+/*
+ * The half-width of a circle of radius r at row dy from its centre is
+ * round(sqrt(r^2 - dy^2)), which is the x with x^2 - x < r^2 - dy^2 <=
+ * x^2 + x (the edge lies between x-1/2 and x+1/2). It only shrinks as
+ * dy grows, so each row can start from the previous row's answer.
+ */
+static int circle_halfwidth(int radius, int dy, int x) {
+  int v = radius*radius - dy*dy;
+  while (x > 0 && x*x - x >= v) x--;
+  return x;
+}
 
 void ink_draw_circle(void *handle, int cx, int cy, int radius, int fillcolour, int outlinecolour) {
-  int i,x,y,yy=0-radius,xx=0;
-
-  for (i=0; i<=2*radius; i++) {
-    y=i-radius;
-    x=lround(sqrt(radius*radius-y*y));
-
-    DrawLine(fe->xoffset+cx+xx, fe->yoffset+cy+yy, fe->xoffset+cx+x, fe->yoffset+cy+y, convertColor(outlinecolour));
-    DrawLine(fe->xoffset+cx-xx, fe->yoffset+cy+yy, fe->xoffset+cx-x, fe->yoffset+cy+y, convertColor(outlinecolour));
-
-    if (fillcolour!=-1) {
-        DrawLine(fe->xoffset+cx-x, fe->yoffset+cy+y, fe->xoffset+cx+x, fe->yoffset+cy+y, convertColor(fillcolour));
+  int dy, x, nx, top;
+
+  if (radius < 0) return;
+
+  if (fillcolour != -1) {
+    /* Fill each band of rows sharing a half-width as one block,
+     * mirrored above and below the centre row. */
+    x = radius;
+    top = 0;
+    for (dy = 1; dy <= radius+1; dy++) {
+      nx = (dy <= radius) ? circle_halfwidth(radius, dy, x) : -1;
+      if (nx == x) continue;
+      if (top == 0) {
+        ink_fill(cx-x, cy-(dy-1), 2*x+1, 2*dy-1, fe->palette[fillcolour]);
+      } else {
+        ink_fill(cx-x, cy-(dy-1), 2*x+1, dy-top, fe->palette[fillcolour]);
+        ink_fill(cx-x, cy+top,    2*x+1, dy-top, fe->palette[fillcolour]);
+      }
+      top = dy;
+      x = nx;
     }
+  }
 
-    xx=x; yy=y;
+  if (radius == 0) {
+    ink_line(cx, cy, cx, cy, fe->palette[outlinecolour]);
+    return;
+  }
+  x = radius;
+  for (dy = 1; dy <= radius; dy++) {
+    nx = circle_halfwidth(radius, dy, x);
+    ink_line(cx+nx, cy-dy, cx+x, cy-dy+1, fe->palette[outlinecolour]);
+    ink_line(cx-nx, cy-dy, cx-x, cy-dy+1, fe->palette[outlinecolour]);
+    ink_line(cx+x, cy+dy-1, cx+nx, cy+dy, fe->palette[outlinecolour]);
+    ink_line(cx-x, cy+dy-1, cx-nx, cy+dy, fe->palette[outlinecolour]);
+    x = nx;
   }
 }
 
@@ -189,14 +380,25 @@ void ink_unclip(void *handle) {
 }
 
 void ink_start_draw(void *handle) {
+#ifdef DRAWSTATS
+    memset(&drawstats, 0, sizeof(drawstats));
+#endif
 }
 
 void ink_draw_update(void *handle, int x, int y, int w, int h) {
-    /* No updates while redraw is in progress.
-       Update trigger will be flagged in ink_end_draw */
+    /* No updates while redraw is in progress; the areas are collected
+       and the screen updated from gameDrawFurniture */
+    gameMarkDirty(fe->xoffset+x, fe->yoffset+y, w, h);
 }
 
 void ink_end_draw(void *handle) {
+#ifdef DRAWSTATS
+    fprintf(stderr, "redraw: %ld lines, %ld fills, %ld strings; "
+            "font cache %ld/%ld hits, text size cache %ld/%ld hits\n",
+            drawstats.lines, drawstats.fills, drawstats.texts,
+            drawstats.fonthits, drawstats.fonthits + drawstats.fontmisses,
+            drawstats.metricshits, drawstats.metricshits + drawstats.metricsmisses);
+#endif
     fe->do_update = true;
 }
 
@@ -227,6 +429,7 @@ void ink_status_bar(void *handle, const char *text) {
         FillArea(0, fe->gamelayout.statusbar.starty+1, ScreenWidth(), fe->gamelayout.statusbar.height-1, 0x00FFFFFF);
         SetFont(fe->gamefont, BLACK);
         DrawString(10, fe->gamelayout.statusbar.starty+12, text);
+        gameMarkDirty(0, fe->gamelayout.statusbar.starty+1, ScreenWidth(), fe->gamelayout.statusbar.height-1);
         fe->do_update = true;
     }
 }
@@ -304,6 +507,9 @@ void gameMenuHandler(int index) {
         case 103:  /* Solve Game */
             gameSolveGame();
             break;
+        case 107:  /* Hint */
+            gameHintGame();
+            break;
         case 104:  /* Settings */
             paramPrepare(me, CFG_PREFS);
             switchToParamScreen();
@@ -343,6 +549,7 @@ static void gameBuildGameMenu() {
 
     np = 6;
     if (fe->currentgame->can_solve) np += 1;
+    if (fe->currentgame->hint) np += 1;
     if (fe->currentgame->has_preferences) np += 1;
 
     sfree(gameMenu);
@@ -371,6 +578,13 @@ static void gameBuildGameMenu() {
     gameMenu[i].text = "Restart";
     gameMenu[i++].icon = &menu_restart;
 
+    if (fe->currentgame->hint) {
+        gameMenu[i].type = ITEM_ACTIVE;
+        gameMenu[i].index = 107;
+        gameMenu[i].text = "Hint";
+        gameMenu[i++].icon = &menu_solve;
+    }
+
     if (fe->currentgame->can_solve) {
         gameMenu[i].type = ITEM_ACTIVE;
         gameMenu[i].index = 103;
@@ -439,9 +653,12 @@ static void gameBuildTypeMenu() {
 static void gameCheckButtonState() {
     BUTTON *undo, *redo, *swap;
     const char *highlight;
+    bool tapped;
     int i;
     undo = &fe->gameButton[fe->btnUndoIDX];
     redo = &fe->gameButton[fe->btnRedoIDX];
+    if (midend_can_undo(me) != undo->active) gameMarkButton(undo);
+    if (midend_can_redo(me) != redo->active) gameMarkButton(redo);
     if (midend_can_undo(me) && !undo->active) activate_button(undo);
     if (midend_can_redo(me) && !redo->active) activate_button(redo);
     if (!midend_can_undo(me) && undo->active) deactivate_button(undo);
@@ -449,18 +666,27 @@ static void gameCheckButtonState() {
     if (fe->with_swap) {
         swap = &fe->gameButton[fe->btnSwapIDX];
         fe->swapped ? button_to_tapped(swap, false) : button_to_normal(swap, false);
+        gameSetButtonTapped(fe->btnSwapIDX, fe->swapped);
     }
     for (i=0;i<fe->numGameButtons;i++) {
         if (fe->gameButton[i].action == ACTION_CTRL) {
             highlight = midend_current_key_label(me, fe->gameButton[i].actionParm.c);
-            if (strcmp(highlight, "H") == 0)
+            tapped = (strcmp(highlight, "H") == 0);
+            if (tapped)
                 button_to_tapped(&fe->gameButton[i], false);
             else
                 button_to_normal(&fe->gameButton[i], false);
+            gameSetButtonTapped(i, tapped);
         }
     }
 }
 
+/* Record how a button is drawn now, and whether the screen needs to catch up. */
+static void gameSetButtonTapped(int i, bool tapped) {
+    if (fe->btnTapped[i] != tapped) gameMarkButton(&fe->gameButton[i]);
+    fe->btnTapped[i] = tapped;
+}
+
 /* ----------------------------
    Screen event callbacks
    ---------------------------- */
@@ -482,11 +708,13 @@ void gameTap(int x, int y) {
             }
             if (is_active) button_to_normal(&fe->gameButton[i], true);
             else           button_to_tapped(&fe->gameButton[i], true);
+            fe->btnTapped[i] = !is_active;
         }
         if ((fe->gameButton[i].action == ACTION_SWAP) &&
             coord_in_button(x, y, &fe->gameButton[i])) {
             if (fe->swapped) button_to_normal(&fe->gameButton[i], true);
             else             button_to_tapped(&fe->gameButton[i], true);
+            fe->btnTapped[i] = !fe->swapped;
         }
     }
 
@@ -569,8 +797,10 @@ void gameRelease(int x, int y) {
     }
     for (i=0;i<fe->numGameButtons;i++) {
         if (release_button(init_tap_x, init_tap_y, &fe->gameButton[i])) {
-            if ((fe->gameButton[i].action != ACTION_SWAP) && (fe->gameButton[i].action != ACTION_CTRL))
+            if ((fe->gameButton[i].action != ACTION_SWAP) && (fe->gameButton[i].action != ACTION_CTRL)) {
                 button_to_normal(&fe->gameButton[i], false);
+                gameSetButtonTapped(i, false);
+            }
             if (release_button(x, y, &fe->gameButton[i])) {
                 switch(fe->gameButton[i].action) {
                     case ACTION_BACK:
@@ -628,8 +858,10 @@ static void gameDrawControlButtons() {
     FillArea(0, fe->gamelayout.buttonpanel.starty, ScreenWidth(), fe->gamelayout.buttonpanel.height, 0x00FFFFFF);
     FillArea(0, fe->gamelayout.buttonpanel.starty, ScreenWidth(), 1, 0x00000000);
 
-    for (i=0;i<fe->numGameButtons;i++)
+    for (i=0;i<fe->numGameButtons;i++) {
         button_to_normal(&fe->gameButton[i], false);
+        fe->btnTapped[i] = false;
+    }
 
     deactivate_button(&fe->gameButton[fe->btnUndoIDX]);
     deactivate_button(&fe->gameButton[fe->btnRedoIDX]);
@@ -718,7 +950,7 @@ void gamePrepareFrontend() {
     fe->pointerdown_x = 0;
     fe->pointerdown_y = 0;
     fe->swapped = false;
-    fe->colours = midend_colours(me, &fe->ncolours);
+    gameBuildPalette();
     fe->finished = false;
     fe->isTimer = false;
     fe->time_int = 20;
@@ -803,6 +1035,9 @@ static LAYOUTTYPE gameGetLayout() {
     if (strcmp(fe->currentgame->name, "Unequal")==0)  fe->with_twoctrllines = true;
 
     fe->gameButton = smalloc((fe->numGameButtons) * sizeof(BUTTON));
+    sfree(fe->btnTapped);
+    fe->btnTapped = snewn(fe->numGameButtons, bool);
+    memset(fe->btnTapped, 0, fe->numGameButtons * sizeof(bool));
 
     for (i=0;i<nkeys;i++) {
         fe->gameButton[i] = gameGetButton(fe->currentgame->name, keys[i].button);
@@ -838,11 +1073,128 @@ static LAYOUTTYPE gameGetLayout() {
 static void gameDrawFurniture() {
     if (fe->do_update) {
         gameCheckButtonState();
-        SoftUpdate();
+        gameFlushUpdates();
     }
     fe->do_update = false;
 }
 
+/* ----------------------------
+   Screen updates
+   ---------------------------- */
+
+/*
+ * Every area drawn to since the last screen update is collected in
+ * fe->dirty, and gameFlushUpdates() then refreshes just those areas
+ * of the e-ink panel. Each PartialUpdate costs a fixed overhead, given
+ * here in pixels, on top of the area it covers. Two areas are merged
+ * into their bounding box whenever that box, updated once, is no more
+ * expensive than updating separately all the areas merged into the
+ * two so far. If the merged areas still cover more than
+ * fe->update_threshold percent of the screen, the whole screen is
+ * updated instead.
+ */
+#define UPDATE_OVERHEAD (48*48)
+#define UPDATE_MAXRECTS 128
+#define UPDATE_THRESHOLD 50
+
+static bool rect_contains(const struct dirtyrect *outer, const struct dirtyrect *inner) {
+    return (inner->x >= outer->x && inner->x + inner->w <= outer->x + outer->w &&
+            inner->y >= outer->y && inner->y + inner->h <= outer->y + outer->h);
+}
+
+/*
+ * The areas are added back one at a time. Each one is merged with the
+ * first area already there that it pays to merge with, and the grown
+ * box is tried against the rest again, so no two areas left can be
+ * merged. Every merge removes an area, so this takes quadratic time.
+ * An area inside another one always merges, since the cost of a box
+ * is never less than that of updating it.
+ */
+static void gameMergeDirty() {
+    struct dirtyrect box, merged, *a;
+    int i, j, n;
+
+    for (i = n = 0; i < fe->ndirty; i++) {
+        box = fe->dirty[i];
+        for (j = 0; j < n; j++) {
+            a = &fe->dirty[j];
+            merged.x = min(a->x, box.x);
+            merged.y = min(a->y, box.y);
+            merged.w = max(a->x + a->w, box.x + box.w) - merged.x;
+            merged.h = max(a->y + a->h, box.y + box.h) - merged.y;
+            merged.cost = a->cost + box.cost;
+            if ((long)merged.w * merged.h + UPDATE_OVERHEAD > merged.cost)
+                continue;
+
+            /* Take a out and start over with the grown box */
+            box = merged;
+            fe->dirty[j] = fe->dirty[--n];
+            j = -1;
+        }
+        fe->dirty[n++] = box;
+    }
+    fe->ndirty = n;
+}
+
+static void gameMarkDirty(int x, int y, int w, int h) {
+    struct dirtyrect *r, rect;
+    int i;
+
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > ScreenWidth())  w = ScreenWidth() - x;
+    if (y + h > ScreenHeight()) h = ScreenHeight() - y;
+    if (w <= 0 || h <= 0) return;
+    rect.x = x; rect.y = y; rect.w = w; rect.h = h;
+    rect.cost = (long)w * h + UPDATE_OVERHEAD;
+
+    /* A full redraw marks the whole canvas first, so this catches most
+       of the areas marked after it */
+    for (i = 0; i < fe->ndirty; i++)
+        if (rect_contains(&fe->dirty[i], &rect)) return;
+
+    if (fe->ndirty >= UPDATE_MAXRECTS) {
+        gameMergeDirty();
+        if (fe->ndirty >= UPDATE_MAXRECTS) {
+            /* Still too fragmented; fall back to one bounding box */
+            int x2 = x+w, y2 = y+h;
+            for (i = 0; i < fe->ndirty; i++) {
+                r = &fe->dirty[i];
+                x = min(x, r->x); x2 = max(x2, r->x + r->w);
+                y = min(y, r->y); y2 = max(y2, r->y + r->h);
+            }
+            rect.x = x; rect.y = y; rect.w = x2-x; rect.h = y2-y;
+            rect.cost = (long)rect.w * rect.h + UPDATE_OVERHEAD;
+            fe->ndirty = 0;
+        }
+    }
+    if (fe->ndirty >= fe->dirtysize) {
+        fe->dirtysize = fe->ndirty + 16;
+        fe->dirty = sresize(fe->dirty, fe->dirtysize, struct dirtyrect);
+    }
+    fe->dirty[fe->ndirty++] = rect;
+}
+
+static void gameMarkButton(BUTTON *button) {
+    gameMarkDirty(button->posx, button->posy, button->size, button->size);
+}
+
+static void gameFlushUpdates() {
+    long area = 0;
+    int i;
+
+    gameMergeDirty();
+    for (i = 0; i < fe->ndirty; i++)
+        area += (long)fe->dirty[i].w * fe->dirty[i].h;
+
+    if (area * 100 > (long)fe->update_threshold * ScreenWidth() * ScreenHeight())
+        SoftUpdate();
+    else
+        for (i = 0; i < fe->ndirty; i++)
+            PartialUpdate(fe->dirty[i].x, fe->dirty[i].y, fe->dirty[i].w, fe->dirty[i].h);
+    fe->ndirty = 0;
+}
+
 static void gameRestartGame() {
     fe->do_update = true;
     midend_restart_game(me);
@@ -859,15 +1211,29 @@ static void gameSolveGame() {
     gameDrawFurniture();
 }
 
+static void gameHintGame() {
+    const char *errorMsg;
+    fe->do_update = true;
+    errorMsg = midend_hint(me);
+    if (errorMsg) Message(ICON_WARNING, "", errorMsg, 3000);
+    else fe->finished = (midend_status(me) != 0);
+    gameDrawFurniture();
+}
+
 static void gameSwitchPreset(int index) {
     midend_set_params(me, presets->entries[index].params);
     gameStartNewGame();
 }
 
 void gameStartNewGame() {
-    ShowPureHourglassForce();
-    midend_new_game(me);
-    HideHourglass();
+    if (midend_pregenerated_available(me)) {
+        midend_new_game(me);
+    }
+    else {
+        ShowPureHourglassForce();
+        midend_new_game(me);
+        HideHourglass();
+    }
     gamePrepareFrontend();
 }
 
@@ -876,6 +1242,9 @@ bool gameResumeGame() {
     const char *result;
     bool validSavegame = false;
     int i = 0;
+#ifdef DRAWSTATS
+    gettimeofday(&resume_start, NULL);
+#endif
     result = stateGamesaveName(&name);
     if (result == NULL && name != NULL) {
         while (mygames[i].thegame != NULL) {
@@ -909,6 +1278,7 @@ void gameSetGame(const struct game *thegame) {
     me = midend_new(fe, thegame, &ink_drawing, fe);
     stateLoadParams(me, thegame);
     stateLoadSettings(me, thegame);
+    midend_enable_pregeneration(me, 1);
 }
 
 void gameScreenShow() {
@@ -921,14 +1291,36 @@ void gameScreenShow() {
     gameDrawStatusBar();
     ink_status_bar(NULL, midend_get_statustext(me));
     FullUpdate();
+    fe->ndirty = 0;
+#ifdef DRAWSTATS
+    if (resume_start.tv_sec) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        fprintf(stderr, "resume: %ld ms to first paint\n",
+                (now.tv_sec - resume_start.tv_sec) * 1000L +
+                (now.tv_usec - resume_start.tv_usec) / 1000);
+        resume_start.tv_sec = 0;
+    }
+#endif
 }
 
 void gameScreenInit() {
+    char *buf;
     fe = snew(frontend);
     fe->cliprect = GetClipRect();
     fe->gfontsize = (int)(ScreenWidth()/30);
     fe->gamefont = OpenFont("LiberationSans-Bold", fe->gfontsize, 0);
     fe->gameButton = NULL;
+    fe->btnTapped = NULL;
+    fe->dirty = NULL;
+    fe->ndirty = fe->dirtysize = 0;
+    buf = configGetItem("config_update_threshold");
+    fe->update_threshold = buf ? atoi(buf) : UPDATE_THRESHOLD;
+    fe->colours = NULL;
+    fe->palette = NULL;
+    memset(fe->fontcache, 0, sizeof(fe->fontcache));
+    memset(fe->metricscache, 0, sizeof(fe->metricscache));
+    fe->fontclock = 0;
     fe->do_update = false;
     fe->isTimer = false;
     gameMenu = NULL;
@@ -948,9 +1340,14 @@ void gameSerialise() {
 void gameScreenFree() {
     if (gameInitialized) {
         CloseFont(fe->gamefont);
+        gameFreeFonts();
         SetClipRect(&fe->cliprect);
         deactivate_timer(fe);
         sfree(fe->gameButton);
+        sfree(fe->btnTapped);
+        sfree(fe->dirty);
+        sfree(fe->colours);
+        sfree(fe->palette);
         sfree(fe);
         sfree(gameMenu);
         sfree(typeMenu);
@@ -3,6 +3,12 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "inkview.h"
 #include "frontend/common.h"
@@ -12,125 +18,254 @@
 
 const char *configFileName = STATEPATH "/sgtpuzzles.cfg";
 /* const char *configFileName = STATEPATH "/sgtpuzzlesdev.cfg"; */
-static dict_t *config = NULL;
+
+/*
+ * The config is an open-addressing hash table (linear probing, size a
+ * power of two), since the chooser looks up a handful of keys for
+ * every game each time it draws.
+ *
+ * A deleted item keeps its slot, with value NULL, so that probing
+ * carries on past it and so that configSave knows to record the
+ * deletion; such slots are only dropped when the table is rebuilt.
+ *
+ * The file is a journal of "key<TAB>value" lines, where a later line
+ * overrides an earlier one for the same key and a line with no value
+ * deletes the key. configSave appends just the items changed since the
+ * last save, and rewrites the file from scratch once more than half of
+ * it is outdated lines.
+ */
+#define CONFIG_MINSIZE 128
+#define CONFIG_COMPACT_SLACK 4096
+
+static configentry *config = NULL;
+static int configSize = 0;      /* number of slots */
+static int configUsed = 0;      /* slots with a key, deleted ones included */
+static int configCount = 0;     /* items with a value */
+static long configJournal = 0;  /* size of the file on disk */
+static bool configRewrite = false;  /* file must be rewritten in full */
+
+static unsigned long configHash(const char *key) {
+    unsigned long h = 2166136261UL;
+    while (*key) {
+        h ^= (unsigned char)*key++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+/* Slot holding the key, or the empty slot where it would go. */
+static configentry *configFindSlot(const char *key) {
+    unsigned long i = configHash(key) & (configSize - 1);
+    while (config[i].key != NULL && strcmp(config[i].key, key) != 0)
+        i = (i + 1) & (configSize - 1);
+    return &config[i];
+}
+
+/*
+ * Rebuild the table, dropping deleted items whose deletion has been
+ * saved, at a size that leaves it at most half full.
+ */
+static void configRehash() {
+    configentry *old = config;
+    int oldsize = configSize, newsize = CONFIG_MINSIZE, keep = 0, i;
+    for (i = 0; i < oldsize; i++)
+        if (old[i].key != NULL && (old[i].value != NULL || old[i].dirty))
+            keep++;
+    while (4 * (keep + 1) > 2 * newsize)
+        newsize *= 2;
+    config = snewn(newsize, configentry);
+    memset(config, 0, newsize * sizeof(configentry));
+    configSize = newsize;
+    configUsed = 0;
+    for (i = 0; i < oldsize; i++) {
+        if (old[i].key == NULL)
+            continue;
+        if (old[i].value == NULL && !old[i].dirty) {
+            sfree(old[i].key);
+            continue;
+        }
+        *configFindSlot(old[i].key) = old[i];
+        configUsed++;
+    }
+    sfree(old);
+}
 
 int configLen() {
-    int count = 0;
-    dict_t *ptr;
-    for (ptr = config; ptr != NULL; ptr = ptr->next)
-        count++;
-    return count;
+    return configCount;
 }
 
 void configAddItem(const char *key, const char *value) {
-    dict_t *ptr;
-    dict_t *new;
-    configDelItem(key);
-    for (ptr = config; ptr != NULL; ptr = ptr->next) {
-        if (strcmp(ptr->key, key) == 0) {
-            ptr->value = srealloc(ptr->value, strlen(value)+1);
-            strcpy(ptr->value, value);
-            return;
+    configentry *e;
+    /* A key without a value reads back as a deletion, so store it as one */
+    if (*value == '\0') {
+        configDelItem(key);
+        return;
+    }
+    if (configSize == 0)
+        configRehash();
+    e = configFindSlot(key);
+    if (e->key == NULL) {
+        if (4 * (configUsed + 1) > 3 * configSize) {
+            configRehash();
+            e = configFindSlot(key);
         }
+        e->key = dupstr(key);
+        e->value = NULL;
+        configUsed++;
     }
-    new = smalloc(sizeof(struct dict_t_struct));
-    new->key = smalloc(strlen(key)+1);
-    new->value = smalloc(strlen(value)+1);
-    strcpy(new->key, key);
-    strcpy(new->value, value);
-    new->next = config;
-    config = new;
-    return;
+    else if (e->value != NULL && strcmp(e->value, value) == 0)
+        return;
+    if (e->value == NULL)
+        configCount++;
+    sfree(e->value);
+    e->value = dupstr(value);
+    e->dirty = true;
 }
 
 void configDel() {
-    dict_t *ptr;
-    while (config != NULL) {
-        ptr = config;
-        config = config->next;
-        sfree(ptr->key);
-        sfree(ptr->value);
-        sfree(ptr);
+    int i;
+    for (i = 0; i < configSize; i++) {
+        sfree(config[i].key);
+        sfree(config[i].value);
     }
+    sfree(config);
+    config = NULL;
+    configSize = configUsed = configCount = 0;
+    configRewrite = true;
 }
 
 char *configGetItem(const char *key) {
-    dict_t *ptr;
-    for (ptr = config; ptr != NULL; ptr = ptr->next) {
-        if (strcmp(ptr->key, key) == 0) {
-            return ptr->value;
-        }
-    }
-    return NULL;
+    if (configSize == 0)
+        return NULL;
+    return configFindSlot(key)->value;
 }
 
 void configDelItem(const char *key) {
-    dict_t *ptr, *prev;
-    ptr = config;
-    prev = NULL;
-    while(ptr != NULL) {
-        if(strcmp(ptr->key, key) == 0) {
-            if      (prev == NULL && ptr->next != NULL)
-                config = ptr->next;
-            else if (prev != NULL && ptr->next != NULL)
-                prev->next = ptr->next;
-            else if (prev == NULL && ptr->next == NULL)
-                config = NULL;
-            else
-                prev->next = NULL;
-            sfree(ptr->key);
-            sfree(ptr->value);
-            sfree(ptr);
-            return;
+    configentry *e;
+    if (configSize == 0)
+        return;
+    e = configFindSlot(key);
+    if (e->value != NULL) {
+        sfree(e->value);
+        e->value = NULL;
+        e->dirty = true;
+        configCount--;
+    }
+}
+
+/*
+ * Write the whole config to a temporary file and rename it over the
+ * old one, so that an interrupted save never loses the settings.
+ */
+static void configCompact(long livesize) {
+    char *tmpname = smalloc(strlen(configFileName) + 5);
+    FILE *fp;
+    int i;
+    sprintf(tmpname, "%s.tmp", configFileName);
+    fp = fopen(tmpname, "w");
+    if (fp) {
+        bool ok;
+        for (i = 0; i < configSize; i++)
+            if (config[i].value != NULL)
+                fprintf(fp, "%s\t%s\n", config[i].key, config[i].value);
+        ok = (fflush(fp) == 0 && !ferror(fp) && fsync(fileno(fp)) == 0);
+        if (fclose(fp) != 0) ok = false;
+        if (ok && rename(tmpname, configFileName) == 0) {
+            for (i = 0; i < configSize; i++)
+                config[i].dirty = false;
+            configJournal = livesize;
+            configRewrite = false;
         }
-        prev = ptr;
-        ptr = ptr->next;
+        else
+            remove(tmpname);
     }
+    sfree(tmpname);
+}
+
+static long configLineSize(const configentry *e) {
+    return strlen(e->key) + (e->value ? strlen(e->value) + 1 : 0) + 1;
 }
 
 void configSave() {
-    dict_t *ptr;
-    FILE *fp = fopen(configFileName, "w");
+    FILE *fp;
+    bool ok;
+    long livesize = 0, dirtysize = 0;
+    int i;
+    for (i = 0; i < configSize; i++) {
+        if (config[i].value != NULL)
+            livesize += configLineSize(&config[i]);
+        if (config[i].dirty)
+            dirtysize += configLineSize(&config[i]);
+    }
+    if (configRewrite ||
+        configJournal + dirtysize > 2 * livesize + CONFIG_COMPACT_SLACK) {
+        configCompact(livesize);
+        return;
+    }
+    if (dirtysize == 0)
+        return;
+    fp = fopen(configFileName, "a");
     if (fp) {
-        while (config != NULL) {
-            ptr = config;
-            config = config->next;
-            fprintf(fp, "%s\t%s\n", ptr->key, ptr->value);
+        for (i = 0; i < configSize; i++) {
+            if (!config[i].dirty)
+                continue;
+            if (config[i].value != NULL)
+                fprintf(fp, "%s\t%s\n", config[i].key, config[i].value);
+            else
+                fprintf(fp, "%s\n", config[i].key);
+        }
+        ok = (fflush(fp) == 0 && !ferror(fp) && fsync(fileno(fp)) == 0);
+        if (fclose(fp) != 0) ok = false;
+        if (ok) {
+            for (i = 0; i < configSize; i++)
+                config[i].dirty = false;
+            configJournal += dirtysize;
         }
-        fclose(fp);
+        else
+            /* A line may have been cut short; don't append after it */
+            configRewrite = true;
     }
 }
 
 void configLoad() {
   size_t buflen = 65536;
-  size_t linelen;
   char *buf;
-  char *value;
-  char *key;
+  char *key, *value;
   FILE *fp;
+  int i;
 
   buf = smalloc(buflen);
-  key = snewn(256, char);
-  value = snewn(256, char);
+  configJournal = 0;
   fp = fopen(configFileName, "r");
   if (fp != NULL) {
-    while(getline(&buf, &buflen, fp) != EOF) {
-      linelen = strlen(buf);
-      if (linelen > 0) {
-        value = sresize(value, linelen, char);
-        sscanf(buf, "%s %s", key, value);
-        if ((strncmp("params_",   key, 7) == 0) ||
-            (strncmp("savegame",  key, 8) == 0) ||
-            (strncmp("favorite_", key, 9) == 0) ||
-            (strncmp("config_",   key, 7) == 0) ||
-            (strncmp("settings_", key, 9) == 0))
-            configAddItem(key, value);
+    ssize_t linelen;
+    while((linelen = getline(&buf, &buflen, fp)) != EOF) {
+      configJournal += linelen;
+      /* A last line cut short by an interrupted save is dropped, and the
+         next save rewrites the file rather than append to it */
+      if (buf[linelen-1] != '\n') {
+        configRewrite = true;
+        break;
+      }
+      key = strtok(buf, " \t\r\n");
+      if (key == NULL)
+        continue;
+      value = strtok(NULL, " \t\r\n");
+      if ((strncmp("params_",   key, 7) == 0) ||
+          (strncmp("savegame",  key, 8) == 0) ||
+          (strncmp("favorite_", key, 9) == 0) ||
+          (strncmp("config_",   key, 7) == 0) ||
+          (strncmp("settings_", key, 9) == 0)) {
+        if (value != NULL)
+          configAddItem(key, value);
+        else
+          configDelItem(key);
       }
     }
     fclose(fp);
   }
-  sfree(value);
-  sfree(key);
+  for (i = 0; i < configSize; i++)
+    config[i].dirty = false;
   sfree(buf);
 }
 
@@ -160,41 +295,214 @@ static bool deserialiseReadCallback(void *ctx, void *buf, int len)
     return true;
 }
 
+/*
+ * The saved game is kept in a binary file of its own for each game,
+ * not in the config file: a long undo history can run to megabytes,
+ * and the config is read in full at every start. The config only
+ * records which game was saved last, as "savegame_game". Older
+ * versions kept the save hex-encoded as "savegame"; that is still
+ * read, and dropped the next time the game is saved.
+ *
+ * The file starts with SAVEFILE_MAGIC, followed by records, each
+ * made of a 4-byte little-endian payload length, a 1-byte type and
+ * the payload:
+ *   'N'  name of the game
+ *   'D'  output of midend_serialise
+ *   'E'  end of file (empty)
+ * Readers skip records of unknown types.
+ */
+#define SAVEFILE_MAGIC "SGTPUZZLES-SAVE1"
+#define SAVEFILE_MAGICLEN 16
+
+static char *stateSavefileName(const char *gamename, const char *suffix) {
+    char *path = smalloc(strlen(STATEPATH) + strlen(gamename) + strlen(suffix) + 20);
+    char *p;
+    p = path + sprintf(path, "%s/sgtpuzzles-", STATEPATH);
+    for (; *gamename; gamename++)
+        *p++ = isalnum((unsigned char)*gamename) ? tolower((unsigned char)*gamename) : '_';
+    sprintf(p, ".sav%s", suffix);
+    return path;
+}
+
+static void savefileWriteRecord(FILE *fp, char type, const void *data, size_t len) {
+    unsigned char hdr[5];
+    hdr[0] = len & 0xFF;
+    hdr[1] = (len >> 8) & 0xFF;
+    hdr[2] = (len >> 16) & 0xFF;
+    hdr[3] = (len >> 24) & 0xFF;
+    hdr[4] = type;
+    fwrite(hdr, 1, 5, fp);
+    if (len > 0) fwrite(data, 1, len, fp);
+}
+
+/*
+ * Write the file under a temporary name, flush it to disk, and only
+ * then rename it over the old one, so that a crash or a flat battery
+ * part way through leaves the previous save intact.
+ */
+static bool stateWriteSavefile(const char *gamename, const struct serialise_buf *data) {
+    char *path = stateSavefileName(gamename, "");
+    char *tmppath = stateSavefileName(gamename, ".tmp");
+    bool ok = false;
+    FILE *fp = fopen(tmppath, "wb");
+    if (fp) {
+        fwrite(SAVEFILE_MAGIC, 1, SAVEFILE_MAGICLEN, fp);
+        savefileWriteRecord(fp, 'N', gamename, strlen(gamename));
+        savefileWriteRecord(fp, 'D', data->buf, data->len);
+        savefileWriteRecord(fp, 'E', NULL, 0);
+        ok = (fflush(fp) == 0 && !ferror(fp) && fsync(fileno(fp)) == 0);
+        if (fclose(fp) != 0) ok = false;
+        if (ok) ok = (rename(tmppath, path) == 0);
+        if (!ok) remove(tmppath);
+        else {
+            int fd = open(STATEPATH, O_RDONLY);
+            if (fd >= 0) {
+                fsync(fd);
+                close(fd);
+            }
+        }
+    }
+    sfree(tmppath);
+    sfree(path);
+    return ok;
+}
+
+/* Read the midend data of a game's savefile into game_save. */
+static const char *stateReadSavefile(const char *gamename) {
+    char *path = stateSavefileName(gamename, "");
+    const char *err = NULL;
+    unsigned char hdr[SAVEFILE_MAGICLEN];
+    bool gotdata = false, gotend = false;
+    struct stat st;
+    FILE *fp = fopen(path, "rb");
+    sfree(path);
+    if (!fp)
+        return "No saved gamestate";
+
+    if (fstat(fileno(fp), &st) != 0)
+        err = "Savefile cannot be read";
+    else if (fread(hdr, 1, SAVEFILE_MAGICLEN, fp) != SAVEFILE_MAGICLEN ||
+        memcmp(hdr, SAVEFILE_MAGIC, SAVEFILE_MAGICLEN) != 0)
+        err = "Savefile has wrong format";
+    while (!err && !gotend) {
+        unsigned long len;
+        long pos;
+        if (fread(hdr, 1, 5, fp) != 5) {
+            err = "Savefile is truncated";
+            break;
+        }
+        len = hdr[0] | (hdr[1] << 8) | ((unsigned long)hdr[2] << 16) | ((unsigned long)hdr[3] << 24);
+        /* Check a damaged length before trusting it with an allocation */
+        pos = ftell(fp);
+        if (pos < 0 || len > (unsigned long)(st.st_size - pos)) {
+            err = "Savefile is truncated";
+            break;
+        }
+        if (len > INT_MAX) {
+            err = "Savefile is too large";
+            break;
+        }
+        switch (hdr[4]) {
+          case 'D':
+            sfree(game_save.buf);
+            game_save.buf = snewn(len > 0 ? len : 1, unsigned char);
+            game_save.len = len;
+            game_save.pos = 0;
+            if (fread(game_save.buf, 1, len, fp) != len)
+                err = "Savefile is truncated";
+            gotdata = true;
+            break;
+          case 'E':
+            gotend = true;
+            break;
+          default:
+            if (fseek(fp, len, SEEK_CUR) != 0)
+                err = "Savefile is truncated";
+            break;
+        }
+    }
+    fclose(fp);
+    if (!err && !gotdata)
+        err = "Savefile contains no game";
+    return err;
+}
+
+/* Load the hex-encoded savegame of older versions into game_save. */
+static const char *stateReadLegacySavegame() {
+    char *buf = configGetItem("savegame");
+    if (buf == NULL)
+        return "No saved gamestate";
+    sfree(game_save.buf);
+    game_save.buf = hex2bin(buf, (strlen(buf)+1)/2);
+    game_save.len = (strlen(buf)+1)/2;
+    game_save.pos = 0;
+    return NULL;
+}
+
+/* Delete the savefile of the game recorded as saved last, if any. */
+static void stateRemoveOldSavefile(const char *keepname) {
+    char *saved = configGetItem("savegame_game");
+    if (saved != NULL && (keepname == NULL || strcmp(saved, keepname) != 0)) {
+        char *path = stateSavefileName(saved, "");
+        remove(path);
+        sfree(path);
+    }
+}
+
 void stateSerialise(midend *me) {
+    const char *name = midend_which_game(me)->name;
     char *buf;
     sfree(game_save.buf);
     game_save.buf = NULL;
     game_save.len = game_save.pos = 0;
     midend_serialise(me, serialiseWriteCallback, &game_save);
-    buf = bin2hex(game_save.buf, game_save.len);
-    configAddItem("savegame", buf);
-    sfree(buf);
+    if (stateWriteSavefile(name, &game_save)) {
+        /* Only one game is kept, so the file of another one is stale */
+        stateRemoveOldSavefile(name);
+        configAddItem("savegame_game", name);
+        configDelItem("savegame");
+    }
+    else {
+        /* Better a big config file than a lost game */
+        stateRemoveOldSavefile(NULL);
+        buf = bin2hex(game_save.buf, game_save.len);
+        configAddItem("savegame", buf);
+        configDelItem("savegame_game");
+        sfree(buf);
+    }
+}
+
+/* Forget all settings and presets, and the saved game with them. */
+void stateReset() {
+    stateRemoveOldSavefile(NULL);
+    configDel();
+}
+
+/*
+ * Load the last saved game into game_save, if it was a game of the
+ * given type (or of any type, if gamename is NULL).
+ */
+static const char *stateLoadSavegame(const char *gamename) {
+    char *saved = configGetItem("savegame_game");
+    if (saved != NULL && (gamename == NULL || strcmp(saved, gamename) == 0) &&
+        stateReadSavefile(saved) == NULL)
+        return NULL;
+    return stateReadLegacySavegame();
 }
 
 const char *stateDeserialise(midend *me) {
-    char *buf;
-    buf = configGetItem("savegame");
-    if (buf != NULL) {
-        sfree(game_save.buf);
-        game_save.buf = hex2bin(buf, (strlen(buf)+1)/2);
-        game_save.len = (strlen(buf)+1)/2;
-        game_save.pos = 0;
-        return midend_deserialise(me, deserialiseReadCallback, &game_save);
-    }
-    return "No saved gamestate";
+    const char *err = stateLoadSavegame(midend_which_game(me)->name);
+    if (err != NULL)
+        return err;
+    return midend_deserialise(me, deserialiseReadCallback, &game_save);
 }
 
 const char *stateGamesaveName(char **name) {
-    char *buf;
-    buf = configGetItem("savegame");
-    if (buf != NULL) {
-        sfree(game_save.buf);
-        game_save.buf = hex2bin(buf, (strlen(buf)+1)/2);
-        game_save.len = (strlen(buf)+1)/2;
-        game_save.pos = 0;
-        return identify_game(name, deserialiseReadCallback, &game_save);
-    }
-    return "No saved gamestate";
+    const char *err = stateLoadSavegame(NULL);
+    *name = NULL;
+    if (err != NULL)
+        return err;
+    return identify_game(name, deserialiseReadCallback, &game_save);
 }
 
 void stateLoadParams(midend *me, const game *ourgame) {
@@ -283,6 +591,7 @@ void stateFree() {
         configSave();
         sfree(game_save.buf);
         configDel();
+        configRewrite = false;
         stateInitialized = false;
     }
 }
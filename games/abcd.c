@@ -1808,7 +1808,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
                     (ty + TILE_SIZE)-(TILE_SIZE/6) - 1, COL_GRID);
             }
             
-            draw_update(dr, tx, ty, TILE_SIZE, TILE_SIZE);
+            draw_update(dr, tx, ty-1, TILE_SIZE+1, TILE_SIZE+1);
             ds->oldgridfs[y*w+x] = fs;
             ds->grid[y*w+x] = state->grid[y*w+x];
             for(i = 0; i < n; i++)
@@ -1861,6 +1861,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -1872,6 +1873,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -850,6 +850,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     false, NULL, /* solve */
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     true, get_prefs, set_prefs,
     new_ui,
@@ -861,6 +862,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -1305,7 +1305,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
         draw_rect(dr, TODRAW(0)-1, TODRAW(0)-1,
           TILE_SIZE, TILE_SIZE, COL_BACKGROUND);
     }
-    draw_update(dr, TODRAW(0), TODRAW(0), TILE_SIZE, TILE_SIZE);
+    draw_update(dr, TODRAW(0)-1, TODRAW(0)-1, TILE_SIZE+1, TILE_SIZE+1);
     ds->reveal = state->reveal;
 
     {
@@ -1402,6 +1402,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -1413,6 +1414,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -3346,7 +3346,9 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
     int ymax = max(ui->dsy, ui->dey);
     char ship;
     bool redraw = ds->redraw;
+    bool *drawn = snewn(w*h, bool);
 
+    memset(drawn, 0, w*h * sizeof(bool));
     sprintf(buf, "%s",
             state->cheated   ? "Auto-solved." :
             state->completed ? "COMPLETED!" : "");
@@ -3448,6 +3450,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
             != ds->gridfs[y*w+x] || ds->grid[y*w+x] != ship)
         {
             draw_update(dr, tx, ty, tilesize + 1, tilesize + 1);
+            drawn[y*w+x] = true;
             ds->oldgridfs[y*w+x] = ds->gridfs[y*w+x];
             ds->grid[y*w+x] = ship;
             
@@ -3484,16 +3487,22 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
         }
     }
     
-    /* Draw collisions */
+    /* Draw collisions over any of the four squares just redrawn */
     for(x = 0; x < w - 1; x++)
     for(y = 0; y < h - 1; y++)
     {
-        if(ds->gridfs[y*w+x] & FE_COLLISION)
+        if(ds->gridfs[y*w+x] & FE_COLLISION &&
+            (drawn[y*w+x] || drawn[y*w+x+1] ||
+             drawn[(y+1)*w+x] || drawn[(y+1)*w+x+1]))
         {
             boats_draw_collision(dr, tilesize, (x+1.5F)*tilesize,
             (y+1.5F)*tilesize);
+            draw_update(dr, (x+1.5F)*tilesize - tilesize*2/5,
+                (y+1.5F)*tilesize - tilesize*2/5,
+                tilesize*4/5 + 1, tilesize*4/5 + 1);
         }
     }
+    sfree(drawn);
     
     /* Draw fleet */
     boats_draw_fleet(dr, w, h+2, state->fleet, state->fleetdata, 
@@ -3566,6 +3575,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -3577,6 +3587,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     32, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
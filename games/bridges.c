@@ -137,7 +137,7 @@ struct game_params {
 typedef unsigned int grid_type; /* change me later if we invent > 16 bits of flags. */
 
 struct solver_state {
-    DSF *dsf, *tmpdsf;
+    DSF *dsf;
     int *comptspaces, *tmpcompspaces;
     int refcount;
 };
@@ -1401,7 +1401,7 @@ static bool solve_island_impossible(game_state *state)
 /* Bear in mind that this function is really rather inefficient. */
 static bool solve_island_stage3(struct island *is, bool *didsth_r)
 {
-    int i, n, x, y, missing, spc, curr, maxb;
+    int i, n, x, y, missing, spc, curr, maxb, mark;
     bool didsth = false;
     struct solver_state *ss = is->state->solver;
 
@@ -1420,9 +1420,8 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
         /* Now we know that this island could have more bridges,
          * to bring the total from curr+1 to curr+spc. */
         maxb = -1;
-        /* We have to squirrel the dsf away and restore it afterwards;
-         * it is additive only, and can't be removed from. */
-        dsf_copy(ss->tmpdsf, ss->dsf);
+        /* The dsf is additive only, so roll it back to here afterwards. */
+        mark = dsf_checkpoint(ss->dsf);
         for (n = curr+1; n <= curr+spc; n++) {
             solve_join(is, i, n, false);
             map_update_possibles(is->state);
@@ -1434,7 +1433,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
             }
         }
         solve_join(is, i, curr, false); /* put back to before. */
-        dsf_copy(ss->dsf, ss->tmpdsf);
+        dsf_rollback(ss->dsf, mark);
 
         if (maxb != -1) {
             if (maxb == 0) {
@@ -1500,7 +1499,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
                                   is->adj.points[j].dx ? G_LINEH : G_LINEV);
         if (before[i] != 0) continue;  /* this idea is pointless otherwise */
 
-        dsf_copy(ss->tmpdsf, ss->dsf);
+        mark = dsf_checkpoint(ss->dsf);
 
         for (j = 0; j < is->adj.npoints; j++) {
             spc = island_adjspace(is, true, missing, j);
@@ -1515,7 +1514,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
 
         for (j = 0; j < is->adj.npoints; j++)
             solve_join(is, j, before[j], false);
-        dsf_copy(ss->dsf, ss->tmpdsf);
+        dsf_rollback(ss->dsf, mark);
 
         if (got) {
             solve_join(is, i, 1, false);
@@ -1626,7 +1625,6 @@ static game_state *new_state(const game_params *params)
 
     ret->solver = snew(struct solver_state);
     ret->solver->dsf = dsf_new(wh);
-    ret->solver->tmpdsf = dsf_new(wh);
 
     ret->solver->refcount = 1;
 
@@ -1676,7 +1674,6 @@ static void free_game(game_state *state)
 {
     if (--state->solver->refcount <= 0) {
         dsf_free(state->solver->dsf);
-        dsf_free(state->solver->tmpdsf);
         sfree(state->solver);
     }
 
@@ -2906,6 +2903,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     true, get_prefs, set_prefs,
     new_ui,
@@ -2917,6 +2915,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
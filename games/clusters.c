@@ -993,6 +993,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     true, get_prefs, set_prefs,
     new_ui,
@@ -1004,6 +1005,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     32, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -2746,6 +2746,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2757,6 +2758,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -860,8 +860,8 @@ static void game_free_drawstate(drawing *dr, game_drawstate *ds)
  * 10 Hex pattern
  */
 
-static void draw_textured_tile(drawing *dr, int x, int y, int w, int h, int col) {
-    clip(dr, x, y, w, h);
+static void draw_textured_tile(drawing *dr, int x, int y, int w, int h,
+                               int col, bool highlight) {
     if (col == 0) {
         draw_rect(dr, x, y, w, h, COL_BLACK);
     }
@@ -1283,7 +1283,6 @@ static void draw_textured_tile(drawing *dr, int x, int y, int w, int h, int col)
     else {
         draw_rect(dr, x, y, w, h, COL_BACKGROUND);
     }
-    unclip(dr);
 }
 
 static void draw_solution_circle(drawing *dr, int x, int y, int ts, int col) {
@@ -1320,7 +1319,8 @@ static void draw_tile(drawing *dr, game_drawstate *ds,
 
     colour = tile >> COLOUR_SHIFT;
     /* colour += COL_1; */
-    draw_textured_tile(dr, tx, ty, TILESIZE, TILESIZE, colour);
+    draw_cached_tile(dr, draw_textured_tile, tx, ty, TILESIZE, TILESIZE,
+                     colour, false);
 
     if (tile & BORDER_L)
         draw_rect(dr, tx, ty,
@@ -1392,6 +1392,9 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
         draw_rect(dr, COORD(0) - SEP_WIDTH, COORD(0) - SEP_WIDTH,
                   TILESIZE * w + 2 * SEP_WIDTH, TILESIZE * h + 2 * SEP_WIDTH,
                   COL_SEPARATOR);
+        draw_update(dr, COORD(0) - HIGHLIGHT_WIDTH, COORD(0) - HIGHLIGHT_WIDTH,
+                    TILESIZE * w + 2 * HIGHLIGHT_WIDTH,
+                    TILESIZE * h + 2 * HIGHLIGHT_WIDTH);
 
         ds->started = true;
     }
@@ -1527,6 +1530,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -1538,6 +1542,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
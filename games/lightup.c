@@ -1714,42 +1714,36 @@ static char *interpret_move(const game_state *state, game_ui *ui,
 static game_state *execute_move(const game_state *state, const game_ui *ui, const char *move)
 {
     game_state *ret = dup_game(state);
-    int x, y, n, flags;
-    char c;
+    int x, y, r, flags;
+    move_item it;
 
     if (!*move) goto badmove;
 
     ret->used_solve = ret->completed = false;
 
-    while (*move) {
-        c = *move;
-        if (c == 'S') {
+    while ((r = move_next_item(&move, &it)) > 0) {
+        if (it.c == 'S' && it.nargs == 0) {
             ret->used_solve = true;
-            move++;
-        } else if (c == 'L' || c == 'I') {
-            move++;
-            if (sscanf(move, "%d,%d%n", &x, &y, &n) != 2 ||
-                x < 0 || y < 0 || x >= ret->w || y >= ret->h)
+        } else if ((it.c == 'L' || it.c == 'I') && it.nargs == 2) {
+            x = it.args[0];
+            y = it.args[1];
+            if (x < 0 || y < 0 || x >= ret->w || y >= ret->h)
                 goto badmove;
 
             flags = GRID(ret, flags, x, y);
             if (flags & F_BLACK) goto badmove;
 
             /* LIGHT and IMPOSSIBLE are mutually exclusive. */
-            if (c == 'L') {
+            if (it.c == 'L') {
                 GRID(ret, flags, x, y) &= ~F_IMPOSSIBLE;
                 set_light(ret, x, y, !(flags & F_LIGHT));
             } else {
                 set_light(ret, x, y, false);
                 GRID(ret, flags, x, y) ^= F_IMPOSSIBLE;
             }
-            move += n;
         } else goto badmove;
-
-        if (*move == ';')
-            move++;
-        else if (*move) goto badmove;
     }
+    if (r < 0) goto badmove;
     ret->completed = grid_correct(ret);
     return ret;
 
@@ -1989,6 +1983,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     true, get_prefs, set_prefs,
     new_ui,
@@ -2000,6 +1995,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
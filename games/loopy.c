@@ -77,6 +77,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "puzzles.h"
 #include "tree234.h"
@@ -127,6 +128,13 @@ enum solver_status {
 };
 
 /* ------ Solver state ------ */
+enum { TODO_TRIVIAL, TODO_DLINE, NUM_TODO };
+
+/* Bit sets of faces or dots still to be looked at by one solver */
+struct solver_todo {
+    unsigned *faces, *dots;
+};
+
 typedef struct solver_state {
     game_state *state;
     enum solver_status solver_status;
@@ -154,6 +162,22 @@ typedef struct solver_state {
 
     /* Hard level information */
     DSF *linedsf;
+
+    /* Faces and dots that the solvers going through them one by one
+     * (trivial_deductions and dline_deductions) need to look at. A face
+     * or dot is added when something around it changes, and taken off
+     * when the solver next looks at it: if it found nothing to do
+     * there last time, it would find nothing again. */
+    struct solver_todo todo[NUM_TODO];
+
+    /* If non-NULL, every line decided by solver_set_line is appended
+     * here, recording the order in which the deductions were made. */
+    int *trace;
+    int ntrace;
+
+    /* Holds this structure and all the arrays above (but not the
+     * game_state or the DSFs) */
+    arena *arena;
 } solver_state;
 
 /*
@@ -225,7 +249,7 @@ struct game_drawstate {
 static const char *validate_desc(const game_params *params, const char *desc);
 static int dot_order(const game_state* state, int i, char line_type);
 static int face_order(const game_state* state, int i, char line_type);
-static solver_state *solve_game_rec(const solver_state *sstate);
+static void solve_game_rec(solver_state *sstate);
 
 /*
  * Grid type config options available in Loopy.
@@ -310,8 +334,7 @@ static game_state *dup_game(const game_state *state)
 {
     game_state *ret = snew(game_state);
 
-    ret->game_grid = state->game_grid;
-    ret->game_grid->refcount++;
+    ret->game_grid = grid_ref(state->game_grid);
 
     ret->solved = state->solved;
     ret->cheated = state->cheated;
@@ -342,126 +365,182 @@ static void free_game(game_state *state)
     }
 }
 
-static solver_state *new_solver_state(const game_state *state, int diff) {
+#define TODO_BITS (8 * (int)sizeof(unsigned))
+#define TODO_WORDS(n) (((n) + TODO_BITS - 1) / TODO_BITS)
+
+static void todo_fill(unsigned *bits, int n)
+{
     int i;
-    int num_dots = state->game_grid->num_dots;
-    int num_faces = state->game_grid->num_faces;
-    int num_edges = state->game_grid->num_edges;
-    solver_state *ret = snew(solver_state);
 
-    ret->state = dup_game(state);
+    for (i = 0; i < n / TODO_BITS; i++)
+        bits[i] = ~0U;
+    if (n % TODO_BITS)
+        bits[i] = (1U << (n % TODO_BITS)) - 1;
+}
 
-    ret->solver_status = SOLVER_INCOMPLETE;
-    ret->diff = diff;
+static void todo_add(unsigned *bits, int i)
+{
+    bits[i / TODO_BITS] |= 1U << (i % TODO_BITS);
+}
 
-    ret->dotdsf = dsf_new(num_dots);
-    ret->looplen = snewn(num_dots, int);
+/*
+ * Remove and return the first index from i onwards in a todo set of
+ * size n, or -1 if there is none.
+ */
+static int todo_take(unsigned *bits, int n, int i)
+{
+    int w = i / TODO_BITS;
+    unsigned m;
+
+    if (i >= n)
+        return -1;
+    m = bits[w] & (~0U << (i % TODO_BITS));
+    while (!m) {
+        if (++w >= TODO_WORDS(n))
+            return -1;
+        m = bits[w];
+    }
+#ifdef __GNUC__
+    i = w * TODO_BITS + __builtin_ctz(m);
+#else
+    for (i = w * TODO_BITS; !(m & 1); m >>= 1)
+        i++;
+#endif
+    bits[w] &= ~(1U << (i % TODO_BITS));
+    return i;
+}
+
+/*
+ * Allocate a solver_state and its arrays, all from one arena sized to
+ * hold them, leaving the contents to the caller. The solver makes and
+ * throws away a great many of these while generating a puzzle.
+ */
+static solver_state *alloc_solver_state(int num_dots, int num_faces,
+                                        int num_edges, bool dlines) {
+    int i;
+    arena *a = arena_new(sizeof(solver_state) +
+                         num_dots * (sizeof(int) + sizeof(bool) + 2) +
+                         num_faces * (sizeof(bool) + 2) +
+                         NUM_TODO * (TODO_WORDS(num_dots) +
+                                     TODO_WORDS(num_faces)) *
+                         sizeof(unsigned) +
+                         (dlines ? 2*num_edges : 0) + 12*16);
+    solver_state *ret = anew(a, solver_state);
+
+    ret->arena = a;
+    ret->looplen = anewn(a, num_dots, int);
+    ret->dot_solved = anewn(a, num_dots, bool);
+    ret->face_solved = anewn(a, num_faces, bool);
+    ret->dot_yes_count = anewn(a, num_dots, char);
+    ret->dot_no_count = anewn(a, num_dots, char);
+    ret->face_yes_count = anewn(a, num_faces, char);
+    ret->face_no_count = anewn(a, num_faces, char);
+    for (i = 0; i < NUM_TODO; i++) {
+        ret->todo[i].faces = anewn(a, TODO_WORDS(num_faces), unsigned);
+        ret->todo[i].dots = anewn(a, TODO_WORDS(num_dots), unsigned);
+    }
+    ret->dlines = dlines ? anewn(a, 2*num_edges, char) : NULL;
+    ret->trace = NULL;
+    ret->ntrace = 0;
+
+    return ret;
+}
+
+/*
+ * Put a solver_state back to knowing nothing beyond its game_state.
+ */
+static void clear_solver_state(solver_state *sstate) {
+    int i;
+    int num_dots = sstate->state->game_grid->num_dots;
+    int num_faces = sstate->state->game_grid->num_faces;
+    int num_edges = sstate->state->game_grid->num_edges;
+
+    sstate->solver_status = SOLVER_INCOMPLETE;
+
+    dsf_reinit(sstate->dotdsf);
 
     for (i = 0; i < num_dots; i++) {
-        ret->looplen[i] = 1;
+        sstate->looplen[i] = 1;
     }
 
-    ret->dot_solved = snewn(num_dots, bool);
-    ret->face_solved = snewn(num_faces, bool);
-    memset(ret->dot_solved, 0, num_dots * sizeof(bool));
-    memset(ret->face_solved, 0, num_faces * sizeof(bool));
+    memset(sstate->dot_solved, 0, num_dots * sizeof(bool));
+    memset(sstate->face_solved, 0, num_faces * sizeof(bool));
 
-    ret->dot_yes_count = snewn(num_dots, char);
-    memset(ret->dot_yes_count, 0, num_dots);
-    ret->dot_no_count = snewn(num_dots, char);
-    memset(ret->dot_no_count, 0, num_dots);
-    ret->face_yes_count = snewn(num_faces, char);
-    memset(ret->face_yes_count, 0, num_faces);
-    ret->face_no_count = snewn(num_faces, char);
-    memset(ret->face_no_count, 0, num_faces);
+    memset(sstate->dot_yes_count, 0, num_dots);
+    memset(sstate->dot_no_count, 0, num_dots);
+    memset(sstate->face_yes_count, 0, num_faces);
+    memset(sstate->face_no_count, 0, num_faces);
 
-    if (diff < DIFF_NORMAL) {
-        ret->dlines = NULL;
-    } else {
-        ret->dlines = snewn(2*num_edges, char);
-        memset(ret->dlines, 0, 2*num_edges);
+    for (i = 0; i < NUM_TODO; i++) {
+        todo_fill(sstate->todo[i].faces, num_faces);
+        todo_fill(sstate->todo[i].dots, num_dots);
     }
 
+    if (sstate->dlines)
+        memset(sstate->dlines, 0, 2*num_edges);
+
+    if (sstate->linedsf)
+        dsf_reinit(sstate->linedsf);
+
+    sstate->ntrace = 0;
+}
+
+static solver_state *new_solver_state(const game_state *state, int diff) {
+    int num_dots = state->game_grid->num_dots;
+    int num_faces = state->game_grid->num_faces;
+    int num_edges = state->game_grid->num_edges;
+    solver_state *ret = alloc_solver_state(num_dots, num_faces, num_edges,
+                                           diff >= DIFF_NORMAL);
+
+    ret->state = dup_game(state);
+    ret->diff = diff;
+
+    ret->dotdsf = dsf_new(num_dots);
+
     if (diff < DIFF_HARD) {
         ret->linedsf = NULL;
     } else {
         ret->linedsf = dsf_new_flip(state->game_grid->num_edges);
     }
 
+    clear_solver_state(ret);
+
     return ret;
 }
 
+/*
+ * Reuse a solver_state for another game_state on the same grid, at
+ * the difficulty it was made for. Generating a puzzle solves a great
+ * many clue sets in a row, and this saves setting up a new state for
+ * each of them.
+ */
+static void reset_solver_state(solver_state *sstate, const game_state *state)
+{
+    game_state *s = sstate->state;
+
+    assert(s->game_grid == state->game_grid);
+    s->solved = state->solved;
+    s->cheated = state->cheated;
+    memcpy(s->clues, state->clues, state->game_grid->num_faces);
+    memcpy(s->lines, state->lines, state->game_grid->num_edges);
+    memcpy(s->line_errors, state->line_errors,
+           state->game_grid->num_edges * sizeof(bool));
+    s->exactly_one_loop = state->exactly_one_loop;
+
+    clear_solver_state(sstate);
+}
+
 static void free_solver_state(solver_state *sstate) {
     if (sstate) {
         free_game(sstate->state);
         dsf_free(sstate->dotdsf);
-        sfree(sstate->looplen);
-        sfree(sstate->dot_solved);
-        sfree(sstate->face_solved);
-        sfree(sstate->dot_yes_count);
-        sfree(sstate->dot_no_count);
-        sfree(sstate->face_yes_count);
-        sfree(sstate->face_no_count);
-
-        /* OK, because sfree(NULL) is a no-op */
-        sfree(sstate->dlines);
         dsf_free(sstate->linedsf);
 
-        sfree(sstate);
+        /* Frees sstate itself along with its arrays */
+        arena_free(sstate->arena);
     }
 }
 
-static solver_state *dup_solver_state(const solver_state *sstate) {
-    game_state *state = sstate->state;
-    int num_dots = state->game_grid->num_dots;
-    int num_faces = state->game_grid->num_faces;
-    int num_edges = state->game_grid->num_edges;
-    solver_state *ret = snew(solver_state);
-
-    ret->state = state = dup_game(sstate->state);
-
-    ret->solver_status = sstate->solver_status;
-    ret->diff = sstate->diff;
-
-    ret->dotdsf = dsf_new(num_dots);
-    ret->looplen = snewn(num_dots, int);
-    dsf_copy(ret->dotdsf, sstate->dotdsf);
-    memcpy(ret->looplen, sstate->looplen,
-           num_dots * sizeof(int));
-
-    ret->dot_solved = snewn(num_dots, bool);
-    ret->face_solved = snewn(num_faces, bool);
-    memcpy(ret->dot_solved, sstate->dot_solved, num_dots * sizeof(bool));
-    memcpy(ret->face_solved, sstate->face_solved, num_faces * sizeof(bool));
-
-    ret->dot_yes_count = snewn(num_dots, char);
-    memcpy(ret->dot_yes_count, sstate->dot_yes_count, num_dots);
-    ret->dot_no_count = snewn(num_dots, char);
-    memcpy(ret->dot_no_count, sstate->dot_no_count, num_dots);
-
-    ret->face_yes_count = snewn(num_faces, char);
-    memcpy(ret->face_yes_count, sstate->face_yes_count, num_faces);
-    ret->face_no_count = snewn(num_faces, char);
-    memcpy(ret->face_no_count, sstate->face_no_count, num_faces);
-
-    if (sstate->dlines) {
-        ret->dlines = snewn(2*num_edges, char);
-        memcpy(ret->dlines, sstate->dlines,
-               2*num_edges);
-    } else {
-        ret->dlines = NULL;
-    }
-
-    if (sstate->linedsf) {
-        ret->linedsf = dsf_new_flip(num_edges);
-        dsf_copy(ret->linedsf, sstate->linedsf);
-    } else {
-        ret->linedsf = NULL;
-    }
-
-    return ret;
-}
-
 static game_params *default_params(void)
 {
     game_params *ret = snew(game_params);
@@ -787,18 +866,61 @@ static char *encode_solve_move(const game_state *state)
     return ret;
 }
 
+struct game_ui {
+    /*
+     * Hint cache, filled in by the first hint request: the solved
+     * line states, every line in the order the solver deduced it,
+     * and each line's position in that order.
+     */
+    char *soln;
+    int *order, *rank;
+    /* All order[] entries before hintpos are set correctly. */
+    int hintpos;
+    /* Number of lines currently set contrary to soln. */
+    int nwrong;
+};
+
 static game_ui *new_ui(const game_state *state)
 {
-    return NULL;
+    game_ui *ui = snew(game_ui);
+
+    ui->soln = NULL;
+    ui->order = ui->rank = NULL;
+    ui->hintpos = ui->nwrong = 0;
+    return ui;
 }
 
 static void free_ui(game_ui *ui)
 {
+    sfree(ui->soln);
+    sfree(ui->order);
+    sfree(ui->rank);
+    sfree(ui);
 }
 
 static void game_changed_state(game_ui *ui, const game_state *oldstate,
                                const game_state *newstate)
 {
+    int i, n = newstate->game_grid->num_edges;
+
+    if (!ui->soln)
+        return;
+
+    /*
+     * Keep the hint cache in step with the move, so that the next
+     * hint only has to look at what changed.
+     */
+    for (i = 0; i < n; i++) {
+        char was = oldstate->lines[i], now = newstate->lines[i];
+        if (was == now)
+            continue;
+        if (was != LINE_UNKNOWN && was != ui->soln[i])
+            ui->nwrong--;
+        if (now != LINE_UNKNOWN && now != ui->soln[i])
+            ui->nwrong++;
+        if (now != ui->soln[i] && ui->rank[i] < ui->hintpos)
+            ui->hintpos = ui->rank[i];
+    }
 }
 
 static void game_compute_size(const game_params *params, int tilesize,
@@ -891,6 +1013,24 @@ static float game_anim_length(const game_state *oldstate,
 /* Sets the line (with index i) to the new state 'line_new', and updates
  * the cached counts of any affected faces and dots.
  * Returns true if this actually changed the line's state. */
+/*
+ * Something about dot d has changed: one of its lines, or one of its
+ * dlines. That can give the per-dot and per-face solvers something new
+ * to do at d and at every face with d as a corner.
+ */
+static void solver_touch_dot(solver_state *sstate, grid_dot *d)
+{
+    int i, t;
+
+    for (t = 0; t < NUM_TODO; t++) {
+        struct solver_todo *todo = &sstate->todo[t];
+        todo_add(todo->dots, d->index);
+        for (i = 0; i < d->order; i++)
+            if (d->faces[i])
+                todo_add(todo->faces, d->faces[i]->index);
+    }
+}
+
 static bool solver_set_line(solver_state *sstate, int i,
                             enum line_state line_new) {
     game_state *state = sstate->state;
@@ -902,11 +1042,16 @@ static bool solver_set_line(solver_state *sstate, int i,
     if (state->lines[i] == line_new) {
         return false; /* nothing changed */
     }
+    if (sstate->trace && state->lines[i] == LINE_UNKNOWN)
+        sstate->trace[sstate->ntrace++] = i;
     state->lines[i] = line_new;
 
     g = state->game_grid;
     e = g->edges[i];
 
+    solver_touch_dot(sstate, e->dot1);
+    solver_touch_dot(sstate, e->dot2);
+
     /* Update the cache for both dots and both faces affected by this. */
     if (line_new == LINE_YES) {
         sstate->dot_yes_count[e->dot1->index]++;
@@ -1102,31 +1247,72 @@ static void add_full_clues(game_state *state, random_state *rs)
 }
 
 
-static bool game_has_unique_soln(const game_state *state, int diff)
+/*
+ * Solve the game_state held in sstate, which is used up in the
+ * process: reset_solver_state makes it ready for another go.
+ */
+static bool solver_has_unique_soln(solver_state *sstate)
+{
+    solve_game_rec(sstate);
+
+    assert(sstate->solver_status != SOLVER_MISTAKE);
+    return (sstate->solver_status == SOLVER_SOLVED);
+}
+
+
+struct remove_clues_ctx {
+    const game_state *state;
+    int diff;
+
+    /* Solver states not currently in use by any thread */
+    pthread_mutex_t lock;
+    solver_state **spare;
+    int nspare, sparesize;
+};
+
+/* Called by reduce_clues(), possibly on several threads at once. */
+static bool remove_clues_check(void *vctx, const bool *present)
 {
+    struct remove_clues_ctx *ctx = (struct remove_clues_ctx *)vctx;
+    solver_state *sstate = NULL;
+    int i;
     bool ret;
-    solver_state *sstate_new;
-    solver_state *sstate = new_solver_state(state, diff);
 
-    sstate_new = solve_game_rec(sstate);
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->nspare > 0)
+        sstate = ctx->spare[--ctx->nspare];
+    pthread_mutex_unlock(&ctx->lock);
 
-    assert(sstate_new->solver_status != SOLVER_MISTAKE);
-    ret = (sstate_new->solver_status == SOLVER_SOLVED);
+    if (sstate)
+        reset_solver_state(sstate, ctx->state);
+    else
+        sstate = new_solver_state(ctx->state, ctx->diff);
 
-    free_solver_state(sstate_new);
-    free_solver_state(sstate);
+    for (i = 0; i < ctx->state->game_grid->num_faces; i++)
+        if (!present[i])
+            sstate->state->clues[i] = -1;
+    ret = solver_has_unique_soln(sstate);
+
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->nspare >= ctx->sparesize) {
+        ctx->sparesize = ctx->nspare * 2 + 4;
+        ctx->spare = sresize(ctx->spare, ctx->sparesize, solver_state *);
+    }
+    ctx->spare[ctx->nspare++] = sstate;
+    pthread_mutex_unlock(&ctx->lock);
 
     return ret;
 }
 
-
 /* Remove clues one at a time at random. */
 static game_state *remove_clues(game_state *state, random_state *rs,
                                 int diff)
 {
     int *face_list;
+    bool *present;
     int num_faces = state->game_grid->num_faces;
-    game_state *ret = dup_game(state), *saved_ret;
+    game_state *ret = dup_game(state);
+    struct remove_clues_ctx ctx;
     int n;
 
     /* We need to remove some clues.  We'll do this by forming a list of all
@@ -1134,23 +1320,36 @@ static game_state *remove_clues(game_state *state, random_state *rs,
      * time clearing each clue in turn for which doing so doesn't render the
      * board unsolvable. */
     face_list = snewn(num_faces, int);
+    present = snewn(num_faces, bool);
     for (n = 0; n < num_faces; ++n) {
         face_list[n] = n;
+        present[n] = state->clues[n] >= 0;
     }
 
     shuffle(face_list, num_faces, sizeof(int), rs);
 
-    for (n = 0; n < num_faces; ++n) {
-        saved_ret = dup_game(ret);
-        ret->clues[face_list[n]] = -1;
-
-        if (game_has_unique_soln(ret, diff)) {
-            free_game(saved_ret);
-        } else {
-            free_game(ret);
-            ret = saved_ret;
-        }
-    }
+    /*
+     * The solver gives up as soon as it could close a loop satisfying
+     * every clue, and whether it gets there first depends on the order
+     * of its deductions. So an extra clue isn't guaranteed never to
+     * make it fail, and REDUCE_MONOTONE would be unsafe.
+     */
+    ctx.state = state;
+    ctx.diff = diff;
+    pthread_mutex_init(&ctx.lock, NULL);
+    ctx.spare = NULL;
+    ctx.nspare = ctx.sparesize = 0;
+    reduce_clues(face_list, num_faces, present, remove_clues_check, &ctx,
+                 0, 0);
+    while (ctx.nspare > 0)
+        free_solver_state(ctx.spare[--ctx.nspare]);
+    sfree(ctx.spare);
+    pthread_mutex_destroy(&ctx.lock);
+
+    for (n = 0; n < num_faces; ++n)
+        if (!present[n])
+            ret->clues[n] = -1;
+    sfree(present);
     sfree(face_list);
 
     return ret;
@@ -1165,6 +1364,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     grid *g;
     game_state *state = snew(game_state);
     game_state *state_new;
+    solver_state *full = NULL, *easier = NULL;
 
     grid_desc = grid_new_desc(grid_types[params->type], params->w, params->h, rs);
     state->game_grid = g = loopy_generate_grid(params, grid_desc);
@@ -1187,22 +1387,35 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     /* Get a new random solvable board with all its clues filled in.  Yes, this
      * can loop for ever if the params are suitably unfavourable, but
      * preventing games smaller than 4x4 seems to stop this happening */
-    do {
+    while (1) {
         add_full_clues(state, rs);
-    } while (!game_has_unique_soln(state, params->diff));
+        if (!full)
+            full = new_solver_state(state, params->diff);
+        else
+            reset_solver_state(full, state);
+        if (solver_has_unique_soln(full))
+            break;
+    }
 
     state_new = remove_clues(state, rs, params->diff);
     free_game(state);
     state = state_new;
 
 
-    if (params->diff > 0 && game_has_unique_soln(state, params->diff-1)) {
-        goto newboard_please;
+    if (params->diff > 0) {
+        if (!easier)
+            easier = new_solver_state(state, params->diff-1);
+        else
+            reset_solver_state(easier, state);
+        if (solver_has_unique_soln(easier))
+            goto newboard_please;
     }
 
     game_desc = state_to_text(state);
 
     free_game(state);
+    free_solver_state(full);
+    free_solver_state(easier);
 
     if (grid_desc) {
         retval = snewn(strlen(grid_desc) + 1 + strlen(game_desc) + 1, char);
@@ -1579,17 +1792,28 @@ static bool is_atleastone(const char *dline_array, int index)
 {
     return BIT_SET(dline_array[index], 0);
 }
-static bool set_atleastone(char *dline_array, int index)
+static void dline_touch(solver_state *sstate, int index)
 {
-    return SET_BIT(dline_array[index], 0);
+    grid_edge *e = sstate->state->game_grid->edges[index / 2];
+    solver_touch_dot(sstate, (index & 1) ? e->dot1 : e->dot2);
+}
+static bool set_atleastone(solver_state *sstate, int index)
+{
+    if (!SET_BIT(sstate->dlines[index], 0))
+        return false;
+    dline_touch(sstate, index);
+    return true;
 }
 static bool is_atmostone(const char *dline_array, int index)
 {
     return BIT_SET(dline_array[index], 1);
 }
-static bool set_atmostone(char *dline_array, int index)
+static bool set_atmostone(solver_state *sstate, int index)
 {
-    return SET_BIT(dline_array[index], 1);
+    if (!SET_BIT(sstate->dlines[index], 1))
+        return false;
+    dline_touch(sstate, index);
+    return true;
 }
 
 static void array_setall(char *array, char from, char to, int len)
@@ -1635,7 +1859,7 @@ static bool dline_set_opp_atleastone(solver_state *sstate,
             continue;
         /* Found opposite UNKNOWNS and they're next to each other */
         opp_dline_index = dline_index_from_dot(g, d, opp);
-        return set_atleastone(sstate->dlines, opp_dline_index);
+        return set_atleastone(sstate, opp_dline_index);
     }
     return false;
 }
@@ -1814,10 +2038,11 @@ static int trivial_deductions(solver_state *sstate)
     int i, current_yes, current_no;
     game_state *state = sstate->state;
     grid *g = state->game_grid;
+    struct solver_todo *todo = &sstate->todo[TODO_TRIVIAL];
     int diff = DIFF_MAX;
 
     /* Per-face deductions */
-    for (i = 0; i < g->num_faces; i++) {
+    for (i = 0; (i = todo_take(todo->faces, g->num_faces, i)) >= 0; i++) {
         grid_face *f = g->faces[i];
 
         if (sstate->face_solved[i])
@@ -1915,7 +2140,7 @@ static int trivial_deductions(solver_state *sstate)
     }
 
     /* Per-dot deductions */
-    for (i = 0; i < g->num_dots; i++) {
+    for (i = 0; (i = todo_take(todo->dots, g->num_dots, i)) >= 0; i++) {
         grid_dot *d = g->dots[i];
         int yes, no, unknown;
 
@@ -1961,6 +2186,7 @@ static int dline_deductions(solver_state *sstate)
 {
     game_state *state = sstate->state;
     grid *g = state->game_grid;
+    struct solver_todo *todo = &sstate->todo[TODO_DLINE];
     char *dlines = sstate->dlines;
     int i;
     int diff = DIFF_MAX;
@@ -2008,7 +2234,7 @@ static int dline_deductions(solver_state *sstate)
      * could get quite expensive if there are many large faces. */
 #define MAX_FACE_SIZE 14
 
-    for (i = 0; i < g->num_faces; i++) {
+    for (i = 0; (i = todo_take(todo->faces, g->num_faces, i)) >= 0; i++) {
         int maxs[MAX_FACE_SIZE][MAX_FACE_SIZE];
         int mins[MAX_FACE_SIZE][MAX_FACE_SIZE];
         grid_face *f = g->faces[i];
@@ -2126,13 +2352,13 @@ static int dline_deductions(solver_state *sstate)
                 /* minimum YESs in the complement of this dline */
                 if (mins[k][j] > clue - 2) {
                     /* Adding 2 YESs would break the clue */
-                    if (set_atmostone(dlines, dline_index))
+                    if (set_atmostone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
                 /* maximum YESs in the complement of this dline */
                 if (maxs[k][j] < clue) {
                     /* Adding 2 NOs would mean not enough YESs */
-                    if (set_atleastone(dlines, dline_index))
+                    if (set_atleastone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
             }
@@ -2144,7 +2370,7 @@ static int dline_deductions(solver_state *sstate)
 
     /* ------ Dot deductions ------ */
 
-    for (i = 0; i < g->num_dots; i++) {
+    for (i = 0; (i = todo_take(todo->dots, g->num_dots, i)) >= 0; i++) {
         grid_dot *d = g->dots[i];
         int N = d->order;
         int yes, no, unknown;
@@ -2170,11 +2396,11 @@ static int dline_deductions(solver_state *sstate)
 
             /* Infer dline state from line state */
             if (line1 == LINE_NO || line2 == LINE_NO) {
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
             }
             if (line1 == LINE_YES || line2 == LINE_YES) {
-                if (set_atleastone(dlines, dline_index))
+                if (set_atleastone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
             }
             /* Infer line state from dline state */
@@ -2220,10 +2446,10 @@ static int dline_deductions(solver_state *sstate)
                 }
             }
             if (yes == 1) {
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
                 if (unknown == 2) {
-                    if (set_atleastone(dlines, dline_index))
+                    if (set_atleastone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
             }
@@ -2249,7 +2475,7 @@ static int dline_deductions(solver_state *sstate)
                         if (j == N-1 && opp == 0)
                             continue;
                         opp_dline_index = dline_index_from_dot(g, d, opp);
-                        if (set_atmostone(dlines, opp_dline_index))
+                        if (set_atmostone(sstate, opp_dline_index))
                             diff = min(diff, DIFF_NORMAL);
                     }
                     if (yes == 0 && is_atmostone(dlines, dline_index)) {
@@ -2363,9 +2589,9 @@ static int linedsf_deductions(solver_state *sstate)
             can2 = dsf_canonify_flip(sstate->linedsf, line2_index, &inv2);
             if (can1 == can2 && inv1 != inv2) {
                 /* These are opposites, so set dline atmostone/atleastone */
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
-                if (set_atleastone(dlines, dline_index))
+                if (set_atleastone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
                 continue;
             }
@@ -2565,17 +2791,19 @@ static int loop_deductions(solver_state *sstate)
     return progress ? DIFF_EASY : DIFF_MAX;
 }
 
-/* This will return a dynamically allocated solver_state containing the (more)
- * solved grid */
-static solver_state *solve_game_rec(const solver_state *sstate_start)
+/*
+ * Run the deductions on sstate in place, until it is solved, found to
+ * be wrong, or none of them can make any more progress.
+ */
+static void solve_game_rec(solver_state *sstate)
 {
-    solver_state *sstate;
-
-    /* Index of the solver we should call next. */
-    int i = 0;
-    
-    /* As a speed-optimisation, we avoid re-running solvers that we know
-     * won't make any progress.  This happens when a high-difficulty
+    /*
+     * Bit i of `pending' is set while solver i is worth running. We
+     * always run the earliest (cheapest) pending solver; if it makes
+     * no progress it is dropped, and if it does, the set is refilled.
+     *
+     * As a speed-optimisation, the refill leaves out solvers that we
+     * know won't make any progress.  This happens when a high-difficulty
      * solver makes a deduction that can only help other high-difficulty
      * solvers.
      * For example: if a new 'dline' flag is set by dline_deductions, the
@@ -2583,40 +2811,33 @@ static solver_state *solve_game_rec(const solver_state *sstate_start)
      * If we've already run the trivial_deductions solver (because it's
      * earlier in the list), there's no point running it again.
      *
-     * Therefore: if a solver is earlier in the list than "threshold_index",
-     * we don't bother running it if it's difficulty level is less than
-     * "threshold_diff".
+     * Therefore: a solver earlier in the list than the one that made
+     * progress only goes back in if its difficulty level is at least
+     * the one the deduction was reported at.
      */
-    int threshold_diff = 0;
-    int threshold_index = 0;
-    
-    sstate = dup_solver_state(sstate_start);
-
-    while (i < NUM_SOLVERS) {
-        if (sstate->solver_status == SOLVER_MISTAKE)
-            return sstate;
-        if (sstate->solver_status == SOLVER_SOLVED ||
-            sstate->solver_status == SOLVER_AMBIGUOUS) {
-            /* solver finished */
-            break;
-        }
+    unsigned eligible = 0, pending;
+    int i, j;
 
-        if ((solver_diffs[i] >= threshold_diff || i >= threshold_index)
-            && solver_diffs[i] <= sstate->diff) {
-            /* current_solver is eligible, so use it */
-            int next_diff = solver_fns[i](sstate);
-            if (next_diff != DIFF_MAX) {
-                /* solver made progress, so use new thresholds and
-                * start again at top of list. */
-                threshold_diff = next_diff;
-                threshold_index = i;
-                i = 0;
-                continue;
-            }
+    for (i = 0; i < NUM_SOLVERS; i++)
+        if (solver_diffs[i] <= sstate->diff)
+            eligible |= 1U << i;
+    pending = eligible;
+
+    while (pending && sstate->solver_status == SOLVER_INCOMPLETE) {
+        int next_diff;
+
+        for (i = 0; !(pending & (1U << i)); i++)
+            continue;
+
+        next_diff = solver_fns[i](sstate);
+        if (next_diff == DIFF_MAX) {
+            pending &= ~(1U << i);
+        } else {
+            pending = eligible & ~((1U << i) - 1);
+            for (j = 0; j < i; j++)
+                if (solver_diffs[j] >= next_diff)
+                    pending |= eligible & (1U << j);
         }
-        /* current_solver is ineligible, or failed to make progress, so
-         * go to the next solver in the list */
-        i++;
     }
 
     if (sstate->solver_status == SOLVER_SOLVED ||
@@ -2624,37 +2845,123 @@ static solver_state *solve_game_rec(const solver_state *sstate_start)
         /* s/LINE_UNKNOWN/LINE_NO/g */
         array_setall(sstate->state->lines, LINE_UNKNOWN, LINE_NO,
                      sstate->state->game_grid->num_edges);
-        return sstate;
     }
-
-    return sstate;
 }
 
 static char *solve_game(const game_state *state, const game_state *currstate,
                         const char *aux, const char **error)
 {
     char *soln = NULL;
-    solver_state *sstate, *new_sstate;
+    solver_state *sstate;
 
     sstate = new_solver_state(state, DIFF_MAX);
-    new_sstate = solve_game_rec(sstate);
+    solve_game_rec(sstate);
 
-    if (new_sstate->solver_status == SOLVER_SOLVED) {
-        soln = encode_solve_move(new_sstate->state);
-    } else if (new_sstate->solver_status == SOLVER_AMBIGUOUS) {
-        soln = encode_solve_move(new_sstate->state);
+    if (sstate->solver_status == SOLVER_SOLVED) {
+        soln = encode_solve_move(sstate->state);
+    } else if (sstate->solver_status == SOLVER_AMBIGUOUS) {
+        soln = encode_solve_move(sstate->state);
         /**error = "Solver found ambiguous solutions"; */
     } else {
-        soln = encode_solve_move(new_sstate->state);
+        soln = encode_solve_move(sstate->state);
         /**error = "Solver failed"; */
     }
 
-    free_solver_state(new_sstate);
     free_solver_state(sstate);
 
     return soln;
 }
 
+/*
+ * Solve the puzzle from its clues alone, recording the order of the
+ * deductions in the hint cache.
+ */
+static bool hint_setup(const game_state *state, game_ui *ui)
+{
+    int i, n = state->game_grid->num_edges, norder;
+    game_state *blank = dup_game(state);
+    solver_state *sstate;
+    bool ret;
+
+    memset(blank->lines, LINE_UNKNOWN, n);
+    sstate = new_solver_state(blank, DIFF_MAX);
+    free_game(blank);
+
+    ui->order = snewn(n, int);
+    sstate->trace = ui->order;
+    solve_game_rec(sstate);
+    norder = sstate->ntrace;
+
+    ret = sstate->solver_status == SOLVER_SOLVED;
+    if (ret) {
+        ui->soln = snewn(n, char);
+        memcpy(ui->soln, sstate->state->lines, n);
+        ui->rank = snewn(n, int);
+        for (i = 0; i < n; i++)
+            ui->rank[i] = -1;
+        for (i = 0; i < norder; i++)
+            ui->rank[ui->order[i]] = i;
+        /* Lines the solver only ruled out once the loop was complete */
+        for (i = 0; i < n; i++)
+            if (ui->rank[i] < 0) {
+                ui->rank[i] = norder;
+                ui->order[norder++] = i;
+            }
+
+        ui->hintpos = ui->nwrong = 0;
+        for (i = 0; i < n; i++)
+            if (state->lines[i] != LINE_UNKNOWN &&
+                state->lines[i] != ui->soln[i])
+                ui->nwrong++;
+    } else {
+        sfree(ui->order);
+        ui->order = NULL;
+    }
+
+    free_solver_state(sstate);
+    return ret;
+}
+
+/*
+ * The next hint is the first deduction in solver order that the
+ * player has not yet made. Everything before it is already on the
+ * board, so it follows from what the player can see. A line that
+ * contradicts the solution is cleared first.
+ */
+static char *hint_game(const game_state *state, game_ui *ui,
+                       const char **error)
+{
+    int i, n = state->game_grid->num_edges;
+    char buf[80];
+
+    if (!ui->soln && !hint_setup(state, ui)) {
+        *error = "Solver could not find a unique solution";
+        return NULL;
+    }
+
+    if (ui->nwrong > 0) {
+        for (i = 0; i < n; i++)
+            if (state->lines[i] != LINE_UNKNOWN &&
+                state->lines[i] != ui->soln[i]) {
+                sprintf(buf, "%du", i);
+                return dupstr(buf);
+            }
+    }
+
+    while (ui->hintpos < n &&
+           state->lines[ui->order[ui->hintpos]] ==
+           ui->soln[ui->order[ui->hintpos]])
+        ui->hintpos++;
+    if (ui->hintpos == n) {
+        *error = "Puzzle is already solved";
+        return NULL;
+    }
+
+    i = ui->order[ui->hintpos];
+    sprintf(buf, "%d%c", i, ui->soln[i] == LINE_YES ? 'y' : 'n');
+    return dupstr(buf);
+}
+
 /* ----------------------------------------------------------------------
  * Drawing and mouse-handling
  */
@@ -2807,10 +3114,10 @@ static char *interpret_move(const game_state *state, game_ui *ui,
     return sresize(movebuf, movelen+1, char);
 }
 
-static game_state *execute_move(const game_state *state, const game_ui *ui, const char *move)
+static bool execute_move_in_place(game_state *newstate, const game_ui *ui,
+                                  const char *move)
 {
     int i;
-    game_state *newstate = dup_game(state);
 
     newstate->cheated = newstate->solved = false;
     if (move[0] == 'S') {
@@ -2819,10 +3126,9 @@ static game_state *execute_move(const game_state *state, const game_ui *ui, cons
     }
 
     while (*move) {
-        i = atoi(move);
-        if (i < 0 || i >= newstate->game_grid->num_edges)
-            goto fail;
-        move += strspn(move, "1234567890");
+        if (!move_read_int(&move, &i) ||
+            i < 0 || i >= newstate->game_grid->num_edges)
+            return false;
         switch (*(move++)) {
           case 'y':
             newstate->lines[i] = LINE_YES;
@@ -2834,7 +3140,7 @@ static game_state *execute_move(const game_state *state, const game_ui *ui, cons
             newstate->lines[i] = LINE_UNKNOWN;
             break;
           default:
-            goto fail;
+            return false;
         }
     }
 
@@ -2843,11 +3149,18 @@ static game_state *execute_move(const game_state *state, const game_ui *ui, cons
      */
     newstate->solved = check_completion(newstate);
 
-    return newstate;
+    return true;
+}
 
-    fail:
-    free_game(newstate);
-    return NULL;
+static game_state *execute_move(const game_state *state, const game_ui *ui, const char *move)
+{
+    game_state *newstate = dup_game(state);
+
+    if (!execute_move_in_place(newstate, ui, move)) {
+        free_game(newstate);
+        return NULL;
+    }
+    return newstate;
 }
 
 /* ----------------------------------------------------------------------
@@ -3336,6 +3649,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    hint_game,
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -3347,6 +3661,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    execute_move_in_place,
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -3359,6 +3674,6 @@ const struct game thegame = {
     false, false, NULL, NULL,  /* print_size, print */
     true,                      /* wants_statusbar */
     false, NULL,               /* timing_state */
-    REQUIRE_RBUTTON,           /* flags */
+    REQUIRE_RBUTTON | UNDO_KEYFRAMES, /* flags */
 };
 
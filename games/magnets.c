@@ -1939,7 +1939,9 @@ static void draw_tile(drawing *dr, game_drawstate *ds, int *dominoes,
 
     draw_tile_col(dr, ds, dominoes, x, y, which, bg, fg, perc);
 
-    draw_update(dr, cx, cy, TILE_SIZE, TILE_SIZE);
+    /* The join to the other half of a domino reaches one pixel into
+     * the square to the right or below. */
+    draw_update(dr, cx, cy, TILE_SIZE+1, TILE_SIZE+1);
 }
 
 static int get_count_color(const game_state *state, int rowcol, int which,
@@ -2077,6 +2079,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2088,6 +2091,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
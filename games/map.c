@@ -795,6 +795,11 @@ struct solver_scratch {
     int *bfscolour;
 
     int depth;
+
+    /* If non-NULL, every region coloured by place_colour is appended
+     * here, recording the order in which the deductions were made. */
+    int *trace;
+    int ntrace;
 };
 
 static struct solver_scratch *new_scratch(int *graph, int n, int ngraph)
@@ -809,6 +814,8 @@ static struct solver_scratch *new_scratch(int *graph, int n, int ngraph)
     sc->depth = 0;
     sc->bfsqueue = snewn(n, int);
     sc->bfscolour = snewn(n, int);
+    sc->trace = NULL;
+    sc->ntrace = 0;
 
     return sc;
 }
@@ -841,6 +848,8 @@ static bool place_colour(struct solver_scratch *sc,
         return false;               /* can't do it */
     }
 
+    if (sc->trace && colouring[index] < 0)
+        sc->trace[sc->ntrace++] = index;
     sc->possible[index] = 1 << colour;
     colouring[index] = colour;
 
@@ -2038,6 +2047,18 @@ struct game_ui {
     int highlight_region;
     bool marks_button;
     int marks_action;
+
+    /*
+     * Hint cache, filled in by the first hint request: the solved
+     * colouring, every region in the order the solver deduced it,
+     * and each region's position in that order.
+     */
+    int *soln;
+    int *order, *rank;
+    /* All order[] entries before hintpos are coloured correctly. */
+    int hintpos;
+    /* Number of regions currently coloured contrary to soln. */
+    int nwrong;
 };
 
 static game_ui *new_ui(const game_state *state)
@@ -2049,11 +2070,17 @@ static game_ui *new_ui(const game_state *state)
     ui->highlight_region = -1;
     ui->marks_button = true;
     ui->marks_action = 1;
+    ui->soln = NULL;
+    ui->order = ui->rank = NULL;
+    ui->hintpos = ui->nwrong = 0;
     return ui;
 }
 
 static void free_ui(game_ui *ui)
 {
+    sfree(ui->soln);
+    sfree(ui->order);
+    sfree(ui->rank);
     sfree(ui);
 }
 
@@ -2106,6 +2133,117 @@ static void set_prefs(game_ui *ui, const config_item *cfg)
 static void game_changed_state(game_ui *ui, const game_state *oldstate,
                                const game_state *newstate)
 {
+    int i, n = newstate->p.n;
+
+    if (!ui->soln)
+        return;
+
+    /*
+     * Keep the hint cache in step with the move, so that the next
+     * hint only has to look at what changed.
+     */
+    for (i = 0; i < n; i++) {
+        int was = oldstate->colouring[i], now = newstate->colouring[i];
+        if (was == now)
+            continue;
+        if (was >= 0 && was != ui->soln[i])
+            ui->nwrong--;
+        if (now >= 0 && now != ui->soln[i])
+            ui->nwrong++;
+        if (now != ui->soln[i] && ui->rank[i] < ui->hintpos)
+            ui->hintpos = ui->rank[i];
+    }
+}
+
+/*
+ * Solve the puzzle from its clues alone, recording the order of the
+ * deductions in the hint cache.
+ */
+static bool hint_setup(const game_state *state, game_ui *ui)
+{
+    int i, n = state->p.n, norder;
+    struct solver_scratch *sc;
+    int *colouring;
+    bool ret;
+
+    colouring = snewn(n, int);
+    for (i = 0; i < n; i++)
+        colouring[i] = state->map->immutable[i] ? state->colouring[i] : -1;
+
+    ui->order = snewn(n, int);
+    sc = new_scratch(state->map->graph, n, state->map->ngraph);
+    sc->trace = ui->order;
+    ret = map_solver(sc, state->map->graph, n, state->map->ngraph,
+                     colouring, DIFFCOUNT-1) == 1;
+    norder = sc->ntrace;
+    free_scratch(sc);
+
+    if (ret) {
+        ui->soln = colouring;
+        ui->rank = snewn(n, int);
+        for (i = 0; i < n; i++)
+            ui->rank[i] = -1;
+        for (i = 0; i < norder; i++)
+            ui->rank[ui->order[i]] = i;
+        /* Clues, and regions only coloured by a recursive guess */
+        for (i = 0; i < n; i++)
+            if (ui->rank[i] < 0) {
+                ui->rank[i] = norder;
+                ui->order[norder++] = i;
+            }
+
+        ui->hintpos = ui->nwrong = 0;
+        for (i = 0; i < n; i++)
+            if (state->colouring[i] >= 0 &&
+                state->colouring[i] != ui->soln[i])
+                ui->nwrong++;
+    } else {
+        sfree(colouring);
+        sfree(ui->order);
+        ui->order = NULL;
+    }
+
+    return ret;
+}
+
+/*
+ * The next hint is the first region in solver order that the player
+ * has not yet coloured, so it follows from the colours already on
+ * the board. A region coloured contrary to the solution is cleared
+ * first.
+ */
+static char *hint_game(const game_state *state, game_ui *ui,
+                       const char **error)
+{
+    int i, n = state->p.n;
+    char buf[80];
+
+    if (!ui->soln && !hint_setup(state, ui)) {
+        *error = "Solver could not find a unique solution";
+        return NULL;
+    }
+
+    if (ui->nwrong > 0) {
+        for (i = 0; i < n; i++)
+            if (state->colouring[i] >= 0 &&
+                state->colouring[i] != ui->soln[i]) {
+                sprintf(buf, "C:%d", i);
+                return dupstr(buf);
+            }
+    }
+
+    while (ui->hintpos < n &&
+           state->colouring[ui->order[ui->hintpos]] ==
+           ui->soln[ui->order[ui->hintpos]])
+        ui->hintpos++;
+    if (ui->hintpos == n) {
+        *error = "Puzzle is already solved";
+        return NULL;
+    }
+
+    i = ui->order[ui->hintpos];
+    sprintf(buf, "%d:%d", ui->soln[i], i);
+    return dupstr(buf);
 }
 
 struct game_drawstate {
@@ -2583,7 +2721,7 @@ static void draw_square(drawing *dr, game_drawstate *ds,
             int x, int y, unsigned long v)
 {
     int w = params->w, h = params->h, wh = w*h;
-    int tv, bv, xo, yo;
+    int tv, bv, xo, yo, pad;
     unsigned long errs;
     bool highlighted, highlighted_adj;
     
@@ -2600,7 +2738,8 @@ static void draw_square(drawing *dr, game_drawstate *ds,
     /*
      * Draw the region colour.
      */
-    draw_textured_tile(dr, COORD(x), COORD(y), TILESIZE, TILESIZE, tv, highlighted);
+    draw_cached_tile(dr, draw_textured_tile, COORD(x), COORD(y),
+                     TILESIZE, TILESIZE, tv, highlighted);
 
     /*
      * Draw the second region colour, if this is a diagonally
@@ -2656,7 +2795,14 @@ static void draw_square(drawing *dr, game_drawstate *ds,
                (COORD(x)*2+TILESIZE*xo)/2,
                (COORD(y)*2+TILESIZE*yo)/2);
 
-    draw_update(dr, COORD(x), COORD(y), TILESIZE, TILESIZE);
+    /*
+     * Borders and the diagonal reach a little way into the adjacent
+     * squares, and error markers on an edge or corner reach across
+     * it, so update those parts of the neighbours too.
+     */
+    pad = errs ? TILESIZE*2/5 + 1 : 2;
+    draw_update(dr, COORD(x) - pad, COORD(y) - pad,
+                TILESIZE + 2*pad, TILESIZE + 2*pad);
 }
 
 static void draw_textured_pencil(drawing *dr, int x, int y, int w, int h, int pencils) {
@@ -2873,6 +3019,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    hint_game,
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     true, get_prefs, set_prefs,
     new_ui,
@@ -2884,6 +3031,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     20, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -2667,6 +2667,10 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
         coords[1] = COORD(0) - OUTER_HIGHLIGHT_WIDTH;
         coords[0] = COORD(0) - OUTER_HIGHLIGHT_WIDTH;
         draw_polygon(dr, coords, 5, COL_LOWLIGHT, COL_LOWLIGHT);
+        draw_update(dr, COORD(0) - OUTER_HIGHLIGHT_WIDTH,
+                    COORD(0) - OUTER_HIGHLIGHT_WIDTH,
+                    state->w * TILE_SIZE + 2 * OUTER_HIGHLIGHT_WIDTH,
+                    state->h * TILE_SIZE + 2 * OUTER_HIGHLIGHT_WIDTH);
 
         ds->started = true;
     }
@@ -2819,6 +2823,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     true, get_prefs, set_prefs,
     new_ui,
@@ -2830,6 +2835,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
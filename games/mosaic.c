@@ -1393,7 +1393,7 @@ static void draw_cell(drawing *dr, const game_ui *ui, int cell, int ts, signed c
         draw_text(dr, startX + ts/2, startY + ts/2, FONT_VARIABLE, ts * 3/5,
         ALIGN_VCENTRE | ALIGN_HCENTRE, text_color, clue);
     }
-    draw_update(dr, startX, startY, ts - 1, ts - 1);
+    draw_update(dr, startX - 1, startY - 1, ts + 1, ts + 1);
 }
 
 static void game_redraw(drawing *dr, game_drawstate *ds,
@@ -1474,6 +1474,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     true, get_prefs, set_prefs,
     new_ui,
@@ -1485,6 +1486,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     DEFAULT_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -436,9 +436,13 @@ static int todo_get(struct todo *todo) {
  * Return values: -1 means puzzle was proved inconsistent, 0 means we
  * failed to narrow down to a unique solution, +1 means we solved it
  * fully.
+ *
+ * If rank is non-NULL, rank[i] is set to the number of tiles pinned
+ * down before tile i, for each tile the solver narrows to a single
+ * orientation; entries for the other tiles are left alone.
  */
 static int net_solver(int w, int h, unsigned char *tiles,
-              unsigned char *barriers, bool wrapping)
+              unsigned char *barriers, bool wrapping, int *rank)
 {
     unsigned char *tilestate;
     unsigned char *edgestate;
@@ -446,7 +450,7 @@ static int net_solver(int w, int h, unsigned char *tiles,
     DSF *equivalence;
     struct todo *todo;
     int i, j, x, y;
-    int area;
+    int area, nranked = 0;
     bool done_something;
 
     /*
@@ -715,6 +719,8 @@ static int net_solver(int w, int h, unsigned char *tiles,
 
         if (j < i) {
         done_something = true;
+        if (j == 1 && rank)
+            rank[y*w+x] = nranked++;
 
         /*
          * We have ruled out at least one tile orientation.
@@ -1250,7 +1256,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     /*
      * Run the solver to check unique solubility.
      */
-    while (net_solver(w, h, tiles, NULL, params->wrapping) != 1) {
+    while (net_solver(w, h, tiles, NULL, params->wrapping, NULL) != 1) {
         int n = 0;
 
         /*
@@ -1683,7 +1689,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 
     memcpy(tiles, state->tiles, state->width * state->height);
     solver_result = net_solver(state->width, state->height, tiles,
-                                   state->imm->barriers, state->wrapping);
+                                   state->imm->barriers, state->wrapping, NULL);
 
         if (solver_result < 0) {
             *error = "No solution exists for this puzzle";
@@ -1914,6 +1920,18 @@ struct game_ui {
     int cx, cy;       /* source tile (game coordinates) */
     random_state *rs; /* used for jumbling */
     bool use_locking;
+
+    /*
+     * Hint cache, filled in by the first hint request: the solved
+     * tile orientations, every tile in the order the solver pinned
+     * it down, and each tile's position in that order.
+     */
+    unsigned char *soln;
+    int *order, *rank;
+    /* All order[] entries before hintpos are oriented correctly. */
+    int hintpos;
+    /* Number of tiles currently locked in a wrong orientation. */
+    int nwrong;
 };
 
 static game_ui *new_ui(const game_state *state)
@@ -1925,6 +1943,9 @@ static game_ui *new_ui(const game_state *state)
     ui->cx = state->width / 2;
     ui->cy = state->height / 2;
     ui->use_locking = false;
+    ui->soln = NULL;
+    ui->order = ui->rank = NULL;
+    ui->hintpos = ui->nwrong = 0;
     get_random_seed(&seed, &seedsize);
     ui->rs = random_new(seed, seedsize);
     sfree(seed);
@@ -1935,6 +1956,9 @@ static game_ui *new_ui(const game_state *state)
 static void free_ui(game_ui *ui)
 {
     random_free(ui->rs);
+    sfree(ui->soln);
+    sfree(ui->order);
+    sfree(ui->rank);
     sfree(ui);
 }
 
@@ -1968,8 +1992,126 @@ static key_label *game_request_keys(const game_params *params, const game_ui *ui
     return keys;
 }
 
+#define TILE_WRONG(ui, t, i) \
+    (((t) & LOCKED) && ((t) & 0xF) != (ui)->soln[i])
+
 static void game_changed_state(game_ui *ui, const game_state *oldstate,
                                const game_state *newstate) {
+    int i, n = newstate->width * newstate->height;
+
+    if (!ui->soln)
+        return;
+
+    /*
+     * Keep the hint cache in step with the move, so that the next
+     * hint only has to look at what changed.
+     */
+    for (i = 0; i < n; i++) {
+        unsigned char was = oldstate->tiles[i], now = newstate->tiles[i];
+        if (was == now)
+            continue;
+        if (TILE_WRONG(ui, was, i))
+            ui->nwrong--;
+        if (TILE_WRONG(ui, now, i))
+            ui->nwrong++;
+        if ((now & 0xF) != ui->soln[i] && ui->rank[i] < ui->hintpos)
+            ui->hintpos = ui->rank[i];
+    }
+}
+
+/*
+ * Solve the puzzle, recording the order in which the tiles were
+ * pinned down in the hint cache.
+ */
+static bool hint_setup(const game_state *state, game_ui *ui)
+{
+    int i, n = state->width * state->height, norder;
+    unsigned char *tiles;
+    bool ret;
+
+    tiles = snewn(n, unsigned char);
+    memcpy(tiles, state->tiles, n);
+    ui->rank = snewn(n, int);
+    for (i = 0; i < n; i++)
+        ui->rank[i] = -1;
+
+    ret = net_solver(state->width, state->height, tiles,
+                     state->imm->barriers, state->wrapping, ui->rank) == 1;
+
+    if (ret) {
+        ui->soln = snewn(n, unsigned char);
+        ui->order = snewn(n, int);
+        norder = 0;
+        for (i = 0; i < n; i++) {
+            ui->soln[i] = tiles[i] & 0xF;
+            if (ui->rank[i] >= 0) {
+                ui->order[ui->rank[i]] = i;
+                norder++;
+            }
+        }
+        /* Tiles that look the same whichever way round they are */
+        for (i = 0; i < n; i++)
+            if (ui->rank[i] < 0) {
+                ui->rank[i] = norder;
+                ui->order[norder++] = i;
+            }
+
+        ui->hintpos = ui->nwrong = 0;
+        for (i = 0; i < n; i++)
+            if (TILE_WRONG(ui, state->tiles[i], i))
+                ui->nwrong++;
+    } else {
+        sfree(ui->rank);
+        ui->rank = NULL;
+    }
+
+    sfree(tiles);
+    return ret;
+}
+
+/*
+ * The next hint turns and locks the first tile in solver order that
+ * is not already the right way round, so it follows from the tiles
+ * before it. A tile locked the wrong way round is unlocked first.
+ */
+static char *hint_game(const game_state *state, game_ui *ui,
+                       const char **error)
+{
+    int i, n = state->width * state->height;
+    int x, y, ft, tt;
+    char buf[80];
+
+    if (!ui->soln && !hint_setup(state, ui)) {
+        *error = "Solver could not find a unique solution";
+        return NULL;
+    }
+
+    if (ui->nwrong > 0) {
+        for (i = 0; i < n; i++)
+            if (TILE_WRONG(ui, state->tiles[i], i)) {
+                sprintf(buf, "L%d,%d", i % state->width, i / state->width);
+                return dupstr(buf);
+            }
+    }
+
+    while (ui->hintpos < n &&
+           (state->tiles[ui->order[ui->hintpos]] & 0xF) ==
+           ui->soln[ui->order[ui->hintpos]])
+        ui->hintpos++;
+    if (ui->hintpos == n) {
+        *error = "Puzzle is already solved";
+        return NULL;
+    }
+
+    i = ui->order[ui->hintpos];
+    x = i % state->width;
+    y = i / state->width;
+    ft = state->tiles[i] & 0xF;
+    tt = ui->soln[i];
+    /* Not locked, or it would have counted as wrong above */
+    sprintf(buf, "%c%d,%d;L%d,%d",
+            tt == A(ft) ? 'A' : tt == C(ft) ? 'C' : 'F', x, y, x, y);
+    return dupstr(buf);
 }
 
 static const char *current_key_label(const game_ui *ui,
@@ -2102,13 +2244,13 @@ static char *interpret_move(const game_state *state, game_ui *ui,
     }
 }
 
-static game_state *execute_move(const game_state *from, const game_ui *ui, const char *move)
+static bool execute_move_in_place(game_state *ret, const game_ui *ui,
+                                  const char *move)
 {
-    game_state *ret;
-    int tx = -1, ty = -1, n, orig;
+    int tx = -1, ty = -1, orig, r;
     bool noanim;
+    move_item it;
 
-    ret = dup_game(from);
     ret->used_solve = ret->completed = false;
 
     if (move[0] == 'J' || move[0] == 'S') {
@@ -2122,38 +2264,37 @@ static game_state *execute_move(const game_state *from, const game_ui *ui, const
     ret->last_rotate_dir = 0;           /* suppress animation */
     ret->last_rotate_x = ret->last_rotate_y = 0;
 
-    while (*move) {
-        if ((move[0] == 'A' || move[0] == 'C' ||
-             move[0] == 'F' || move[0] == 'L') &&
-            sscanf(move+1, "%d,%d%n", &tx, &ty, &n) >= 2 &&
-            tx >= 0 && tx < from->width && ty >= 0 && ty < from->height) {
-            orig = tile(ret, tx, ty);
-            if (move[0] == 'A') {
-                tile(ret, tx, ty) = A(orig);
-                if (!noanim)
-                    ret->last_rotate_dir = +1;
-            } else if (move[0] == 'F') {
-                tile(ret, tx, ty) = F(orig);
-                if (!noanim)
-                    ret->last_rotate_dir = +2; /* + for sake of argument */
-            } else if (move[0] == 'C') {
-                tile(ret, tx, ty) = C(orig);
-                if (!noanim)
-                    ret->last_rotate_dir = -1;
-            } else {
-                assert(move[0] == 'L');
-                tile(ret, tx, ty) ^= LOCKED;
-            }
-
-            move += 1 + n;
-            if (*move == ';') move++;
+    while ((r = move_next_item(&move, &it)) > 0) {
+        if ((it.c != 'A' && it.c != 'C' && it.c != 'F' && it.c != 'L') ||
+            it.nargs != 2)
+            return false;
+        tx = it.args[0];
+        ty = it.args[1];
+        if (tx < 0 || tx >= ret->width || ty < 0 || ty >= ret->height)
+            return false;
+
+        orig = tile(ret, tx, ty);
+        if (it.c == 'A') {
+            tile(ret, tx, ty) = A(orig);
+            if (!noanim)
+                ret->last_rotate_dir = +1;
+        } else if (it.c == 'F') {
+            tile(ret, tx, ty) = F(orig);
+            if (!noanim)
+                ret->last_rotate_dir = +2; /* + for sake of argument */
+        } else if (it.c == 'C') {
+            tile(ret, tx, ty) = C(orig);
+            if (!noanim)
+                ret->last_rotate_dir = -1;
         } else {
-            free_game(ret);
-            return NULL;
+            assert(it.c == 'L');
+            tile(ret, tx, ty) ^= LOCKED;
         }
     }
+    if (r < 0)
+        return false;
     if (!noanim) {
-        if (tx == -1 || ty == -1) { free_game(ret); return NULL; }
+        if (tx == -1 || ty == -1) return false;
         ret->last_rotate_x = tx;
         ret->last_rotate_y = ty;
     }
@@ -2190,6 +2331,17 @@ static game_state *execute_move(const game_state *from, const game_ui *ui, const
         ret->completed = true;
     }
 
+    return true;
+}
+
+static game_state *execute_move(const game_state *from, const game_ui *ui, const char *move)
+{
+    game_state *ret = dup_game(from);
+
+    if (!execute_move_in_place(ret, ui, move)) {
+        free_game(ret);
+        return NULL;
+    }
     return ret;
 }
 
@@ -2781,6 +2933,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    hint_game,
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2792,6 +2945,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    execute_move_in_place,
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -2804,6 +2958,6 @@ const struct game thegame = {
     false, false, NULL, NULL,  /* print_size, print */
     true,                      /* wants_statusbar */
     false, NULL,               /* timing_state */
-    REQUIRE_RBUTTON,           /* flags */
+    REQUIRE_RBUTTON | UNDO_KEYFRAMES, /* flags */
 };
 
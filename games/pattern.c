@@ -354,102 +354,155 @@ static int compute_rowdata(int *ret, unsigned char *start, int len, int step)
 #define DOT 2
 #define STILL_UNKNOWN 3
 
-static bool do_recurse(unsigned char *known, unsigned char *deduced,
-                       unsigned char *row,
-               unsigned char *minpos_done, unsigned char *maxpos_done,
-               unsigned char *minpos_ok, unsigned char *maxpos_ok,
-               int *data, int len,
-                       int freespace, int ndone, int lowest)
+/*
+ * The line solver. Rows are handled as bitmasks, bit i standing for
+ * square i, so a row can be at most LINE_MAXLEN squares long.
+ *
+ * For a row of len squares with clue runs data[0..nruns-1], bit i of
+ * fw[j] says whether the first j runs fit into the first i squares
+ * consistently with what we know about them, and bit i of bw[j]
+ * whether runs j onwards fit into the squares from i to the end. A
+ * square can be a DOT if, for some j, the first j runs fit before it
+ * and the others after it; it can be a BLOCK if some run can be
+ * placed over it with the runs before and after that one fitting on
+ * either side. This finds exactly the squares on which all possible
+ * placements agree - the same ones as trying every placement would -
+ * with a handful of word operations per run.
+ */
+#define LINE_MAXLEN 31
+
+struct line_solver {
+    unsigned char *known, *deduced;
+    unsigned int *fw, *bw;
+};
+
+static struct line_solver *line_solver_new(int max)
 {
-    int i, j, k;
+    struct line_solver *ls = snew(struct line_solver);
+
+    assert(max <= LINE_MAXLEN);
+    ls->known = snewn(max, unsigned char);
+    ls->deduced = snewn(max, unsigned char);
+    ls->fw = snewn(max/2 + 2, unsigned int);
+    ls->bw = snewn(max/2 + 2, unsigned int);
+    return ls;
+}
 
+static void line_solver_free(struct line_solver *ls)
+{
+    sfree(ls->known);
+    sfree(ls->deduced);
+    sfree(ls->fw);
+    sfree(ls->bw);
+    sfree(ls);
+}
 
-    /* This algorithm basically tries all possible ways the given rows of
-     * black blocks can be laid out in the row/column being examined.
-     * Special care is taken to avoid checking the tail of a row/column
-     * if the same conditions have already been checked during this recursion
-     * The algorithm also takes care to cut its losses as soon as an
-     * invalid (partial) solution is detected.
-     */
-    if (data[ndone]) {
-    if (lowest >= minpos_done[ndone] && lowest <= maxpos_done[ndone]) {
-        if (lowest >= minpos_ok[ndone] && lowest <= maxpos_ok[ndone]) {
-        for (i=0; i<lowest; i++)
-            deduced[i] |= row[i];
-        }
-        return lowest >= minpos_ok[ndone] && lowest <= maxpos_ok[ndone];
-    } else {
-        if (lowest < minpos_done[ndone]) minpos_done[ndone] = lowest;
-        if (lowest > maxpos_done[ndone]) maxpos_done[ndone] = lowest;
-    }
-    for (i=0; i<=freespace; i++) {
-        j = lowest;
-        for (k=0; k<i; k++) {
-        if (known[j] == BLOCK) goto next_iter;
-            row[j++] = DOT;
-        }
-        for (k=0; k<data[ndone]; k++) {
-        if (known[j] == DOT) goto next_iter;
-            row[j++] = BLOCK;
-        }
-        if (j < len) {
-        if (known[j] == BLOCK) goto next_iter;
-            row[j++] = DOT;
-        }
-        if (do_recurse(known, deduced, row, minpos_done, maxpos_done,
-                       minpos_ok, maxpos_ok, data, len, freespace-i, ndone+1, j)) {
-            if (lowest < minpos_ok[ndone]) minpos_ok[ndone] = lowest;
-            if (lowest + i > maxpos_ok[ndone]) maxpos_ok[ndone] = lowest + i;
-            if (lowest + i > maxpos_done[ndone]) maxpos_done[ndone] = lowest + i;
-        }
-        next_iter:
-        j++;
+/*
+ * Return the positions reachable from those in x by stepping from
+ * position p to p+1 (up) or p-1 (down) across squares in open.
+ */
+static unsigned int line_fill_up(unsigned int x, unsigned int open)
+{
+    int shift;
+
+    for (shift = 1; shift <= LINE_MAXLEN; shift <<= 1) {
+        x |= (x & open) << shift;
+        open &= open >> shift;
     }
-    return lowest >= minpos_ok[ndone] && lowest <= maxpos_ok[ndone];
-    } else {
-    for (i=lowest; i<len; i++) {
-        if (known[i] == BLOCK) return false;
-        row[i] = DOT;
-        }
-    for (i=0; i<len; i++)
-        deduced[i] |= row[i];
-    return true;
+    return x;
+}
+
+static unsigned int line_fill_down(unsigned int x, unsigned int open)
+{
+    int shift;
+
+    for (shift = 1; shift <= LINE_MAXLEN; shift <<= 1) {
+        x |= (x >> shift) & open;
+        open &= open >> shift;
     }
+    return x;
 }
 
+static void solve_line(struct line_solver *ls, int len, int *data, int nruns)
+{
+    unsigned char *known = ls->known, *deduced = ls->deduced;
+    unsigned int *fw = ls->fw, *bw = ls->bw;
+    unsigned int cells = (1U << len) - 1;
+    unsigned int positions = (2U << len) - 1;  /* 0 to len inclusive */
+    unsigned int block = 0, dot = 0, open;
+    unsigned int candot, canblock;
+    int i, j, t;
 
-static bool do_row(unsigned char *known, unsigned char *deduced,
-                   unsigned char *row,
-                   unsigned char *minpos_done, unsigned char *maxpos_done,
-                   unsigned char *minpos_ok, unsigned char *maxpos_ok,
+    for (i = 0; i < len; i++) {
+        if (known[i] == BLOCK)
+            block |= 1U << i;
+        else if (known[i] == DOT)
+            dot |= 1U << i;
+    }
+    open = ~block & cells;
+
+    fw[0] = line_fill_up(1, open) & positions;
+    for (j = 0; j < nruns; j++) {
+        unsigned int starts, fits = ~dot & cells;
+
+        /* Where can run j start, not covering a DOT... */
+        for (t = 1; t < data[j]; t++)
+            fits &= fits >> 1;
+        fits &= (2U << (len - data[j])) - 1;
+        /* ... given where the runs before it can end? */
+        starts = (j == 0 ? fw[0] : (fw[j] & open) << 1) & fits;
+        fw[j+1] = line_fill_up(starts << data[j], open) & positions;
+    }
+
+    canblock = 0;
+    bw[nruns] = line_fill_down(1U << len, open);
+    for (j = nruns-1; j >= 0; j--) {
+        unsigned int starts, fits = ~dot & cells;
+
+        for (t = 1; t < data[j]; t++)
+            fits &= fits >> 1;
+        fits &= (2U << (len - data[j])) - 1;
+        /* Where can run j start, given where the runs after it can? */
+        starts = (j == nruns-1 ? bw[nruns] : (bw[j+1] >> 1) & open);
+        starts = (starts >> data[j]) & fits;
+        bw[j] = line_fill_down(starts, open);
+
+        /* Those of them that also suit the runs before it are real. */
+        starts &= (j == 0 ? fw[0] : (fw[j] & open) << 1);
+        for (t = 0; t < data[j]; t++)
+            canblock |= starts << t;
+    }
+
+    candot = 0;
+    for (j = 0; j <= nruns; j++)
+        candot |= fw[j] & (bw[j] >> 1);
+    candot &= open;
+
+    for (i = 0; i < len; i++)
+        deduced[i] = (canblock & (1U << i) ? BLOCK : 0) |
+            (candot & (1U << i) ? DOT : 0);
+}
+
+static bool do_row(struct line_solver *ls,
                    unsigned char *start, int len, int step, int *data,
                    unsigned int *changed
                    )
 {
-    int rowlen, i, freespace;
+    unsigned char *known = ls->known, *deduced = ls->deduced;
+    int rowlen, i;
     bool done_any;
 
-    freespace = len+1;
-    for (rowlen = 0; data[rowlen]; rowlen++) {
-        minpos_done[rowlen] = minpos_ok[rowlen] = len - 1;
-        maxpos_done[rowlen] = maxpos_ok[rowlen] = 0;
-        freespace -= data[rowlen]+1;
-    }
+    for (rowlen = 0; data[rowlen]; rowlen++);
 
-    for (i = 0; i < len; i++) {
+    for (i = 0; i < len; i++)
         known[i] = start[i*step];
-        deduced[i] = 0;
-    }
-    for (i = len - 1; i >= 0 && known[i] == DOT; i--)
-        freespace--;
 
     if (rowlen == 0) {
         memset(deduced, DOT, (unsigned int)len);
     } else if (rowlen == 1 && data[0] == len) {
         memset(deduced, BLOCK, (unsigned int)len);
     } else {
-        do_recurse(known, deduced, row, minpos_done, maxpos_done, minpos_ok,
-                   maxpos_ok, data, len, freespace, 0, 0);
+        solve_line(ls, len, data, rowlen);
     }
 
     done_any = false;
@@ -464,10 +517,9 @@ static bool do_row(unsigned char *known, unsigned char *deduced,
 
 static bool solve_puzzle(const game_state *state, unsigned char *grid,
                          int w, int h,
-                         unsigned char *matrix, unsigned char *workspace,
+                         unsigned char *matrix, struct line_solver *ls,
                          unsigned int *changed_h, unsigned int *changed_w,
-                         int *rowdata,
-                         int dummy
+                         int *rowdata
                          )
 {
     int i, j, max;
@@ -562,11 +614,7 @@ static bool solve_puzzle(const game_state *state, unsigned char *grid,
             } else {
             rowdata[compute_rowdata(rowdata, grid+i*w, w, 1)] = 0;
             }
-            do_row(workspace, workspace+max, workspace+2*max,
-               workspace+3*max, workspace+4*max,
-               workspace+5*max, workspace+6*max,
-               matrix+i*w, w, 1, rowdata, changed_w
-               );
+            do_row(ls, matrix+i*w, w, 1, rowdata, changed_w);
             changed_h[i] = 0;
         }
         }
@@ -583,11 +631,7 @@ static bool solve_puzzle(const game_state *state, unsigned char *grid,
             } else {
             rowdata[compute_rowdata(rowdata, grid+i, h, w)] = 0;
             }
-            do_row(workspace, workspace+max, workspace+2*max,
-               workspace+3*max, workspace+4*max,
-               workspace+5*max, workspace+6*max,
-               matrix+i, h, w, rowdata, changed_h
-               );
+            do_row(ls, matrix+i, h, w, rowdata, changed_h);
             changed_w[i] = 0;
         }
         }
@@ -613,7 +657,8 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
 {
     int i, j, max;
     bool ok;
-    unsigned char *grid, *matrix, *workspace;
+    unsigned char *grid, *matrix;
+    struct line_solver *ls;
     unsigned int *changed_h, *changed_w;
     int *rowdata;
 
@@ -622,7 +667,7 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
     grid = snewn(w*h, unsigned char);
     /* Allocate this here, to avoid having to reallocate it again for every geneerated grid */
     matrix = snewn(w*h, unsigned char);
-    workspace = snewn(max*7, unsigned char);
+    ls = line_solver_new(max);
     changed_h = snewn(max+1, unsigned int);
     changed_w = snewn(max+1, unsigned int);
     rowdata = snewn(max+1, int);
@@ -658,12 +703,12 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
         if (!ok)
             continue;
 
-    ok = solve_puzzle(NULL, grid, w, h, matrix, workspace,
-              changed_h, changed_w, rowdata, 0);
+    ok = solve_puzzle(NULL, grid, w, h, matrix, ls,
+              changed_h, changed_w, rowdata);
     } while (!ok);
 
     sfree(matrix);
-    sfree(workspace);
+    line_solver_free(ls);
     sfree(changed_h);
     sfree(changed_w);
     sfree(rowdata);
@@ -954,7 +999,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     char *ret;
     int max;
     bool ok;
-    unsigned char *workspace;
+    struct line_solver *ls;
     unsigned int *changed_h, *changed_w;
     int *rowdata;
 
@@ -966,15 +1011,15 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 
     max = max(w, h);
     matrix = snewn(w*h, unsigned char);
-    workspace = snewn(max*7, unsigned char);
+    ls = line_solver_new(max);
     changed_h = snewn(max+1, unsigned int);
     changed_w = snewn(max+1, unsigned int);
     rowdata = snewn(max+1, int);
 
-    ok = solve_puzzle(state, NULL, w, h, matrix, workspace,
-              changed_h, changed_w, rowdata, 0);
+    ok = solve_puzzle(state, NULL, w, h, matrix, ls,
+              changed_h, changed_w, rowdata);
 
-    sfree(workspace);
+    line_solver_free(ls);
     sfree(changed_h);
     sfree(changed_w);
     sfree(rowdata);
@@ -1673,6 +1718,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -1684,6 +1730,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
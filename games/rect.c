@@ -311,14 +311,18 @@ static void remove_number_placement(int w, int h, struct numberdata *number,
  * Returns 0 for failure to solve due to inconsistency; 1 for
  * success; 2 for failure to complete a solution due to either
  * ambiguity or it being too difficult.
+ *
+ * If rank is non-NULL, rank[i] is set to the number of rectangles
+ * pinned to a single placement before rectangle i, for each one the
+ * solver pins down whose entry was still negative.
  */
 static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                        unsigned char *hedge, unsigned char *vedge,
-               random_state *rs)
+               random_state *rs, int *rank)
 {
     struct rectlist *rectpositions;
     int *overlaps, *rectbyplace, *workspace;
-    int i, ret;
+    int i, ret, nranked = 0;
 
     /*
      * Start by setting up a list of candidate positions for each
@@ -473,6 +477,15 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
     while (1) {
         bool done_something = false;
 
+        /*
+         * Note the rectangles which the last pass left with a
+         * single placement, in the order they got there.
+         */
+        if (rank)
+            for (i = 0; i < nrects; i++)
+                if (rectpositions[i].n == 1 && rank[i] < 0)
+                    rank[i] = nranked++;
+
         /*
          * Housekeeping. Look for rectangles whose number has only
          * one candidate position left, and mark that square as
@@ -1445,7 +1458,7 @@ static char *new_game_desc(const game_params *params_in, random_state *rs,
 
         if (params->unique)
         ret = rect_solver(params->w, params->h, nnumbers, nd,
-                  NULL, NULL, rs);
+                  NULL, NULL, rs, NULL);
         else
         ret = 1;           /* allow any number placement at all */
 
@@ -1760,23 +1773,15 @@ static void free_game(game_state *state)
     sfree(state);
 }
 
-static char *solve_game(const game_state *state, const game_state *currstate,
-                        const char *ai, const char **error)
+/*
+ * Set up each number's (very short) candidate position list, for
+ * running the solver on a real puzzle.
+ */
+static struct numberdata *new_numberdata(const game_state *state, int *nret)
 {
-    unsigned char *vedge, *hedge;
-    int x, y, len;
-    char *ret, *p;
-    int i, j, n;
     struct numberdata *nd;
+    int i, j, n;
 
-    if (ai)
-        return dupstr(ai);
-
-    /*
-     * Attempt the in-built solver.
-     */
-
-    /* Set up each number's (very short) candidate position list. */
     for (i = n = 0; i < state->h * state->w; i++)
         if (state->grid[i])
             n++;
@@ -1795,19 +1800,44 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 
     assert(j == n);
 
+    *nret = n;
+    return nd;
+}
+
+static void free_numberdata(struct numberdata *nd, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        sfree(nd[i].points);
+    sfree(nd);
+}
+
+static char *solve_game(const game_state *state, const game_state *currstate,
+                        const char *ai, const char **error)
+{
+    unsigned char *vedge, *hedge;
+    int x, y, len;
+    char *ret, *p;
+    int n;
+    struct numberdata *nd;
+
+    if (ai)
+        return dupstr(ai);
+
+    /*
+     * Attempt the in-built solver.
+     */
+    nd = new_numberdata(state, &n);
+
     vedge = snewn(state->w * state->h, unsigned char);
     hedge = snewn(state->w * state->h, unsigned char);
     memset(vedge, 0, state->w * state->h);
     memset(hedge, 0, state->w * state->h);
 
-    rect_solver(state->w, state->h, n, nd, hedge, vedge, NULL);
+    rect_solver(state->w, state->h, n, nd, hedge, vedge, NULL, NULL);
 
-    /*
-     * Clean up.
-     */
-    for (i = 0; i < n; i++)
-        sfree(nd[i].points);
-    sfree(nd);
+    free_numberdata(nd, n);
 
     len = 2 + (state->w-1)*state->h + (state->h-1)*state->w;
     ret = snewn(len, char);
@@ -1864,6 +1894,21 @@ struct game_ui {
     int y1;
     int x2;
     int y2;
+
+    /*
+     * Hint cache, filled in by the first hint request: the solved
+     * rectangles, the rectangle owning each square, every rectangle
+     * in the order the solver pinned it down, and each rectangle's
+     * position in that order.
+     */
+    struct rect *soln;
+    int *owner;
+    int *order, *rank;
+    int nrects;
+    /* All order[] rectangles before hintpos are fully outlined. */
+    int hintpos;
+    /* Number of edges currently drawn that the solution lacks. */
+    int nwrong;
 };
 
 static void reset_ui(game_ui *ui)
@@ -1884,11 +1929,18 @@ static game_ui *new_ui(const game_state *state)
     game_ui *ui = snew(game_ui);
     reset_ui(ui);
     ui->erasing = false;
+    ui->soln = NULL;
+    ui->owner = ui->order = ui->rank = NULL;
+    ui->nrects = ui->hintpos = ui->nwrong = 0;
     return ui;
 }
 
 static void free_ui(game_ui *ui)
 {
+    sfree(ui->soln);
+    sfree(ui->owner);
+    sfree(ui->order);
+    sfree(ui->rank);
     sfree(ui);
 }
 
@@ -2032,9 +2084,174 @@ static bool ui_draw_rect(const game_state *state, const game_ui *ui,
               ui->x1, ui->y1, ui->x2, ui->y2);
 }
 
+/*
+ * Account for the edge between squares a and b having just been
+ * drawn (now) or removed (!now).
+ */
+static void hint_edge_changed(game_ui *ui, bool now, int a, int b)
+{
+    int ra, rb;
+
+    if (ui->owner[a] == ui->owner[b]) {
+        ui->nwrong += now ? +1 : -1;
+    } else if (!now) {
+        ra = ui->rank[ui->owner[a]];
+        rb = ui->rank[ui->owner[b]];
+        if (ui->hintpos > min(ra, rb))
+            ui->hintpos = min(ra, rb);
+    }
+}
+
 static void game_changed_state(game_ui *ui, const game_state *oldstate,
                                const game_state *newstate)
 {
+    int x, y, i, w = newstate->w;
+
+    if (!ui->soln)
+        return;
+
+    /*
+     * Keep the hint cache in step with the move, so that the next
+     * hint only has to look at what changed.
+     */
+    for (y = 0; y < newstate->h; y++)
+        for (x = 0; x < w; x++) {
+            i = y*w+x;
+            if (y > 0 && oldstate->hedge[i] != newstate->hedge[i])
+                hint_edge_changed(ui, newstate->hedge[i], i-w, i);
+            if (x > 0 && oldstate->vedge[i] != newstate->vedge[i])
+                hint_edge_changed(ui, newstate->vedge[i], i-1, i);
+        }
+}
+
+/*
+ * Solve the puzzle, recording the order in which the rectangles
+ * were pinned down in the hint cache.
+ */
+static bool hint_setup(const game_state *state, game_ui *ui)
+{
+    int w = state->w, h = state->h;
+    unsigned char *vedge, *hedge;
+    struct numberdata *nd;
+    int i, n, x, y;
+    bool ret;
+
+    nd = new_numberdata(state, &n);
+    vedge = snewn(w * h, unsigned char);
+    hedge = snewn(w * h, unsigned char);
+    memset(vedge, 0, w * h);
+    memset(hedge, 0, w * h);
+    ui->rank = snewn(n, int);
+    for (i = 0; i < n; i++)
+        ui->rank[i] = -1;
+
+    ret = rect_solver(w, h, n, nd, hedge, vedge, NULL, ui->rank) == 1;
+
+    if (ret) {
+        ui->nrects = n;
+        ui->soln = snewn(n, struct rect);
+        ui->owner = snewn(w * h, int);
+        ui->order = snewn(n, int);
+        for (i = 0; i < n; i++) {
+            struct rect *r = &ui->soln[i];
+            int x1 = nd[i].points[0].x, y1 = nd[i].points[0].y;
+            int x2 = x1 + 1, y2 = y1 + 1;
+
+            /* Grow out from the number to the solved edges. */
+            while (x1 > 0 && !vedge[y1*w+x1]) x1--;
+            while (x2 < w && !vedge[y1*w+x2]) x2++;
+            while (y1 > 0 && !hedge[y1*w+x1]) y1--;
+            while (y2 < h && !hedge[y2*w+x1]) y2++;
+            r->x = x1;
+            r->y = y1;
+            r->w = x2 - x1;
+            r->h = y2 - y1;
+            for (y = y1; y < y2; y++)
+                for (x = x1; x < x2; x++)
+                    ui->owner[y*w+x] = i;
+
+            assert(ui->rank[i] >= 0);
+            ui->order[ui->rank[i]] = i;
+        }
+
+        ui->hintpos = ui->nwrong = 0;
+        for (y = 0; y < h; y++)
+            for (x = 0; x < w; x++) {
+                i = y*w+x;
+                if (y > 0 && state->hedge[i] && ui->owner[i-w] == ui->owner[i])
+                    ui->nwrong++;
+                if (x > 0 && state->vedge[i] && ui->owner[i-1] == ui->owner[i])
+                    ui->nwrong++;
+            }
+    } else {
+        sfree(ui->rank);
+        ui->rank = NULL;
+    }
+
+    free_numberdata(nd, n);
+    sfree(vedge);
+    sfree(hedge);
+    return ret;
+}
+
+static bool hint_rect_done(const game_state *state, const struct rect *r)
+{
+    int x, y;
+
+    for (x = r->x; x < r->x + r->w; x++)
+        if ((HRANGE(state,x,r->y) && !hedge(state,x,r->y)) ||
+            (HRANGE(state,x,r->y+r->h) && !hedge(state,x,r->y+r->h)))
+            return false;
+    for (y = r->y; y < r->y + r->h; y++)
+        if ((VRANGE(state,r->x,y) && !vedge(state,r->x,y)) ||
+            (VRANGE(state,r->x+r->w,y) && !vedge(state,r->x+r->w,y)))
+            return false;
+    return true;
+}
+
+/*
+ * The next hint outlines the first rectangle in solver order that
+ * is not outlined yet, so it follows from the rectangles before it.
+ * An edge the solution does not have is removed first.
+ */
+static char *hint_game(const game_state *state, game_ui *ui,
+                       const char **error)
+{
+    int x, y, i, w = state->w;
+    struct rect *r;
+    char buf[80];
+
+    if (!ui->soln && !hint_setup(state, ui)) {
+        *error = "Solver could not find a unique solution";
+        return NULL;
+    }
+
+    if (ui->nwrong > 0) {
+        for (y = 0; y < state->h; y++)
+            for (x = 0; x < w; x++) {
+                i = y*w+x;
+                if (y > 0 && state->hedge[i] && ui->owner[i-w] == ui->owner[i]) {
+                    sprintf(buf, "H%d,%d", x, y);
+                    return dupstr(buf);
+                }
+                if (x > 0 && state->vedge[i] && ui->owner[i-1] == ui->owner[i]) {
+                    sprintf(buf, "V%d,%d", x, y);
+                    return dupstr(buf);
+                }
+            }
+    }
+
+    while (ui->hintpos < ui->nrects &&
+           hint_rect_done(state, &ui->soln[ui->order[ui->hintpos]]))
+        ui->hintpos++;
+    if (ui->hintpos == ui->nrects) {
+        *error = "Puzzle is already solved";
+        return NULL;
+    }
+
+    r = &ui->soln[ui->order[ui->hintpos]];
+    sprintf(buf, "R%d,%d,%d,%d", r->x, r->y, r->w, r->h);
+    return dupstr(buf);
 }
 
 struct game_drawstate {
@@ -2349,7 +2566,7 @@ static void draw_tile(drawing *dr, game_drawstate *ds, const game_state *state,
         draw_rect(dr, cx+TILE_SIZE-1, cy+TILE_SIZE-1, EDGEW, EDGEW,
                   COLOUR(index(state,corners,x+1,y+1)));
 
-    draw_update(dr, cx-EDGEW/2, cy-EDGEW/2, TILE_SIZE+EDGEW/2, TILE_SIZE+EDGEW/2);
+    draw_update(dr, cx-EDGEW/2, cy-EDGEW/2, TILE_SIZE+EDGEW, TILE_SIZE+EDGEW);
 }
 
 static void game_redraw(drawing *dr, game_drawstate *ds,
@@ -2488,6 +2705,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    hint_game,
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2499,6 +2717,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
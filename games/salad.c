@@ -1986,7 +1986,8 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
             ds->grid[i] = state->grid[i];
             ds->marks[i] = state->marks[i];
             
-            draw_update(dr, tx, ty, TILE_SIZE, TILE_SIZE);
+            /* The outline below reaches from ty-1 down to ty+TILE_SIZE-1 */
+            draw_update(dr, tx, ty-1, TILE_SIZE+1, TILE_SIZE+1);
             
             draw_rect(dr, tx, ty, TILE_SIZE, TILE_SIZE, 
                 ds->gridfs[i] & FD_ERROR ? COL_E_BG : COL_BACKGROUND);
@@ -2067,7 +2068,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
             tx = (i+1)*TILE_SIZE;
             ty = 0;
             draw_rect(dr, tx, ty, TILE_SIZE-1, TILE_SIZE-1, color);
-            draw_update(dr, tx, ty, tx+TILE_SIZE-1, ty+TILE_SIZE-1);
+            draw_update(dr, tx, ty, TILE_SIZE-1, TILE_SIZE-1);
             buf[0] = state->borderclues[j] + base;
             draw_text(dr, tx + TILE_SIZE/2, ty + TILE_SIZE/2,
                 FONT_VARIABLE, TILE_SIZE/2, ALIGN_HCENTRE|ALIGN_VCENTRE, 
@@ -2083,7 +2084,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
             tx = 0;
             ty = (i+1)*TILE_SIZE;
             draw_rect(dr, tx, ty, TILE_SIZE-1, TILE_SIZE-1, color);
-            draw_update(dr, tx, ty, tx+TILE_SIZE-1, ty+TILE_SIZE-1);
+            draw_update(dr, tx, ty, TILE_SIZE-1, TILE_SIZE-1);
             buf[0] = state->borderclues[j] + base;
             draw_text(dr, tx + TILE_SIZE/2, ty + TILE_SIZE/2,
                 FONT_VARIABLE, TILE_SIZE/2, ALIGN_HCENTRE|ALIGN_VCENTRE, 
@@ -2099,7 +2100,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
             tx = (i+1)*TILE_SIZE;
             ty = (o+1)*TILE_SIZE;
             draw_rect(dr, tx, ty, TILE_SIZE-1, TILE_SIZE-1, color);
-            draw_update(dr, tx, ty, tx+TILE_SIZE-1, ty+TILE_SIZE-1);
+            draw_update(dr, tx, ty, TILE_SIZE-1, TILE_SIZE-1);
             buf[0] = state->borderclues[j] + base;
             draw_text(dr, tx + TILE_SIZE/2, ty + TILE_SIZE/2,
                 FONT_VARIABLE, TILE_SIZE/2, ALIGN_HCENTRE|ALIGN_VCENTRE, 
@@ -2115,7 +2116,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
             tx = (o+1)*TILE_SIZE;
             ty = (i+1)*TILE_SIZE;
             draw_rect(dr, tx+1, ty+1, TILE_SIZE-2, TILE_SIZE-2, color);
-            draw_update(dr, tx+1, ty+1, tx+TILE_SIZE-2, ty+TILE_SIZE-2);
+            draw_update(dr, tx+1, ty+1, TILE_SIZE-2, TILE_SIZE-2);
             buf[0] = state->borderclues[j] + base;
             draw_text(dr, tx + TILE_SIZE/2, ty + TILE_SIZE/2,
                 FONT_VARIABLE, TILE_SIZE/2, ALIGN_HCENTRE|ALIGN_VCENTRE, 
@@ -2170,6 +2171,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2181,6 +2183,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     DEFAULT_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -1207,8 +1207,8 @@ static void game_free_drawstate(drawing *dr, game_drawstate *ds)
  * both then we fill the teeny tiny square in the corner as well.
  */
 
-static void draw_textured_tile(drawing *dr, int x, int y, int w, int h, int col) {
-    clip(dr, x, y, w, h);
+static void draw_textured_tile(drawing *dr, int x, int y, int w, int h,
+                               int col, bool highlight) {
     if (col == 0) {
         draw_rect(dr, x, y, w, h, COL_BACKGROUND);
     }
@@ -1378,7 +1378,6 @@ static void draw_textured_tile(drawing *dr, int x, int y, int w, int h, int col)
         coords[4] = x+3*w/4;    coords[5] = y+h;
         draw_polygon(dr, coords, 3, COL_LIGHTGRAY, COL_LIGHTGRAY);
     } 
-    unclip(dr);
 }
 
 static void tile_redraw(drawing *dr, game_drawstate *ds,
@@ -1393,7 +1392,8 @@ static void tile_redraw(drawing *dr, game_drawstate *ds,
     if (dbelow) dsize = TILE_SIZE;
 
     if (col >= 0) {
-        draw_textured_tile(dr, COORD(x), COORD(y), rsize, dsize, col);
+        draw_cached_tile(dr, draw_textured_tile, COORD(x), COORD(y),
+                         rsize, dsize, col, false);
         if ((col > 0) && (tile & TILE_IMPOSSIBLE)) {
             draw_rect(dr, COORD(x)+rsize/4, COORD(y)+dsize/4, rsize/2, dsize/2, COL_IMPOSSIBLE);
         } else if (tile & TILE_SELECTED) {
@@ -1543,6 +1543,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     false, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -1554,6 +1555,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -1643,10 +1643,11 @@ static void tile_redraw(drawing *dr, game_drawstate *ds, int tx, int ty,
 
     /* Draw small triangle indicator if this tile is immutable */
     if (f & F_IMMUTABLE) {
+        /* Keep it inside the tile, clear of the neighbours' outlines */
         int coords[6];
-        coords[0] = tx+TILE_SIZE;     coords[1] = ty+7*TILE_SIZE/8;
-        coords[2] = tx+TILE_SIZE;     coords[3] = ty+TILE_SIZE;
-        coords[4] = tx+7*TILE_SIZE/8; coords[5] = ty+TILE_SIZE;
+        coords[0] = tx+TILE_SIZE-1;   coords[1] = ty+7*TILE_SIZE/8;
+        coords[2] = tx+TILE_SIZE-1;   coords[3] = ty+TILE_SIZE-1;
+        coords[4] = tx+7*TILE_SIZE/8; coords[5] = ty+TILE_SIZE-1;
         draw_polygon(dr, coords, 3, textcol, textcol);
     }
 
@@ -1816,6 +1817,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     true, get_prefs, set_prefs,
     new_ui,
@@ -1827,6 +1829,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -1460,35 +1460,30 @@ static char *interpret_move(const game_state *state, game_ui *ui,
 static game_state *execute_move(const game_state *state, const game_ui *ui, const char *move)
 {
     game_state *ret = dup_game(state);
-    int x, y, i, n;
+    int x, y, i, r;
+    move_item it;
 
     ret->used_solve = false;
-    while (*move) {
-        char c = *move;
-        if (c == 'B' || c == 'C' || c == 'E') {
-            move++;
-            if (sscanf(move, "%d,%d%n", &x, &y, &n) != 2 ||
-                !INGRID(state, x, y))
+    while ((r = move_next_item(&move, &it)) > 0) {
+        if ((it.c == 'B' || it.c == 'C' || it.c == 'E') && it.nargs == 2) {
+            x = it.args[0];
+            y = it.args[1];
+            if (!INGRID(state, x, y))
                 goto badmove;
 
             i = y*ret->w + x;
             ret->flags[i] &= ~(F_CIRCLE | F_BLACK); /* empty first, always. */
-            if (c == 'B')
+            if (it.c == 'B')
                 ret->flags[i] |= F_BLACK;
-            else if (c == 'C')
+            else if (it.c == 'C')
                 ret->flags[i] |= F_CIRCLE;
-            move += n;
-        } else if (c == 'S') {
-            move++;
+        } else if (it.c == 'S' && it.nargs == 0) {
             ret->used_solve = true;
         } else
             goto badmove;
-
-        if (*move == ';')
-            move++;
-        else if (*move)
-            goto badmove;
     }
+    if (r < 0)
+        goto badmove;
     ret->completed = check_complete(ret, CC_MARK_ERRORS);
     return ret;
 
@@ -1698,6 +1693,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     true, get_prefs, set_prefs,
     new_ui,
@@ -1709,6 +1705,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -719,17 +719,112 @@ struct solver_usage {
     int *regions;
     int nr_regions;
     int **sq2region;
+
+    /*
+     * The cube again, as bitmasks: cellmask[xy] has bit n-1 set if
+     * digit n is possible in square xy. The houses (rows, columns,
+     * blocks and, for X-type puzzles, the two diagonals; see the
+     * HOUSE_* macros) list their squares in house[h*cr+i], and
+     * hpos[h*cr+n-1] has bit i set if n is possible in house[h*cr+i].
+     * sqhouse[xy*5+k] gives the houses containing xy, as h*cr+i, and
+     * is -1 past the last of them.
+     */
+    unsigned int *cellmask, *hpos;
+    int *house, *sqhouse;
+    int nhouses;
+
+    /*
+     * Change tracking. Every change to the cube or the grid bumps gen,
+     * and is recorded in hgen[] for the houses it touches and in
+     * dgen[] for its digit. The *done arrays hold the value of gen
+     * when a deduction last found nothing in a house (or a pair of
+     * houses, or a digit), so that it need not look there again until
+     * something in it changes.
+     */
+    unsigned long gen, *hgen, *dgen;
+    unsigned long *elimdone, *isectdone, *setdone, *xsetdone, forcedone;
 };
 #define cubepos2(xy,n) ((xy)*usage->cr+(n)-1)
 #define cubepos(x,y,n) cubepos2((y)*usage->cr+(x),n)
 #define cube(x,y,n) (usage->cube[cubepos(x,y,n)])
 #define cube2(xy,n) (usage->cube[cubepos2(xy,n)])
 
+#define HOUSE_ROW(y) (y)
+#define HOUSE_COL(x) (cr+(x))
+#define HOUSE_BLK(b) (2*cr+(b))
+#define HOUSE_DIAG(i) (3*cr+(i))
+
 #define ondiag0(xy) ((xy) % (cr+1) == 0)
 #define ondiag1(xy) ((xy) % (cr-1) == 0 && (xy) > 0 && (xy) < cr*cr-1)
 #define diag0(i) ((i) * (cr+1))
 #define diag1(i) ((i+1) * (cr-1))
 
+/*
+ * Count the bits in a word. Only needs to cope with ORDER_MAX bits.
+ */
+static int bitcount(unsigned int word)
+{
+    word = ((word & 0xAAAA) >> 1) + (word & 0x5555);
+    word = ((word & 0xCCCC) >> 2) + (word & 0x3333);
+    word = ((word & 0xF0F0) >> 4) + (word & 0x0F0F);
+    word = ((word & 0xFF00) >> 8) + (word & 0x00FF);
+    return word;
+}
+
+/*
+ * Index of the lowest set bit in a non-zero word.
+ */
+static int lowbit(unsigned int word)
+{
+    int i = 0;
+    while (!(word & 1))
+        word >>= 1, i++;
+    return i;
+}
+
+static bool in_house(struct solver_usage *usage, int xy, int h)
+{
+    int cr = usage->cr;
+    int k, slot;
+
+    for (k = 0; k < 5 && (slot = usage->sqhouse[xy*5+k]) >= 0; k++)
+        if (slot / cr == h)
+            return true;
+    return false;
+}
+
+/*
+ * Record that something about square xy has changed.
+ */
+static void solver_touch(struct solver_usage *usage, int xy)
+{
+    int cr = usage->cr;
+    int k, slot;
+
+    usage->gen++;
+    for (k = 0; k < 5 && (slot = usage->sqhouse[xy*5+k]) >= 0; k++)
+        usage->hgen[slot / cr] = usage->gen;
+}
+
+/*
+ * Rule out digit n in square xy. All changes to the cube must go
+ * through here, to keep the bitmasks in step with it.
+ */
+static void solver_clear(struct solver_usage *usage, int xy, int n)
+{
+    int cr = usage->cr;
+    int k, slot;
+
+    if (!cube2(xy,n))
+        return;
+    cube2(xy,n) = false;
+    usage->cellmask[xy] &= ~(1 << (n-1));
+    for (k = 0; k < 5 && (slot = usage->sqhouse[xy*5+k]) >= 0; k++)
+        usage->hpos[(slot / cr)*cr+n-1] &= ~(1 << (slot % cr));
+    solver_touch(usage, xy);
+    usage->dgen[n-1] = usage->gen;
+}
+
 /*
  * Function called when we are certain that a particular square has
  * a particular number in it. The y-coordinate passed in here is
@@ -739,127 +834,100 @@ static void solver_place(struct solver_usage *usage, int x, int y, int n)
 {
     int cr = usage->cr;
     int sqindex = y*cr+x;
-    int i, bi;
+    int bi, k, slot;
+    unsigned int m;
 
     assert(cube(x,y,n));
 
     /*
      * Rule out all other numbers in this square.
      */
-    for (i = 1; i <= cr; i++)
-        if (i != n)
-            cube(x,y,i) = false;
+    for (m = usage->cellmask[sqindex] & ~(1 << (n-1)); m; m &= m - 1)
+        solver_clear(usage, sqindex, lowbit(m) + 1);
 
     /*
-     * Rule out this number in all other positions in the row.
+     * Rule out this number in all other positions in the row, the
+     * column, the block and the diagonals through this square.
      */
-    for (i = 0; i < cr; i++)
-        if (i != y)
-            cube(x,i,n) = false;
-
-    /*
-     * Rule out this number in all other positions in the column.
-     */
-    for (i = 0; i < cr; i++)
-        if (i != x)
-            cube(i,y,n) = false;
-
-    /*
-     * Rule out this number in all other positions in the block.
-     */
-    bi = usage->blocks->whichblock[sqindex];
-    for (i = 0; i < cr; i++) {
-        int bp = usage->blocks->blocks[bi][i];
-        if (bp != sqindex)
-            cube2(bp,n) = false;
+    for (k = 0; k < 5 && (slot = usage->sqhouse[sqindex*5+k]) >= 0; k++) {
+        int h = slot / cr;
+        for (m = usage->hpos[h*cr+n-1] & ~(1 << (slot % cr)); m; m &= m - 1)
+            solver_clear(usage, usage->house[h*cr+lowbit(m)], n);
     }
 
     /*
      * Enter the number in the result grid.
      */
     usage->grid[sqindex] = n;
+    solver_touch(usage, sqindex);
 
     /*
      * Cross out this number from the list of numbers left to place
      * in its row, its column and its block.
      */
+    bi = usage->blocks->whichblock[sqindex];
     usage->row[y*cr+n-1] = usage->col[x*cr+n-1] =
     usage->blk[bi*cr+n-1] = true;
 
     if (usage->diag) {
-        if (ondiag0(sqindex)) {
-            for (i = 0; i < cr; i++)
-                if (diag0(i) != sqindex)
-                    cube2(diag0(i),n) = false;
+        if (ondiag0(sqindex))
             usage->diag[n-1] = true;
-        }
-        if (ondiag1(sqindex)) {
-            for (i = 0; i < cr; i++)
-                if (diag1(i) != sqindex)
-                    cube2(diag1(i),n) = false;
+        if (ondiag1(sqindex))
             usage->diag[cr+n-1] = true;
-        }
     }
 }
 
-static int solver_elim(struct solver_usage *usage, int *indices) {
+/*
+ * Positional elimination of digit n in house h.
+ */
+static int solver_elim(struct solver_usage *usage, int h, int n) {
     int cr = usage->cr;
-    int fpos, m, i;
+    unsigned int m = usage->hpos[h*cr+n-1];
 
-    /*
-     * Count the number of set bits within this section of the
-     * cube.
-     */
-    m = 0;
-    fpos = -1;
-    for (i = 0; i < cr; i++)
-        if (usage->cube[indices[i]]) {
-            fpos = indices[i];
-            m++;
+    if (m == 0)
+        return -1;
+    if (!(m & (m - 1))) {
+        int xy = usage->house[h*cr+lowbit(m)];
+
+        if (!usage->grid[xy]) {
+            solver_place(usage, xy % cr, xy / cr, n);
+            return +1;
         }
+    }
 
-    if (m == 1) {
-        int x, y, n;
-        assert(fpos >= 0);
+    return 0;
+}
 
-        n = 1 + fpos % cr;
-        x = fpos / cr;
-        y = x / cr;
-        x %= cr;
+/*
+ * Numeric elimination in square xy.
+ */
+static int solver_elim_square(struct solver_usage *usage, int xy) {
+    int cr = usage->cr;
+    unsigned int m = usage->cellmask[xy];
 
-        if (!usage->grid[y*cr+x]) {
-            solver_place(usage, x, y, n);
-            return +1;
-        }
-    } else if (m == 0) {
+    if (m == 0)
         return -1;
+    if (!(m & (m - 1)) && !usage->grid[xy]) {
+        solver_place(usage, xy % cr, xy / cr, lowbit(m) + 1);
+        return +1;
     }
 
     return 0;
 }
 
-static int solver_intersect(struct solver_usage *usage,
-                            int *indices1, int *indices2
-                            )
+static int solver_intersect(struct solver_usage *usage, int h1, int h2, int n)
 {
     int cr = usage->cr;
-    int ret, i, j;
+    int ret;
+    unsigned int m;
 
     /*
      * Loop over the first domain and see if there's any set bit
      * not also in the second.
      */
-    for (i = j = 0; i < cr; i++) {
-        int p = indices1[i];
-        while (j < cr && indices2[j] < p)
-            j++;
-        if (usage->cube[p]) {
-            if (j < cr && indices2[j] == p)
-                continue;           /* both domains contain this index */
-            else
-                return 0;           /* there is, so we can't deduce */
-        }
-    }
+    for (m = usage->hpos[h1*cr+n-1]; m; m &= m - 1)
+        if (!in_house(usage, usage->house[h1*cr+lowbit(m)], h2))
+            return 0;               /* there is, so we can't deduce */
 
     /*
      * We have determined that all set bits in the first domain are
@@ -868,13 +936,11 @@ static int solver_intersect(struct solver_usage *usage,
      * overlap; return +1 iff we actually _did_ anything.
      */
     ret = 0;
-    for (i = j = 0; i < cr; i++) {
-        int p = indices2[i];
-        while (j < cr && indices1[j] < p)
-            j++;
-        if (usage->cube[p] && (j >= cr || indices1[j] != p)) {
+    for (m = usage->hpos[h2*cr+n-1]; m; m &= m - 1) {
+        int xy = usage->house[h2*cr+lowbit(m)];
+        if (!in_house(usage, xy, h1)) {
             ret = +1;               /* we did something */
-            usage->cube[p] = false;
+            solver_clear(usage, xy, n);
         }
     }
 
@@ -882,22 +948,28 @@ static int solver_intersect(struct solver_usage *usage,
 }
 
 struct solver_scratch {
-    unsigned char *grid, *rowidx, *colidx, *set;
+    unsigned char *grid, *rowidx, *colidx;
+    unsigned int *rows, *subrows;
     int *neighbours, *bfsqueue;
-    int *indexlist, *indexlist2;
 };
 
+/*
+ * Set elimination. rows[i] gives row i of a cr-by-cr matrix of
+ * booleans, bit j being column j. Entry (i,j) stands for digit j+1 in
+ * square house[i], or, if house is NULL, for digit n in square
+ * i*cr+j.
+ */
 static int solver_set(struct solver_usage *usage,
                       struct solver_scratch *scratch,
-                      int *indices
+                      const unsigned int *rows, const int *house, int n
                       )
 {
     int cr = usage->cr;
-    int i, j, n, count;
-    unsigned char *grid = scratch->grid;
+    int i, j, nn, count;
+    unsigned int *grid = scratch->subrows;
     unsigned char *rowidx = scratch->rowidx;
     unsigned char *colidx = scratch->colidx;
-    unsigned char *set = scratch->set;
+    unsigned int set, full;
 
     /*
      * We are passed a cr-by-cr matrix of booleans. Our first job
@@ -908,20 +980,15 @@ static int solver_set(struct solver_usage *usage,
     memset(rowidx, 1, cr);
     memset(colidx, 1, cr);
     for (i = 0; i < cr; i++) {
-        int count = 0, first = -1;
-        for (j = 0; j < cr; j++)
-            if (usage->cube[indices[i*cr+j]])
-                first = j, count++;
-
         /*
-         * If count == 0, then there's a row with no 1s at all and
-         * the puzzle is internally inconsistent.
+         * If the row is empty, then the puzzle is internally
+         * inconsistent.
          */
-        if (count == 0) {
+        if (rows[i] == 0) {
             return -1;
         }
-        if (count == 1)
-            rowidx[i] = colidx[first] = 0;
+        if (!(rows[i] & (rows[i] - 1)))
+            rowidx[i] = colidx[lowbit(rows[i])] = 0;
     }
 
     /*
@@ -931,65 +998,62 @@ static int solver_set(struct solver_usage *usage,
     for (i = j = 0; i < cr; i++)
         if (rowidx[i])
             rowidx[j++] = i;
-    n = j;
+    nn = j;
     for (i = j = 0; i < cr; i++)
         if (colidx[i])
             colidx[j++] = i;
-    assert(n == j);
+    assert(nn == j);
 
     /*
-     * And create the smaller matrix.
+     * And create the smaller matrix. Its column j is kept in bit
+     * nn-1-j, so that counting upwards through the candidate sets
+     * below tries them in the same order as the solver always has.
      */
-    for (i = 0; i < n; i++)
-        for (j = 0; j < n; j++)
-            grid[i*cr+j] = usage->cube[indices[rowidx[i]*cr+colidx[j]]];
+    for (i = 0; i < nn; i++) {
+        grid[i] = 0;
+        for (j = 0; j < nn; j++)
+            if (rows[rowidx[i]] & (1 << colidx[j]))
+                grid[i] |= 1 << (nn-1-j);
+    }
 
     /*
      * Having done that, we now have a matrix in which every row
      * has at least two 1s in. Now we search to see if we can find
      * a rectangle of zeroes (in the set-theoretic sense of
      * `rectangle', i.e. a subset of rows crossed with a subset of
-     * columns) whose width and height add up to n.
+     * columns) whose width and height add up to nn.
      */
-
-    memset(set, 0, n);
-    count = 0;
-    while (1) {
+    full = (1 << nn) - 1;
+    for (set = 0; ; set++) {
         /*
-         * We have a candidate set. If its size is <=1 or >=n-1
+         * We have a candidate set. If its size is <=1 or >=nn-1
          * then we move on immediately.
          */
-        if (count > 1 && count < n-1) {
+        count = bitcount(set);
+        if (count > 1 && count < nn-1) {
             /*
-             * The number of rows we need is n-count. See if we can
+             * The number of rows we need is nn-count. See if we can
              * find that many rows which each have a zero in all
              * the positions listed in `set'.
              */
-            int rows = 0;
-            for (i = 0; i < n; i++) {
-                bool ok = true;
-                for (j = 0; j < n; j++)
-                    if (set[j] && grid[i*cr+j]) {
-                        ok = false;
-                        break;
-                    }
-                if (ok)
-                    rows++;
-            }
+            int nrows = 0;
+            for (i = 0; i < nn; i++)
+                if (!(grid[i] & set))
+                    nrows++;
 
             /*
              * We expect never to be able to get _more_ than
-             * n-count suitable rows: this would imply that (for
+             * nn-count suitable rows: this would imply that (for
              * example) there are four numbers which between them
              * have at most three possible positions, and hence it
              * indicates a faulty deduction before this point or
              * even a bogus clue.
              */
-            if (rows > n - count) {
+            if (nrows > nn - count) {
                 return -1;
             }
 
-            if (rows >= n - count) {
+            if (nrows >= nn - count) {
                 bool progress = false;
 
                 /*
@@ -1003,20 +1067,17 @@ static int solver_set(struct solver_usage *usage,
                  * rowidx/colidx in order to work out which actual
                  * positions in the cube to meddle with.
                  */
-                for (i = 0; i < n; i++) {
-                    bool ok = true;
-                    for (j = 0; j < n; j++)
-                        if (set[j] && grid[i*cr+j]) {
-                            ok = false;
-                            break;
-                        }
-                    if (!ok) {
-                        for (j = 0; j < n; j++)
-                            if (!set[j] && grid[i*cr+j]) {
-                                int fpos = indices[rowidx[i]*cr+colidx[j]];
-                                progress = true;
-                                usage->cube[fpos] = false;
-                            }
+                for (i = 0; i < nn; i++) {
+                    unsigned int elim;
+                    if (!(grid[i] & set))
+                        continue;
+                    for (elim = grid[i] & ~set; elim; elim &= elim - 1) {
+                        int r = rowidx[i], c = colidx[nn-1 - lowbit(elim)];
+                        if (house)
+                            solver_clear(usage, house[r], c + 1);
+                        else
+                            solver_clear(usage, r*cr + c, n);
+                        progress = true;
                     }
                 }
 
@@ -1026,16 +1087,7 @@ static int solver_set(struct solver_usage *usage,
             }
         }
 
-        /*
-         * Binary increment: change the rightmost 0 to a 1, and
-         * change all 1s to the right of it to 0s.
-         */
-        i = n;
-        while (i > 0 && set[i-1])
-            set[--i] = 0, count--;
-        if (i > 0)
-            set[--i] = 1, count++;
-        else
+        if (set == full)
             break;                     /* done */
     }
 
@@ -1089,22 +1141,19 @@ static int solver_forcing(struct solver_usage *usage,
 
     for (y = 0; y < cr; y++)
     for (x = 0; x < cr; x++) {
-        int count, t, n;
+        unsigned int m = usage->cellmask[y*cr+x];
+        int t, n;
 
         /*
          * If this square doesn't have exactly two candidate
          * numbers, don't try it.
          * 
-         * In this loop we also sum the candidate numbers,
-         * which is a nasty hack to allow us to quickly find
-         * `the other one' (since we will shortly know there
-         * are exactly two).
+         * We also sum the candidate numbers, which is a nasty
+         * hack to allow us to quickly find `the other one'.
          */
-        for (count = t = 0, n = 1; n <= cr; n++)
-            if (cube(x, y, n))
-                count++, t += n;
-        if (count != 2)
+        if (bitcount(m) != 2)
             continue;
+        t = lowbit(m) + lowbit(m & (m - 1)) + 2;
 
         /*
          * Now attempt a bfs for each candidate.
@@ -1156,7 +1205,7 @@ static int solver_forcing(struct solver_usage *usage,
                      * Try visiting each of those neighbours.
                      */
                     for (i = 0; i < nneighbours; i++) {
-                        int cc, tt, nn;
+                        unsigned int mt;
                         xt = neighbours[i] % cr;
                         yt = neighbours[i] / cr;
 
@@ -1167,7 +1216,8 @@ static int solver_forcing(struct solver_usage *usage,
                          */
                         if (number[yt*cr+xt] <= cr)
                             continue;
-                        if (!cube(xt, yt, currn))
+                        mt = usage->cellmask[yt*cr+xt];
+                        if (!(mt & (1 << (currn-1))))
                             continue;
                         /*
                          * Don't visit _this_ square a second
@@ -1181,12 +1231,10 @@ static int solver_forcing(struct solver_usage *usage,
                          * this square to have exactly two
                          * possible numbers.
                          */
-                        for (cc = tt = 0, nn = 1; nn <= cr; nn++)
-                            if (cube(xt, yt, nn))
-                                cc++, tt += nn;
-                        if (cc == 2) {
+                        if (bitcount(mt) == 2) {
                             bfsqueue[tail++] = yt*cr+xt;
-                            number[yt*cr+xt] = tt - currn;
+                            number[yt*cr+xt] = lowbit(mt) +
+                                lowbit(mt & (mt - 1)) + 2 - currn;
                         }
                         /*
                          * One other possibility is that this
@@ -1200,7 +1248,7 @@ static int solver_forcing(struct solver_usage *usage,
                            (usage->blocks->whichblock[yt*cr+xt] == usage->blocks->whichblock[y*cr+x]) ||
                            (usage->diag && ((ondiag0(yt*cr+xt) && ondiag0(y*cr+x)) ||
                            (ondiag1(yt*cr+xt) && ondiag1(y*cr+x)))))) {
-                            cube(xt, yt, orign) = false;
+                            solver_clear(usage, yt*cr+xt, orign);
                             return 1;
                         }
                     }
@@ -1248,11 +1296,11 @@ static int solver_killer_minmax(struct solver_usage *usage,
                         }
                 }
                 if (maxval + n < clues[b]) {
-                    cube2(x, n) = false;
+                    solver_clear(usage, x, n);
                     ret = 1;
                 }
                 if (minval + n > clues[b]) {
-                    cube2(x, n) = false;
+                    solver_clear(usage, x, n);
                     ret = 1;
                 }
             }
@@ -1370,7 +1418,7 @@ static int solver_killer_sums(struct solver_usage *usage, int b,
             if (!cube2(x, n))
                 continue;
             if ((possible_addends & (1 << n)) == 0) {
-                cube2(x, n) = false;
+                solver_clear(usage, x, n);
                 ret = 1;
             }
         }
@@ -1441,11 +1489,10 @@ static struct solver_scratch *solver_new_scratch(struct solver_usage *usage)
     scratch->grid = snewn(cr*cr, unsigned char);
     scratch->rowidx = snewn(cr, unsigned char);
     scratch->colidx = snewn(cr, unsigned char);
-    scratch->set = snewn(cr, unsigned char);
+    scratch->rows = snewn(cr, unsigned int);
+    scratch->subrows = snewn(cr, unsigned int);
     scratch->neighbours = snewn(5*cr, int);
     scratch->bfsqueue = snewn(cr*cr, int);
-    scratch->indexlist = snewn(cr*cr, int);   /* used for set elimination */
-    scratch->indexlist2 = snewn(cr, int);   /* only used for intersect() */
     return scratch;
 }
 
@@ -1453,12 +1500,11 @@ static void solver_free_scratch(struct solver_scratch *scratch)
 {
     sfree(scratch->bfsqueue);
     sfree(scratch->neighbours);
-    sfree(scratch->set);
+    sfree(scratch->subrows);
+    sfree(scratch->rows);
     sfree(scratch->colidx);
     sfree(scratch->rowidx);
     sfree(scratch->grid);
-    sfree(scratch->indexlist);
-    sfree(scratch->indexlist2);
     sfree(scratch);
 }
 
@@ -1556,6 +1602,56 @@ static void solver(int cr, struct block_structure *blocks,
     }
     }
 
+    usage->nhouses = cr * 3 + (xtype ? 2 : 0);
+    usage->house = snewn(cr * usage->nhouses, int);
+    usage->sqhouse = snewn(cr * cr * 5, int);
+    for (i = 0; i < cr * cr * 5; i++)
+        usage->sqhouse[i] = -1;
+    for (n = 0; n < cr; n++)
+    for (i = 0; i < cr; i++) {
+        usage->house[HOUSE_ROW(n)*cr+i] = n*cr+i;
+        usage->house[HOUSE_COL(n)*cr+i] = i*cr+n;
+        usage->house[HOUSE_BLK(n)*cr+i] = usage->blocks->blocks[n][i];
+    }
+    if (xtype) {
+        for (i = 0; i < cr; i++) {
+            usage->house[HOUSE_DIAG(0)*cr+i] = diag0(i);
+            usage->house[HOUSE_DIAG(1)*cr+i] = diag1(i);
+        }
+    }
+    for (b = 0; b < usage->nhouses; b++)
+    for (i = 0; i < cr; i++) {
+        int xy = usage->house[b*cr+i];
+        for (n = 0; usage->sqhouse[xy*5+n] >= 0; n++);
+        usage->sqhouse[xy*5+n] = b*cr+i;
+    }
+
+    usage->cellmask = snewn(cr * cr, unsigned int);
+    for (i = 0; i < cr * cr; i++)
+        usage->cellmask[i] = (1 << cr) - 1;
+    usage->hpos = snewn(cr * usage->nhouses, unsigned int);
+    for (i = 0; i < cr * usage->nhouses; i++)
+        usage->hpos[i] = (1 << cr) - 1;
+
+    usage->gen = 1;
+    usage->hgen = snewn(usage->nhouses, unsigned long);
+    usage->dgen = snewn(cr, unsigned long);
+    usage->elimdone = snewn(usage->nhouses, unsigned long);
+    usage->isectdone = snewn(usage->nhouses * cr, unsigned long);
+    usage->setdone = snewn(usage->nhouses, unsigned long);
+    usage->xsetdone = snewn(cr, unsigned long);
+    for (i = 0; i < usage->nhouses; i++) {
+        usage->hgen[i] = usage->gen;
+        usage->elimdone[i] = usage->setdone[i] = 0;
+    }
+    for (i = 0; i < usage->nhouses * cr; i++)
+        usage->isectdone[i] = 0;
+    for (i = 0; i < cr; i++) {
+        usage->dgen[i] = usage->gen;
+        usage->xsetdone[i] = 0;
+    }
+    usage->forcedone = 0;
+
     scratch = solver_new_scratch(usage);
 
     /*
@@ -1593,12 +1689,13 @@ static void solver(int cr, struct block_structure *blocks,
         /*
          * Blockwise positional elimination.
          */
-        for (b = 0; b < cr; b++)
+        for (b = 0; b < cr; b++) {
+            int h = HOUSE_BLK(b);
+            if (usage->hgen[h] <= usage->elimdone[h])
+                continue;
             for (n = 1; n <= cr; n++)
                 if (!usage->blk[b*cr+n-1]) {
-                    for (i = 0; i < cr; i++)
-                        scratch->indexlist[i] = cubepos2(usage->blocks->blocks[b][i],n);
-                    ret = solver_elim(usage, scratch->indexlist);
+                    ret = solver_elim(usage, h, n);
                     if (ret < 0) {
                         diff = DIFF_IMPOSSIBLE;
                         goto got_result;
@@ -1607,6 +1704,8 @@ static void solver(int cr, struct block_structure *blocks,
                         goto cont;
                     }
                 }
+            usage->elimdone[h] = usage->gen;
+        }
 
         if (usage->kclues != NULL) {
             bool changed = false;
@@ -1635,7 +1734,7 @@ static void solver(int cr, struct block_structure *blocks,
                  * about the other squares in the cage.
                  */
                 for (n = 0; n < usage->kblocks->nr_squares[b]; n++) {
-                    cube2(usage->kblocks->blocks[b][n], t) = false;
+                    solver_clear(usage, usage->kblocks->blocks[b][n], t);
                 }
             }
 
@@ -1818,47 +1917,13 @@ static void solver(int cr, struct block_structure *blocks,
         /*
          * Row-wise positional elimination.
          */
-        for (y = 0; y < cr; y++)
-        for (n = 1; n <= cr; n++)
-            if (!usage->row[y*cr+n-1]) {
-                for (x = 0; x < cr; x++)
-                    scratch->indexlist[x] = cubepos(x, y, n);
-                ret = solver_elim(usage, scratch->indexlist);
-                if (ret < 0) {
-                    diff = DIFF_IMPOSSIBLE;
-                    goto got_result;
-                } else if (ret > 0) {
-                    diff = max(diff, DIFF_SIMPLE);
-                    goto cont;
-                }
-            }
-        /*
-         * Column-wise positional elimination.
-         */
-        for (x = 0; x < cr; x++)
-        for (n = 1; n <= cr; n++)
-            if (!usage->col[x*cr+n-1]) {
-                for (y = 0; y < cr; y++)
-                    scratch->indexlist[y] = cubepos(x, y, n);
-                ret = solver_elim(usage, scratch->indexlist);
-                if (ret < 0) {
-                    diff = DIFF_IMPOSSIBLE;
-                    goto got_result;
-                } else if (ret > 0) {
-                    diff = max(diff, DIFF_SIMPLE);
-                    goto cont;
-                }
-            }
-
-        /*
-         * X-diagonal positional elimination.
-         */
-        if (usage->diag) {
+        for (y = 0; y < cr; y++) {
+            int h = HOUSE_ROW(y);
+            if (usage->hgen[h] <= usage->elimdone[h])
+                continue;
             for (n = 1; n <= cr; n++)
-            if (!usage->diag[n-1]) {
-                    for (i = 0; i < cr; i++)
-                        scratch->indexlist[i] = cubepos2(diag0(i), n);
-                    ret = solver_elim(usage, scratch->indexlist);
+                if (!usage->row[y*cr+n-1]) {
+                    ret = solver_elim(usage, h, n);
                     if (ret < 0) {
                         diff = DIFF_IMPOSSIBLE;
                         goto got_result;
@@ -1867,11 +1932,18 @@ static void solver(int cr, struct block_structure *blocks,
                         goto cont;
                     }
                 }
+            usage->elimdone[h] = usage->gen;
+        }
+        /*
+         * Column-wise positional elimination.
+         */
+        for (x = 0; x < cr; x++) {
+            int h = HOUSE_COL(x);
+            if (usage->hgen[h] <= usage->elimdone[h])
+                continue;
             for (n = 1; n <= cr; n++)
-                if (!usage->diag[cr+n-1]) {
-                    for (i = 0; i < cr; i++)
-                        scratch->indexlist[i] = cubepos2(diag1(i), n);
-                    ret = solver_elim(usage, scratch->indexlist);
+                if (!usage->col[x*cr+n-1]) {
+                    ret = solver_elim(usage, h, n);
                     if (ret < 0) {
                         diff = DIFF_IMPOSSIBLE;
                         goto got_result;
@@ -1880,6 +1952,30 @@ static void solver(int cr, struct block_structure *blocks,
                         goto cont;
                     }
                 }
+            usage->elimdone[h] = usage->gen;
+        }
+
+        /*
+         * X-diagonal positional elimination.
+         */
+        if (usage->diag) {
+            for (i = 0; i < 2; i++) {
+                int h = HOUSE_DIAG(i);
+                if (usage->hgen[h] <= usage->elimdone[h])
+                    continue;
+                for (n = 1; n <= cr; n++)
+                    if (!usage->diag[i*cr+n-1]) {
+                        ret = solver_elim(usage, h, n);
+                        if (ret < 0) {
+                            diff = DIFF_IMPOSSIBLE;
+                            goto got_result;
+                        } else if (ret > 0) {
+                            diff = max(diff, DIFF_SIMPLE);
+                            goto cont;
+                        }
+                    }
+                usage->elimdone[h] = usage->gen;
+            }
         }
 
         /*
@@ -1888,9 +1984,7 @@ static void solver(int cr, struct block_structure *blocks,
         for (x = 0; x < cr; x++)
         for (y = 0; y < cr; y++)
             if (!usage->grid[y*cr+x]) {
-                for (n = 1; n <= cr; n++)
-                    scratch->indexlist[n-1] = cubepos(x, y, n);
-                ret = solver_elim(usage, scratch->indexlist);
+                ret = solver_elim_square(usage, y*cr+x);
                 if (ret < 0) {
                     diff = DIFF_IMPOSSIBLE;
                     goto got_result;
@@ -1904,87 +1998,41 @@ static void solver(int cr, struct block_structure *blocks,
             break;
 
         /*
-         * Intersectional analysis, rows vs blocks.
+         * Intersectional analysis: rows vs blocks, columns vs blocks,
+         * \-diagonal vs blocks and /-diagonal vs blocks.
          */
-        for (y = 0; y < cr; y++)
-        for (b = 0; b < cr; b++)
-        for (n = 1; n <= cr; n++) {
-            if (usage->row[y*cr+n-1] || usage->blk[b*cr+n-1])
-                continue;
-            for (i = 0; i < cr; i++) {
-               scratch->indexlist[i] = cubepos(i, y, n);
-               scratch->indexlist2[i] = cubepos2(usage->blocks->blocks[b][i], n);
-            }
-            /*
-             * solver_intersect() never returns -1.
-             */
-            if (solver_intersect(usage, scratch->indexlist, scratch->indexlist2) ||
-                solver_intersect(usage, scratch->indexlist2, scratch->indexlist)) {
-                diff = max(diff, DIFF_INTERSECT);
-                goto cont;
-            }
-        }
-
-        /*
-         * Intersectional analysis, columns vs blocks.
-         */
-        for (x = 0; x < cr; x++)
-        for (b = 0; b < cr; b++)
-        for (n = 1; n <= cr; n++) {
-            if (usage->col[x*cr+n-1] || usage->blk[b*cr+n-1])
-                continue;
-            for (i = 0; i < cr; i++) {
-                scratch->indexlist[i] = cubepos(x, i, n);
-                scratch->indexlist2[i] = cubepos2(usage->blocks->blocks[b][i], n);
-            }
-            if (solver_intersect(usage, scratch->indexlist,
-                scratch->indexlist2) ||
-                solver_intersect(usage, scratch->indexlist2,
-                scratch->indexlist)) {
-                diff = max(diff, DIFF_INTERSECT);
-                goto cont;
+        for (i = 0; i < usage->nhouses; i++) {
+            bool *placed;
+            int h = i;
+
+            /* Skip the blocks themselves, and walk the lines in order. */
+            if (h >= HOUSE_BLK(0)) {
+                h += cr;
+                if (h >= usage->nhouses)
+                    break;
             }
-        }
-
-        if (usage->diag) {
-            /*
-             * Intersectional analysis, \-diagonal vs blocks.
-             */
-            for (b = 0; b < cr; b++)
-            for (n = 1; n <= cr; n++) {
-                if (usage->diag[n-1] || usage->blk[b*cr+n-1])
+            placed = (h < HOUSE_COL(0) ? usage->row + h*cr :
+                      h < HOUSE_BLK(0) ? usage->col + (h-cr)*cr :
+                      usage->diag + (h-3*cr)*cr);
+
+            for (b = 0; b < cr; b++) {
+                int hb = HOUSE_BLK(b);
+                unsigned long done = usage->isectdone[h*cr+b];
+                if (usage->hgen[h] <= done && usage->hgen[hb] <= done)
                     continue;
-                for (i = 0; i < cr; i++) {
-                    scratch->indexlist[i] = cubepos2(diag0(i), n);
-                    scratch->indexlist2[i] = cubepos2(usage->blocks->blocks[b][i], n);
-                }
-                if (solver_intersect(usage, scratch->indexlist,
-                    scratch->indexlist2) ||
-                    solver_intersect(usage, scratch->indexlist2,
-                    scratch->indexlist)) {
-                    diff = max(diff, DIFF_INTERSECT);
-                    goto cont;
-                }
-            }
-
-            /*
-             * Intersectional analysis, /-diagonal vs blocks.
-             */
-                for (b = 0; b < cr; b++)
                 for (n = 1; n <= cr; n++) {
-                    if (usage->diag[cr+n-1] || usage->blk[b*cr+n-1])
+                    if (placed[n-1] || usage->blk[b*cr+n-1])
                         continue;
-                for (i = 0; i < cr; i++) {
-                    scratch->indexlist[i] = cubepos2(diag1(i), n);
-                    scratch->indexlist2[i] = cubepos2(usage->blocks->blocks[b][i], n);
-                }
-                if (solver_intersect(usage, scratch->indexlist,
-                    scratch->indexlist2) ||
-                    solver_intersect(usage, scratch->indexlist2,
-                    scratch->indexlist)) {
-                    diff = max(diff, DIFF_INTERSECT);
-                    goto cont;
+                    /*
+                     * solver_intersect() never returns -1.
+                     */
+                    if (solver_intersect(usage, h, hb, n) ||
+                        solver_intersect(usage, hb, h, n)) {
+                        diff = max(diff, DIFF_INTERSECT);
+                        goto cont;
+                    }
                 }
+                usage->isectdone[h*cr+b] = usage->gen;
             }
         }
 
@@ -1992,79 +2040,19 @@ static void solver(int cr, struct block_structure *blocks,
             break;
 
         /*
-         * Blockwise set elimination.
+         * Set elimination: blockwise, row-wise, column-wise and on
+         * the two diagonals, in that order.
          */
-        for (b = 0; b < cr; b++) {
-            for (i = 0; i < cr; i++)
-            for (n = 1; n <= cr; n++)
-                scratch->indexlist[i*cr+n-1] = cubepos2(usage->blocks->blocks[b][i], n);
-            ret = solver_set(usage, scratch, scratch->indexlist);
-            if (ret < 0) {
-                diff = DIFF_IMPOSSIBLE;
-                goto got_result;
-            } else if (ret > 0) {
-                diff = max(diff, DIFF_SET);
-                goto cont;
-            }
-        }
+        for (i = 0; i < usage->nhouses; i++) {
+            /* Blocks first, then everything else in order. */
+            int h = (i < cr ? HOUSE_BLK(i) : i < 3*cr ? i - cr : i);
+            int *house = usage->house + h*cr;
 
-        /*
-         * Row-wise set elimination.
-         */
-        for (y = 0; y < cr; y++) {
+            if (usage->hgen[h] <= usage->setdone[h])
+                continue;
             for (x = 0; x < cr; x++)
-            for (n = 1; n <= cr; n++)
-                scratch->indexlist[x*cr+n-1] = cubepos(x, y, n);
-            ret = solver_set(usage, scratch, scratch->indexlist);
-            if (ret < 0) {
-                diff = DIFF_IMPOSSIBLE;
-                goto got_result;
-            } else if (ret > 0) {
-                diff = max(diff, DIFF_SET);
-                goto cont;
-            }
-        }
-
-        /*
-         * Column-wise set elimination.
-         */
-        for (x = 0; x < cr; x++) {
-            for (y = 0; y < cr; y++)
-            for (n = 1; n <= cr; n++)
-                scratch->indexlist[y*cr+n-1] = cubepos(x, y, n);
-            ret = solver_set(usage, scratch, scratch->indexlist);
-            if (ret < 0) {
-                diff = DIFF_IMPOSSIBLE;
-                goto got_result;
-            } else if (ret > 0) {
-                diff = max(diff, DIFF_SET);
-                goto cont;
-            }
-        }
-
-        if (usage->diag) {
-            /*
-             * \-diagonal set elimination.
-             */
-            for (i = 0; i < cr; i++)
-            for (n = 1; n <= cr; n++)
-                scratch->indexlist[i*cr+n-1] = cubepos2(diag0(i), n);
-            ret = solver_set(usage, scratch, scratch->indexlist);
-            if (ret < 0) {
-                diff = DIFF_IMPOSSIBLE;
-                goto got_result;
-            } else if (ret > 0) {
-                diff = max(diff, DIFF_SET);
-                goto cont;
-            }
-
-            /*
-             * /-diagonal set elimination.
-             */
-            for (i = 0; i < cr; i++)
-            for (n = 1; n <= cr; n++)
-                scratch->indexlist[i*cr+n-1] = cubepos2(diag1(i), n);
-            ret = solver_set(usage, scratch, scratch->indexlist);
+                scratch->rows[x] = usage->cellmask[house[x]];
+            ret = solver_set(usage, scratch, scratch->rows, house, 0);
             if (ret < 0) {
                 diff = DIFF_IMPOSSIBLE;
                 goto got_result;
@@ -2072,6 +2060,7 @@ static void solver(int cr, struct block_structure *blocks,
                 diff = max(diff, DIFF_SET);
                 goto cont;
             }
+            usage->setdone[h] = usage->gen;
         }
 
         if (dlev->maxdiff <= DIFF_SET)
@@ -2081,10 +2070,11 @@ static void solver(int cr, struct block_structure *blocks,
          * Row-vs-column set elimination on a single number.
          */
         for (n = 1; n <= cr; n++) {
+            if (usage->dgen[n-1] <= usage->xsetdone[n-1])
+                continue;
             for (y = 0; y < cr; y++)
-            for (x = 0; x < cr; x++)
-                scratch->indexlist[y*cr+x] = cubepos(x, y, n);
-            ret = solver_set(usage, scratch, scratch->indexlist);
+                scratch->rows[y] = usage->hpos[HOUSE_ROW(y)*cr+n-1];
+            ret = solver_set(usage, scratch, scratch->rows, NULL, n);
             if (ret < 0) {
                 diff = DIFF_IMPOSSIBLE;
                 goto got_result;
@@ -2092,14 +2082,18 @@ static void solver(int cr, struct block_structure *blocks,
                 diff = max(diff, DIFF_EXTREME);
                 goto cont;
             }
+            usage->xsetdone[n-1] = usage->gen;
         }
 
         /*
          * Forcing chains.
          */
-        if (solver_forcing(usage, scratch)) {
-            diff = max(diff, DIFF_EXTREME);
-            goto cont;
+        if (usage->forcedone < usage->gen) {
+            if (solver_forcing(usage, scratch)) {
+                diff = max(diff, DIFF_EXTREME);
+                goto cont;
+            }
+            usage->forcedone = usage->gen;
         }
 
         /*
@@ -2125,16 +2119,11 @@ static void solver(int cr, struct block_structure *blocks,
         for (y = 0; y < cr; y++)
         for (x = 0; x < cr; x++)
             if (!grid[y*cr+x]) {
-                int count;
-
                 /*
                  * An unfilled square. Count the number of
                  * possible digits in it.
                  */
-                count = 0;
-                for (n = 1; n <= cr; n++)
-                    if (cube(x,y,n))
-                        count++;
+                int count = bitcount(usage->cellmask[y*cr+x]);
 
                 /*
                  * We should have found any impossibilities
@@ -2167,7 +2156,7 @@ static void solver(int cr, struct block_structure *blocks,
 
             /* Make a list of the possible digits. */
             for (j = 0, n = 1; n <= cr; n++)
-                if (cube(x,y,n))
+                if (usage->cellmask[best] & (1 << (n-1)))
                     list[j++] = n;
 
             /*
@@ -2230,6 +2219,16 @@ static void solver(int cr, struct block_structure *blocks,
 
     sfree(usage->sq2region);
     sfree(usage->regions);
+    sfree(usage->house);
+    sfree(usage->sqhouse);
+    sfree(usage->cellmask);
+    sfree(usage->hpos);
+    sfree(usage->hgen);
+    sfree(usage->dgen);
+    sfree(usage->elimdone);
+    sfree(usage->isectdone);
+    sfree(usage->setdone);
+    sfree(usage->xsetdone);
     sfree(usage->cube);
     sfree(usage->row);
     sfree(usage->col);
@@ -2390,8 +2389,6 @@ static bool gridgen_real(struct gridgen_usage *usage, digit *grid, int *steps)
 
         m = usage->blocks->whichblock[y*cr+x];
         used_xy = usage->row[y] | usage->col[x] | usage->blk[m];
-        if (usage->cge != NULL)
-            used_xy |= usage->cge[usage->kblocks->whichblock[y*cr+x]];
         if (usage->cge != NULL)
             used_xy |= usage->cge[usage->kblocks->whichblock[y*cr+x]];
         if (usage->diag != NULL) {
@@ -2404,12 +2401,7 @@ static bool gridgen_real(struct gridgen_usage *usage, digit *grid, int *steps)
         /*
          * Find the number of digits that could go in this space.
          */
-        m = 0;
-        for (n = 1; n <= cr; n++) {
-            unsigned int bit = 1 << n;
-            if ((used_xy & bit) == 0)
-                m++;
-        }
+        m = cr - bitcount(used_xy & (((1 << cr) - 1) << 1));
         if (m < bestm || (m == bestm && usage->spaces[j].r < bestr)) {
             bestm = m;
             bestr = usage->spaces[j].r;
@@ -4146,27 +4138,26 @@ static bool check_hint(const game_state *state, int x, int y, int n) {
     return check;
 }
 
-static game_state *execute_move(const game_state *from, const game_ui *ui, const char *move)
+static bool execute_move_in_place(game_state *ret, const game_ui *ui,
+                                  const char *move)
 {
-    int cr = from->cr;
-    game_state *ret;
+    int cr = ret->cr;
     int x, y, n;
 
     if (move[0] == '+' || move[0] == '-') {
-        ret = dup_game(from);
         for (x=0;x<cr;x++)
         for (y=0;y<cr;y++) {
             if (ret->grid[y*cr+x] == 0) 
                 for (n=1;n<=cr;n++) {
-                    if (move[0] == '+' && !check_hint(from,x,y,n)) 
+                    if (move[0] == '+' && !check_hint(ret,x,y,n)) 
                         ret->pencil[(y*cr+x) * cr + (n-1)] = true;
                     else if (move[0] == '-' && 
                              ret->pencil[(y*cr+x) * cr + (n-1)] && 
-                             check_hint(from,x,y,n)) 
+                             check_hint(ret,x,y,n)) 
                         ret->pencil[(y*cr+x) * cr + (n-1)] = false;
                 }
             }
-        return ret;
+        return true;
     }
     else if (move[0] == 'Y') {
         char *desc;
@@ -4174,41 +4165,43 @@ static game_state *execute_move(const game_state *from, const game_ui *ui, const
         params->r = params->c = 3;
         params->manual = true;
 
-        desc = encode_puzzle_desc(params, from->grid, from->blocks, from->kgrid, from->kblocks);
+        desc = encode_puzzle_desc(params, ret->grid, ret->blocks, ret->kgrid, ret->kblocks);
         if (current_midend)
             midend_supersede_game_desc(current_midend, desc, NULL);
         sfree(desc);
         sfree(params);
 
-        ret = dup_game(from);
         ret->fixed = true;
-        return ret;
+        return true;
     }
     else if (move[0] == 'S') {
         const char *p;
 
-        ret = dup_game(from);
         ret->completed = ret->cheated = true;
 
         p = move+1;
         for (n = 0; n < cr*cr; n++) {
-            ret->grid[n] = atoi(p);
+            int d;
 
-            if (!*p || ret->grid[n] < 1 || ret->grid[n] > cr) {
-                free_game(ret);
-                return NULL;
-            }
-
-            while (*p && isdigit((unsigned char)*p)) p++;
+            if (!move_read_int(&p, &d) || d < 1 || d > cr)
+                return false;
+            ret->grid[n] = d;
             if (*p == ',') p++;
         }
 
-        return ret;
-    } else if ((move[0] == 'P' || move[0] == 'R' || move[0] == 'F') &&
-        sscanf(move+1, "%d,%d,%d", &x, &y, &n) == 3 &&
-        x >= 0 && x < cr && y >= 0 && y < cr && n >= 0 && n <= cr) {
+        return true;
+    } else if (move[0] == 'P' || move[0] == 'R' || move[0] == 'F') {
+        const char *p = move+1;
+        int args[3];
+
+        if (move_read_ints(&p, args, 3) != 3)
+            return false;
+        x = args[0];
+        y = args[1];
+        n = args[2];
+        if (x < 0 || x >= cr || y < 0 || y >= cr || n < 0 || n > cr)
+            return false;
 
-        ret = dup_game(from);
         if (n == 0 && ret->grid[y*cr+x] == 0)
              memset(ret->pencil + (y*cr+x)*cr, 0, cr);
         else if (move[0] == 'P' && n > 0) {
@@ -4227,14 +4220,13 @@ static game_state *execute_move(const game_state *from, const game_ui *ui, const
                     cr, ret->blocks, ret->kblocks, ret->kgrid,
                     ret->xtype, ret->grid);
         }
-        return ret;
+        return true;
     } else if (move[0] == 'M') {
         /*
          * Fill in absolutely all pencil marks in unfilled squares,
          * for those who like to play by the rigorous approach of
          * starting off in that state and eliminating things.
          */
-        ret = dup_game(from);
         for (y = 0; y < cr; y++) {
             for (x = 0; x < cr; x++) {
                 if (!ret->grid[y*cr+x]) {
@@ -4244,9 +4236,20 @@ static game_state *execute_move(const game_state *from, const game_ui *ui, const
                 }
             }
         }
-        return ret;
+        return true;
     } else
-        return NULL;               /* couldn't parse move string */
+        return false;              /* couldn't parse move string */
+}
+
+static game_state *execute_move(const game_state *from, const game_ui *ui, const char *move)
+{
+    game_state *ret = dup_game(from);
+
+    if (!execute_move_in_place(ret, ui, move)) {
+        free_game(ret);
+        return NULL;
+    }
+    return ret;
 }
 
 /* ----------------------------------------------------------------------
@@ -4615,7 +4618,8 @@ static void draw_number(drawing *dr, game_drawstate *ds,
 
     unclip(dr);
 
-    draw_update(dr, cx, cy, cw, ch);
+    /* The thick-line corners above may lie outside the clip rectangle */
+    draw_update(dr, tx-GRIDEXTRA, ty-GRIDEXTRA, tw+2*GRIDEXTRA, th+2*GRIDEXTRA);
 
     ds->grid[y*cr+x] = state->grid[y*cr+x];
     memcpy(ds->pencil+(y*cr+x)*cr, state->pencil+(y*cr+x)*cr, cr);
@@ -4790,6 +4794,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -4801,6 +4806,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    execute_move_in_place,
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -4813,6 +4819,6 @@ const struct game thegame = {
     false, false, NULL, NULL,  /* print_size, print */
     true,                      /* wants_statusbar */
     false, NULL,               /* timing_state */
-    REQUIRE_RBUTTON,           /* flags */
+    REQUIRE_RBUTTON | UNDO_KEYFRAMES, /* flags */
 };
 
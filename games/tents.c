@@ -2203,7 +2203,7 @@ static void draw_tile(drawing *dr, game_drawstate *ds,
     draw_err_adj(dr, ds, tx+TILESIZE, ty+TILESIZE);
 
     unclip(dr);
-    draw_update(dr, tx+1, ty+1, TILESIZE-1, TILESIZE-1);
+    draw_update(dr, tx, ty, TILESIZE, TILESIZE);
 }
 
 /*
@@ -2367,6 +2367,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     false, NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2378,6 +2379,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -20,10 +20,6 @@
  *    requirements are adequately expressed by a single scalar tile
  *    size), and probably complicate the rest of the puzzles' API as a
  *    result. So I'm not sure I really want to do it.
- *
- *  - It would be nice if we could somehow auto-detect a real `long
- *    long' type on the host platform and use it in place of my
- *    hand-hacked int64s. It'd be faster and more reliable.
  */
 
 #include <stdio.h>
@@ -83,6 +79,15 @@ struct game_params {
 struct graph {
     int refcount;               /* for deallocation */
     tree234 *edges;               /* stores `edge' structures */
+    /*
+     * The same edges as a flat array in tree order, so that edge i
+     * here is edge i of the tree and of `crosses'; and for each point
+     * p, the indices of the edges meeting at it are
+     * incident[incstart[p]] to incident[incstart[p+1]-1].
+     */
+    int nedges;
+    edge *earray;
+    int *incstart, *incident;
 };
 
 struct solution {
@@ -94,7 +99,7 @@ struct game_state {
     game_params params;
     int w, h;                   /* extent of coordinate system only */
     point *pts;
-    int *crosses;               /* mark edges which are crossed */
+    int *crosses;               /* number of other edges each edge crosses */
     int ncrosses;               /* number of crossed edges */
     struct graph *graph;
     struct solution *solution;
@@ -215,75 +220,16 @@ static const char *validate_params(const game_params *params, bool full)
 }
 
 /* ----------------------------------------------------------------------
- * Small number of 64-bit integer arithmetic operations, to prevent
- * integer overflow at the very core of cross().
+ * 64-bit integer arithmetic, to prevent integer overflow at the very
+ * core of cross().
  */
 
-typedef struct {
-    long hi;
-    unsigned long lo;
-} int64;
-
-#define greater64(i,j) ( (i).hi>(j).hi || ((i).hi==(j).hi && (i).lo>(j).lo))
-#define sign64(i) ((i).hi < 0 ? -1 : (i).hi==0 && (i).lo==0 ? 0 : +1)
-
-static int64 mulu32to64(unsigned long x, unsigned long y)
-{
-    unsigned long a, b, c, d, t;
-    int64 ret;
-
-    a = (x & 0xFFFF) * (y & 0xFFFF);
-    b = (x & 0xFFFF) * (y >> 16);
-    c = (x >> 16) * (y & 0xFFFF);
-    d = (x >> 16) * (y >> 16);
-
-    ret.lo = a;
-    ret.hi = d + (b >> 16) + (c >> 16);
-    t = (b & 0xFFFF) << 16;
-    ret.lo += t;
-    if (ret.lo < t)
-        ret.hi++;
-    t = (c & 0xFFFF) << 16;
-    ret.lo += t;
-    if (ret.lo < t)
-        ret.hi++;
-
-    return ret;
-}
-
-static int64 mul32to64(long x, long y)
-{
-    int sign = +1;
-    int64 ret;
-
-    if (x < 0)
-        x = -x, sign = -sign;
-    if (y < 0)
-        y = -y, sign = -sign;
-
-    ret = mulu32to64(x, y);
-
-    if (sign < 0) {
-        ret.hi = -ret.hi;
-        ret.lo = -ret.lo;
-    if (ret.lo)
-        ret.hi--;
-    }
+#define greater64(i,j) ( (i) > (j) )
+#define sign64(i) ((i) < 0 ? -1 : (i) == 0 ? 0 : +1)
 
-    return ret;
-}
-
-static int64 dotprod64(long a, long b, long p, long q)
+static int64_t dotprod64(long a, long b, long p, long q)
 {
-    int64 ab, pq;
-
-    ab = mul32to64(a, b);
-    pq = mul32to64(p, q);
-    ab.hi += pq.hi;
-    ab.lo += pq.lo;
-    if (ab.lo < pq.lo)
-        ab.hi++;
-    return ab;
+    return (int64_t)a * b + (int64_t)p * q;
 }
 
 /*
@@ -294,7 +240,7 @@ static int64 dotprod64(long a, long b, long p, long q)
 static bool cross(point a1, point a2, point b1, point b2)
 {
     long b1x, b1y, b2x, b2y, px, py;
-    int64 d1, d2, d3;
+    int64_t d1, d2, d3;
 
     /*
      * The condition for crossing is that b1 and b2 are on opposite
@@ -336,6 +282,15 @@ static bool cross(point a1, point a2, point b1, point b2)
     /* Construct the vector a2-a1. */
     px = a2.x * a1.d - a1.x * a2.d;
     py = a2.y * a1.d - a1.y * a2.d;
+    /* If that's zero, a1-a2 is really a single point, and every
+     * line passes through it. The question is then whether the
+     * point lies on b1-b2, which the tests below answer when asked
+     * the other way round, unless b1-b2 is a point as well. */
+    if (px == 0 && py == 0) {
+        if (b1.x * b2.d == b2.x * b1.d && b1.y * b2.d == b2.y * b1.d)
+            return b1x == 0 && b1y == 0;
+        return cross(b1, b2, a1, a2);
+    }
     /* Determine the dot products of b1-a1 and b2-a1 with this. */
     d1 = dotprod64(b1x, px, b1y, py);
     d2 = dotprod64(b2x, px, b2y, py);
@@ -344,9 +299,11 @@ static bool cross(point a1, point a2, point b1, point b2)
         return false;
     /* Otherwise, take the dot product of a2-a1 with itself. If
      * the other two dot products both exceed this, the lines do
-     * not cross. */
+     * not cross. d1 and d2 carry a factor of b1.d and b2.d where
+     * d3 has one of a2.d, so scale each side by the other's
+     * factor before comparing. */
     d3 = dotprod64(px, px, py, py);
-    if (greater64(d1, d3) && greater64(d2, d3))
+    if (greater64(d1 * a2.d, d3 * b1.d) && greater64(d2 * a2.d, d3 * b2.d))
         return false;
     }
 
@@ -493,6 +450,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     tree234 *edges, *vertices;
     edge *e, *e2;
     vertex *v, *vs, *vlist;
+    void **vptrs;
     char *ret;
 
     w = h = COORDLIMIT(n);
@@ -525,13 +483,15 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      *  (c) does not intersect any actual point.
      */
     vs = snewn(n, vertex);
-    vertices = newtree234(vertcmp);
+    vptrs = snewn(n, void *);
     for (i = 0; i < n; i++) {
         v = vs + i;
         v->param = 0;               /* in this tree, param is the degree */
         v->vindex = i;
-        add234(vertices, v);
+        vptrs[i] = v;               /* already in vertcmp order */
     }
+    vertices = buildtree234_sorted(vertcmp, vptrs, n);
+    sfree(vptrs);
     edges = newtree234(edgecmp);
     vlist = snewn(n, vertex);
     while (1) {
@@ -771,38 +731,181 @@ static const char *validate_desc(const game_params *params, const char *desc)
     return NULL;
 }
 
+/*
+ * Fill in the flat edge array and the incidence lists of a graph
+ * whose edge tree is complete.
+ */
+static void index_graph(struct graph *graph, int n)
+{
+    edge *e;
+    int i, *pos;
+
+    graph->nedges = count234(graph->edges);
+    graph->earray = snewn(max(graph->nedges, 1), edge);
+    graph->incstart = snewn(n + 1, int);
+    graph->incident = snewn(max(2 * graph->nedges, 1), int);
+
+    for (i = 0; i <= n; i++)
+        graph->incstart[i] = 0;
+    for (i = 0; (e = index234(graph->edges, i)) != NULL; i++) {
+        graph->earray[i] = *e;
+        graph->incstart[e->a + 1]++;
+        graph->incstart[e->b + 1]++;
+    }
+    for (i = 0; i < n; i++)
+        graph->incstart[i+1] += graph->incstart[i];
+
+    pos = snewn(n, int);
+    memcpy(pos, graph->incstart, n * sizeof(int));
+    for (i = 0; i < graph->nedges; i++) {
+        graph->incident[pos[graph->earray[i].a]++] = i;
+        graph->incident[pos[graph->earray[i].b]++] = i;
+    }
+    sfree(pos);
+}
+
+/*
+ * Whether edges i and j cross. The pair is always passed to cross()
+ * the same way round, higher-numbered edge first, so that a full
+ * check and an incremental one ask exactly the same question.
+ */
+static bool edges_cross(const struct graph *graph, const point *pts,
+                        int i, int j)
+{
+    const edge *e = &graph->earray[min(i, j)];
+    const edge *e2 = &graph->earray[max(i, j)];
+
+    if (e2->a == e->a || e2->a == e->b ||
+        e2->b == e->a || e2->b == e->b)
+        return false;
+    return cross(pts[e2->a], pts[e2->b], pts[e->a], pts[e->b]);
+}
+
+static void count_crossings(game_state *state)
+{
+    int i;
+
+    state->ncrosses = 0;
+    for (i = 0; i < state->graph->nedges; i++)
+        if (state->crosses[i]) state->ncrosses++;
+    state->completed = (state->ncrosses == 0);
+}
+
+/*
+ * Bounding box of an edge, used by mark_crossings to skip pairs of
+ * edges which can't possibly cross. The box is computed in floating
+ * point and then widened a little, so that rounding can never make
+ * it exclude a point which is really on the edge; whether two edges
+ * really do cross is still decided by the exact cross().
+ */
+struct edgebox {
+    double x0, x1, y0, y1;
+    int index;
+};
+
+static double box_pad(double v)
+{
+    return 1e-9 * (1 + fabs(v));
+}
+
+static int edgeboxcmp(const void *av, const void *bv)
+{
+    const struct edgebox *a = (const struct edgebox *)av;
+    const struct edgebox *b = (const struct edgebox *)bv;
+
+    if (a->x0 < b->x0)
+        return -1;
+    else if (a->x0 > b->x0)
+        return +1;
+    return a->index - b->index;
+}
+
 static void mark_crossings(game_state *state)
 {
-    bool ok = true;
-    int i, j;
-    edge *e, *e2;
+    const struct graph *graph = state->graph;
+    struct edgebox *boxes;
+    int *active;
+    int i, j, nactive;
+
+    for (i = 0; i < graph->nedges; i++)
+        state->crosses[i] = 0;
 
-    for (i = 0; (e = index234(state->graph->edges, i)) != NULL; i++)
-        state->crosses[i] = false;
     /*
-     * Check correctness: for every pair of edges, see whether they
-     * cross.
+     * Sweep a vertical line from left to right across the edges in
+     * order of their left ends, keeping a list of the edges it
+     * currently meets. Each edge only needs checking against the
+     * edges already in that list, and only against those whose
+     * vertical extent also overlaps its own.
      */
-    for (i = 0; (e = index234(state->graph->edges, i)) != NULL; i++) {
-    for (j = i+1; (e2 = index234(state->graph->edges, j)) != NULL; j++) {
-        if (e2->a == e->a || e2->a == e->b ||
-            e2->b == e->a || e2->b == e->b)
-            continue;
-        if (cross(state->pts[e2->a], state->pts[e2->b],
-              state->pts[e->a], state->pts[e->b])) {
-            ok = false;
-            state->crosses[i] = state->crosses[j] = true;
+    boxes = snewn(max(graph->nedges, 1), struct edgebox);
+    for (i = 0; i < graph->nedges; i++) {
+        const point *p1 = &state->pts[graph->earray[i].a];
+        const point *p2 = &state->pts[graph->earray[i].b];
+        double x1 = (double)p1->x / p1->d, y1 = (double)p1->y / p1->d;
+        double x2 = (double)p2->x / p2->d, y2 = (double)p2->y / p2->d;
+        boxes[i].x0 = min(x1, x2) - box_pad(min(x1, x2));
+        boxes[i].x1 = max(x1, x2) + box_pad(max(x1, x2));
+        boxes[i].y0 = min(y1, y2) - box_pad(min(y1, y2));
+        boxes[i].y1 = max(y1, y2) + box_pad(max(y1, y2));
+        boxes[i].index = i;
+    }
+    qsort(boxes, graph->nedges, sizeof(*boxes), edgeboxcmp);
+
+    active = snewn(max(graph->nedges, 1), int);
+    nactive = 0;
+    for (i = 0; i < graph->nedges; i++) {
+        const struct edgebox *bi = &boxes[i];
+        int k = 0;
+
+        for (j = 0; j < nactive; j++) {
+            const struct edgebox *bj = &boxes[active[j]];
+            if (bj->x1 < bi->x0)
+                continue;              /* sweep line has left it behind */
+            active[k++] = active[j];
+            if (bj->y1 < bi->y0 || bi->y1 < bj->y0)
+                continue;
+            if (edges_cross(graph, state->pts, bi->index, bj->index)) {
+                state->crosses[bi->index]++;
+                state->crosses[bj->index]++;
+            }
         }
+        nactive = k;
+        active[nactive++] = i;
     }
+
+    sfree(active);
+    sfree(boxes);
+    count_crossings(state);
+}
+
+/*
+ * Update the crossing counts after point p has moved, given the
+ * positions before the move. Only the edges at p can have changed
+ * status, so check each of those against every other edge, before
+ * and after, and adjust both edges' counts by the difference.
+ */
+static void mark_crossings_moved(game_state *state, const point *oldpts,
+                                 int p)
+{
+    const struct graph *graph = state->graph;
+    int k, i, j;
+
+    for (k = graph->incstart[p]; k < graph->incstart[p+1]; k++) {
+        i = graph->incident[k];
+        for (j = 0; j < graph->nedges; j++) {
+            const edge *e2 = &graph->earray[j];
+            int before, after;
+            /* Edges sharing p never count, so that pair needs no update. */
+            if (e2->a == p || e2->b == p)
+                continue;
+            before = edges_cross(graph, oldpts, i, j);
+            after = edges_cross(graph, state->pts, i, j);
+            state->crosses[i] += after - before;
+            state->crosses[j] += after - before;
+        }
     }
-    state->ncrosses = 0;
-    for (i=0; (e = index234(state->graph->edges, i)) != NULL; i++)
-        if (state->crosses[i]) state->ncrosses++;
-    /*
-     * e == NULL if we've gone through all the edge pairs
-     * without finding a crossing.
-     */
-    state->completed = ok;
+
+    count_crossings(state);
 }
 
 static game_state *new_game(midend *me, const game_params *params,
@@ -846,7 +949,8 @@ static game_state *new_game(midend *me, const game_params *params,
         *p++ = *desc++;
     *p = '\0';
 
-    state->crosses = snewn(count234(state->graph->edges), int);
+    index_graph(state->graph, n);
+    state->crosses = snewn(max(state->graph->nedges, 1), int);
     mark_crossings(state);           /* sets up `crosses' and `completed' */
 
     return state;
@@ -868,8 +972,9 @@ static game_state *dup_game(const game_state *state)
     ret->solution->refcount++;
     ret->completed = state->completed;
     ret->autosolve = state->autosolve;
-    ret->crosses = snewn(count234(ret->graph->edges), int);
-    memcpy(ret->crosses, state->crosses, count234(ret->graph->edges) * sizeof(int));
+    ret->ncrosses = state->ncrosses;
+    ret->crosses = snewn(max(ret->graph->nedges, 1), int);
+    memcpy(ret->crosses, state->crosses, ret->graph->nedges * sizeof(int));
 
     return ret;
 }
@@ -881,6 +986,9 @@ static void free_game(game_state *state)
         while ((e = delpos234(state->graph->edges, 0)) != NULL)
             sfree(e);
         freetree234(state->graph->edges);
+        sfree(state->graph->earray);
+        sfree(state->graph->incstart);
+        sfree(state->graph->incident);
         sfree(state->graph);
     }
     if (--state->solution->refcount <= 0) {
@@ -1272,7 +1380,7 @@ static char *interpret_move(const game_state *state, game_ui *ui,
 static game_state *execute_move(const game_state *state, const game_ui *ui, const char *move)
 {
     int n = state->params.n;
-    int p, k;
+    int p, k, moved = -1, nmoves = 0;
     long x, y, d;
     game_state *ret = dup_game(state);
 
@@ -1288,6 +1396,8 @@ static game_state *execute_move(const game_state *state, const game_ui *ui, cons
             ret->pts[p].x = x;
             ret->pts[p].y = y;
             ret->pts[p].d = d;
+            moved = p;
+            nmoves++;
             move += k+1;
             if (*move == ';') move++;
         } else {
@@ -1296,7 +1406,15 @@ static game_state *execute_move(const game_state *state, const game_ui *ui, cons
         }
     }
 
-    mark_crossings(ret);
+    /*
+     * An ordinary drag moves a single point, and only the edges at
+     * that point need rechecking. Anything bigger (a solve) gets the
+     * full sweep.
+     */
+    if (nmoves == 1)
+        mark_crossings_moved(ret, state->pts, moved);
+    else
+        mark_crossings(ret);
 
     return ret;
 }
@@ -1548,6 +1666,7 @@ const struct game thegame = {
     dup_game,
     free_game,
     true, solve_game,
+    NULL, /* hint */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     true, get_prefs, set_prefs,
     new_ui,
@@ -1559,6 +1678,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, /* execute_move_in_place */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
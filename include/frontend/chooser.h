@@ -75,6 +75,6 @@ extern void stateSetFavorite(const char *name);
 extern void stateUnsetFavorite(const char *name);
 extern bool stateIsFavorite(const char *name);
 extern void configAddItem(char *key, char *value);
-extern void configDel();
+extern void stateReset();
 
 #endif
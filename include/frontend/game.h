@@ -5,10 +5,30 @@
 
 bool gameInitialized;
 
-typedef struct {
-  int x;
-  int y;
-} MWPOINT;
+struct dirtyrect {
+  int x, y, w, h;
+  long cost;                /* Cost of updating the areas merged into it separately */
+};
+
+#define FONTCACHE_SIZE 8          /* Fonts kept open for ink_draw_text */
+#define METRICSCACHE_SIZE 64      /* Remembered text sizes of short strings */
+#define METRICS_MAXLEN 7
+
+struct cachedfont {
+  int face;
+  int size;
+  ifont *font;              /* NULL for an unused slot */
+  unsigned long lastuse;
+};
+
+struct textmetrics {
+  int face;
+  int size;                 /* 0 for an unused slot */
+  int flags;
+  char text[METRICS_MAXLEN+1];
+  int width;
+  int height;
+};
 
 struct frontend {
   const struct game *currentgame;
@@ -20,6 +40,7 @@ struct frontend {
 
   int numGameButtons;       /* Number of menu + control buttons */
   BUTTON *gameButton;       /* Array of game buttons */
+  bool *btnTapped;          /* Whether each button is currently drawn tapped */
 
   int btnSwapIDX;
   int btnUndoIDX;
@@ -43,6 +64,9 @@ struct frontend {
   irect cliprect;           /* Initial screen clip rectangle upon game init */
 
   bool do_update;     /* Update the screen flag */
+  struct dirtyrect *dirty;  /* Screen areas changed since the last update */
+  int ndirty, dirtysize;
+  int update_threshold;     /* Changed area (% of screen) above which the whole screen is updated */
 
   struct timeval last_time;
   int time_int;
@@ -51,8 +75,13 @@ struct frontend {
   game_params *pparams;
   int ncolours;
   float *colours;
+  int *palette;             /* colours converted to InkView format */
   ifont *gamefont;
   int gfontsize;
+
+  struct cachedfont fontcache[FONTCACHE_SIZE];
+  unsigned long fontclock;
+  struct textmetrics metricscache[METRICSCACHE_SIZE];
 };
 
 struct blitter {
@@ -120,14 +149,23 @@ static void gameDrawControlButtons();
 static void gameDrawStatusBar();
 
 static bool coord_in_gamecanvas(int x, int y);
+static void gameBuildPalette();
+static ifont *gameGetFont(int face, int size);
+static void gameGetTextSize(int face, int size, int flags, const char *text, int *width, int *height);
+static void gameFreeFonts();
 void gamePrepareFrontend();
 static BUTTON gameGetButton(const char *gameName, char key);
 static LAYOUTTYPE gameGetLayout();
 static void gameDrawFurniture();
 static void gameCheckButtonState();
+static void gameSetButtonTapped(int i, bool tapped);
+static void gameMarkDirty(int x, int y, int w, int h);
+static void gameMarkButton(BUTTON *button);
+static void gameFlushUpdates();
 
 static void gameRestartGame();
 static void gameSolveGame();
+static void gameHintGame();
 static void gameSwitchPreset(int index);
 
 void gameStartNewGame();
@@ -148,6 +186,7 @@ void gameNext();
 void gameSerialise();
 extern void stateSerialise(midend *me);
 extern void configAddItem(const char *key, const char *value);
+extern char *configGetItem(const char *key);
 
 extern void paramPrepare(midend *me, int ptype);
 
@@ -156,8 +195,7 @@ void ink_draw_text(void *handle, int x, int y, int fonttype, int fontsize,
 void ink_draw_rect(void *handle, int x, int y, int w, int h, int colour);
 void ink_draw_rect_outline(void *handle, int x, int y, int w, int h, int colour);
 void ink_draw_line(void *handle, int x1, int y1, int x2, int y2, int colour);
-static void extendrow(int y, int x1, int y1, int x2, int y2, int *minxptr, int *maxxptr);
-void ink_draw_polygon(void *handle, const int *icoords, int npoints,
+void ink_draw_polygon(void *handle, const int *coords, int npoints,
                   int fillcolour, int outlinecolour);
 void ink_draw_circle(void *handle, int cx, int cy, int radius, int fillcolour, int outlinecolour);
 void ink_clip(void *handle, int x, int y, int w, int h);
@@ -6,11 +6,11 @@
 
 bool stateInitialized;
 
-typedef struct dict_t_struct {
-    char *key;
-    char *value;
-    struct dict_t_struct *next;
-} dict_t;
+typedef struct configentry {
+    char *key;          /* NULL for an empty slot */
+    char *value;        /* NULL if the item has been deleted */
+    bool dirty;         /* changed since the config was last saved */
+} configentry;
 
 struct serialise_buf {
     unsigned char *buf;
@@ -44,6 +44,7 @@ void stateSetFavorite(const char *name);
 void stateUnsetFavorite(const char *name);
 bool stateIsFavorite(const char *name);
 
+void stateReset();
 void stateInit();
 void stateFree();
 
@@ -46,10 +46,9 @@ struct grid_face {
    * you want to draw any symbol or text in the face (e.g. clue
    * numbers in Loopy), that's the place it will most easily fit.
    *
-   * When a grid is first generated, no face has this information
-   * computed, because it's fiddly to do. You can call
-   * grid_find_incentre() on a face, and it will fill in ix,iy below
-   * and set has_incentre to indicate that it's done so.
+   * It's fiddly to compute, so the grid generators leave it out and
+   * grid_find_incentre() fills in ix,iy below and sets has_incentre.
+   * grid_new() does that for every face before handing a grid out.
    */
   bool has_incentre;
   int ix, iy;      /* incentre (centre of largest inscribed circle) */
@@ -90,6 +89,10 @@ typedef struct grid {
    * of a square cell. */
   int tilesize;
 
+  /* Bucket index for the hit-testing functions below, built by
+   * grid_new(). */
+  struct grid_spatial *spatial;
+
   /* We really don't want to copy this monstrosity!
    * A grid is immutable once generated.
    */
@@ -127,11 +130,19 @@ char *grid_new_desc(grid_type type, int width, int height, random_state *rs);
 const char *grid_validate_desc(grid_type type, int width, int height,
                                const char *desc);
 
+/* Grids made recently are kept and shared: asking again for the same
+ * type, size and desc returns the same grid with another reference
+ * taken. So a grid must not be modified once grid_new has returned it. */
 grid *grid_new(grid_type type, int width, int height, const char *desc);
 
+/* Take another reference to a grid. This and grid_free may be called
+ * on several threads at once. */
+grid *grid_ref(grid *g);
 void grid_free(grid *g);
 
 grid_edge *grid_nearest_edge(grid *g, int x, int y);
+grid_face *grid_nearest_face(grid *g, int x, int y);
+grid_dot *grid_nearest_dot(grid *g, int x, int y);
 
 void grid_compute_size(grid_type type, int width, int height,
                        int *tilesize, int *xextent, int *yextent);
@@ -5,6 +5,10 @@
 
 typedef unsigned char digit;
 
+/* A set of digits (bit n-1 for digit n), or of x or y positions. */
+typedef unsigned int latin_mask;
+#define LATIN_MAXORDER 32
+
 /* --- Solver structures, definitions --- */
 
 struct latin_solver {
@@ -16,6 +20,16 @@ struct latin_solver {
   unsigned char *row;   /* o^2: row[y*cr+n-1] true if n is in row y */
   unsigned char *col;   /* o^2: col[x*cr+n-1] true if n is in col x */
 
+  /*
+   * The same information as the cube, as bitmasks, which the
+   * built-in deductions work on:
+   */
+  latin_mask *cellmask; /* o^2: cellmask[y*o+x] bit n-1 if n possible at x,y */
+  latin_mask *rowpos;   /* o^2: rowpos[y*o+n-1] bit x if n possible at x,y */
+  latin_mask *colpos;   /* o^2: colpos[x*o+n-1] bit y if n possible at x,y */
+
+  arena *arena;         /* holds cube, row, col and all scratch space,
+                           shared with the solvers used for recursion */
 };
 #define cubepos(x,y,n) (((x)*solver->o+(y))*solver->o+(n)-1)
 #define cube(x,y,n) (solver->cube[cubepos(x,y,n)])
@@ -29,6 +43,14 @@ struct latin_solver {
 /* Place a value at a specific location. */
 void latin_solver_place(struct latin_solver *solver, int x, int y, int n);
 
+/* Rule out a value at a specific location. This keeps the bitmasks up
+ * to date; a user solver which instead writes to cube() directly
+ * still works, because the masks are rebuilt from the cube (by
+ * latin_solver_sync) whenever a user solver reports progress, and at
+ * the start of latin_solver_main. */
+void latin_solver_clear(struct latin_solver *solver, int x, int y, int n);
+void latin_solver_sync(struct latin_solver *solver);
+
 /* Positional elimination. */
 int latin_solver_elim(struct latin_solver *solver, int start, int step);
 
@@ -54,10 +76,10 @@ int latin_solver_forcing(struct latin_solver *solver,
 bool latin_solver_alloc(struct latin_solver *solver, digit *grid, int o);
 void latin_solver_free(struct latin_solver *solver);
 
-/* Allocates scratch space (for _set and _forcing) */
+/* Allocates scratch space (for _set and _forcing) from the solver's
+ * arena. It is freed along with the solver. */
 struct latin_solver_scratch *
   latin_solver_new_scratch(struct latin_solver *solver);
-void latin_solver_free_scratch(struct latin_solver_scratch *scratch);
 
 
 /* --- Solver guts --- */
@@ -85,6 +85,8 @@ enum {
 #define REQUIRE_RBUTTON ( 1 << 10 )
 /* Pocket PC: Game requires numeric input */
 #define REQUIRE_NUMPAD ( 1 << 11 )
+/* Midend may drop undo states and rebuild them by replaying moves */
+#define UNDO_KEYFRAMES ( 1 << 12 )
 /* end of `flags' word definitions */
 
 #define IGNOREARG(x) ( (x) = (x) )
@@ -272,6 +274,10 @@ blitter *blitter_new(drawing *dr, int w, int h);
 void blitter_free(drawing *dr, blitter *bl);
 void blitter_save(drawing *dr, blitter *bl, int x, int y);
 void blitter_load(drawing *dr, blitter *bl, int x, int y);
+typedef void (*tile_painter)(drawing *dr, int x, int y, int w, int h,
+                             int id, bool highlight);
+void draw_cached_tile(drawing *dr, tile_painter paint, int x, int y,
+                      int w, int h, int id, bool highlight);
 
 /*
  * midend.c
@@ -286,6 +292,9 @@ void midend_size(midend *me, int *x, int *y, bool user_size,
                  double device_pixel_ratio);
 void midend_reset_tilesize(midend *me);
 void midend_new_game(midend *me);
+void midend_enable_pregeneration(midend *me, int depth);
+bool midend_pregenerated_available(midend *me);
+void midend_set_undo_budget(midend *me, int nstates);
 void midend_restart_game(midend *me);
 void midend_stop_anim(midend *me);
 enum { PKR_QUIT = 0, PKR_SOME_EFFECT, PKR_NO_EFFECT, PKR_UNUSED };
@@ -309,6 +318,7 @@ char *midend_get_random_seed(midend *me);
 bool midend_can_format_as_text_now(midend *me);
 char *midend_text_format(midend *me);
 const char *midend_solve(midend *me);
+const char *midend_hint(midend *me);
 int midend_status(midend *me);
 bool midend_can_undo(midend *me);
 bool midend_can_redo(midend *me);
@@ -344,6 +354,7 @@ void *smalloc(size_t size);
 void *srealloc(void *p, size_t size);
 void sfree(void *p);
 char *dupstr(const char *s);
+unsigned long smalloc_count(void);
 #define snew(type) \
     ( (type *) smalloc (sizeof (type)) )
 #define snewn(number, type) \
@@ -351,6 +362,32 @@ char *dupstr(const char *s);
 #define sresize(array, number, type) \
     ( (type *) srealloc ((array), (number) * sizeof (type)) )
 
+/*
+ * Arena allocation, for scratch space which is allocated piecemeal
+ * and all freed at once (typically the working memory of one solver
+ * run). Allocations are carved out of large blocks obtained with
+ * smalloc, and are never freed individually: arena_reset frees
+ * everything allocated so far (keeping the blocks for reuse),
+ * arena_restore frees everything allocated since the matching
+ * arena_save, and arena_free gives the blocks back. A blocksize of 0
+ * to arena_new picks a default.
+ */
+typedef struct arena arena;
+typedef struct arena_pos {
+    struct arena_block *block;
+    size_t used;
+} arena_pos;
+arena *arena_new(size_t blocksize);
+void *arena_alloc(arena *a, size_t size);
+arena_pos arena_save(arena *a);
+void arena_restore(arena *a, arena_pos pos);
+void arena_reset(arena *a);
+void arena_free(arena *a);
+#define anew(a, type) \
+    ( (type *) arena_alloc ((a), sizeof (type)) )
+#define anewn(a, number, type) \
+    ( (type *) arena_alloc ((a), (number) * sizeof (type)) )
+
 /*
  * misc.c
  */
@@ -396,6 +433,23 @@ void draw_rect_corners(drawing *dr, int cx, int cy, int r, int col);
 char *move_cursor(int button, int *x, int *y, int maxw, int maxh, bool wrap,
                   bool *visible);
 
+/* Move string parsing. move_read_int reads a decimal integer, with
+ * optional minus sign, at *p; move_read_ints reads up to max of them
+ * separated by commas and returns how many it found. Both advance *p
+ * past what they read. move_next_item reads one item of the common
+ * form "<letter><int>,<int>...", followed by ';' or the end of the
+ * string; it returns 1 for an item, 0 at the end of the string and
+ * -1 if the item is followed by anything else. */
+#define MOVE_ITEM_MAXARGS 8
+typedef struct move_item {
+    char c;
+    int nargs;
+    int args[MOVE_ITEM_MAXARGS];
+} move_item;
+bool move_read_int(const char **p, int *n);
+int move_read_ints(const char **p, int *out, int max);
+int move_next_item(const char **p, move_item *item);
+
 /* Used in netslide.c and sixteen.c for cursor movement around edge. */
 int c2pos(int w, int h, int cx, int cy);
 int c2diff(int w, int h, int cx, int cy, int button);
@@ -461,6 +515,16 @@ int dsf_canonify_flip(DSF *dsf, int n, bool *flip);
 /* Reinitialise a dsf to the starting 'all elements distinct' state. */
 void dsf_reinit(DSF *dsf);
 
+/* Checkpoints for backtracking solvers. dsf_checkpoint returns a mark
+ * for the current state; dsf_rollback undoes every merge made since
+ * then, and dsf_commit keeps them. Checkpoints nest, and each must be
+ * closed by exactly one of the two, innermost first. Path compression
+ * is suspended while any checkpoint is open, so a rollback costs only
+ * the merges it undoes. Works on all types of dsf. */
+int dsf_checkpoint(DSF *dsf);
+void dsf_rollback(DSF *dsf, int checkpoint);
+void dsf_commit(DSF *dsf, int checkpoint);
+
 
 /*
  * tdq.c
@@ -623,6 +687,35 @@ void arraysort_fn(void *array, size_t nmemb, size_t size,
 #define arraysort(array, nmemb, cmp, ctx) \
     arraysort_fn(array, nmemb, sizeof(*(array)), cmp, ctx)
 
+/*
+ * batchgen.c: generate descriptions for a list of seeds on a pool of
+ * worker threads. The result function is called once per seed, in
+ * whatever order the results complete (index says which seed it
+ * was), and never on two threads at once; the strings it is passed
+ * are freed after it returns. The output for each seed is identical
+ * to what a single-threaded non-interactive generation produces.
+ */
+typedef void (*batchgen_result_fn)(void *ctx, int index, const char *seed,
+                                   const char *desc, const char *aux);
+void batch_generate(const game *ourgame, const game_params *params,
+                    const char *const *seeds, int nseeds, int nthreads,
+                    batchgen_result_fn result, void *ctx);
+
+/*
+ * reduce.c: remove clues from a puzzle one at a time, in the order
+ * given, keeping each removal for which check() still reports a
+ * unique solution. present[] is indexed by clue and updated in place.
+ * REDUCE_MONOTONE says that adding clues never breaks uniqueness,
+ * which lets several clues be removed per check. nthreads > 1 checks
+ * several candidates at once, in which case check() must be safe to
+ * call on several threads; 0 means one thread per processor. The
+ * result is the same as removing the clues one by one.
+ */
+typedef bool (*reduce_check_fn)(void *ctx, const bool *present);
+#define REDUCE_MONOTONE 1
+void reduce_clues(const int *order, int nclues, bool *present,
+                  reduce_check_fn check, void *ctx, int flags, int nthreads);
+
 /*
  * Data structure containing the function calls and data specific
  * to a particular game. This is enclosed in a data structure so
@@ -655,6 +748,7 @@ struct game {
     bool can_solve;
     char *(*solve)(const game_state *orig, const game_state *curr,
                    const char *aux, const char **error);
+    char *(*hint)(const game_state *state, game_ui *ui, const char **error);
     bool can_format_as_text_ever;
     bool (*can_format_as_text_now)(const game_params *params);
     char *(*text_format)(const game_state *state);
@@ -674,6 +768,8 @@ struct game {
     char *(*interpret_move)(const game_state *state, game_ui *ui,
                             const game_drawstate *ds, int x, int y, int button, bool swapped);
     game_state *(*execute_move)(const game_state *state, const game_ui *ui, const char *move);
+    bool (*execute_move_in_place)(game_state *state, const game_ui *ui,
+                                  const char *move);
     int preferred_tilesize;
     void (*compute_size)(const game_params *params, int tilesize,
                          const game_ui *ui, int *x, int *y);
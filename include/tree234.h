@@ -49,6 +49,7 @@ typedef struct node234_Tag node234;
 struct tree234_Tag {
     node234 *root;
     cmpfn234 cmp;
+    struct node234_pool *pool;         /* where root's nodes come from */
 };
 
 struct node234_Tag {
@@ -68,6 +69,15 @@ int height234(tree234 *t);
  */
 tree234 *newtree234(cmpfn234 cmp);
 
+/*
+ * Create a 2-3-4 tree holding the n elements of an array, in the
+ * order they appear there. This is much quicker than adding them one
+ * at a time. If `cmp' is non-NULL, the caller is responsible for the
+ * array being sorted according to it, with no two elements comparing
+ * equal; if it isn't, lookups in the resulting tree will go wrong.
+ */
+tree234 *buildtree234_sorted(cmpfn234 cmp, void **elems, int n);
+
 /*
  * Free a 2-3-4 tree (not including freeing the elements).
  */
@@ -0,0 +1,108 @@
+/*
+ * batchgen.c: generate game descriptions for a list of seeds in
+ * parallel, for bulk export of puzzles.
+ *
+ * The midend isn't thread-safe (it has a single random_state shared
+ * by everything it does), so this talks directly to the game's
+ * new_desc function. Each worker thread has its own copy of the
+ * parameters, and each description is generated from a fresh
+ * random_state seeded with its seed string, which is exactly what a
+ * non-interactive midend does for a game ID of the form
+ * 'params#seed'. So the output for a given seed is byte-for-byte the
+ * same however many threads are used and whichever order they finish
+ * in.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "puzzles.h"
+
+struct batchgen {
+    const game *ourgame;
+    const game_params *params;
+    const char *const *seeds;
+    int nseeds;
+    batchgen_result_fn result;
+    void *ctx;
+
+    pthread_mutex_t lock;              /* protects next and the callback */
+    int next;
+};
+
+static void *batchgen_worker(void *vctx)
+{
+    struct batchgen *bg = (struct batchgen *)vctx;
+    game_params *params = bg->ourgame->dup_params(bg->params);
+
+    while (1) {
+        random_state *rs;
+        const char *seed;
+        char *desc, *aux = NULL;
+        int index;
+
+        pthread_mutex_lock(&bg->lock);
+        index = bg->next++;
+        pthread_mutex_unlock(&bg->lock);
+        if (index >= bg->nseeds)
+            break;
+
+        seed = bg->seeds[index];
+        rs = random_new(seed, strlen(seed));
+        desc = bg->ourgame->new_desc(params, rs, &aux, false);
+        random_free(rs);
+
+        /* Results are handed over one at a time, in completion order. */
+        pthread_mutex_lock(&bg->lock);
+        bg->result(bg->ctx, index, seed, desc, aux);
+        pthread_mutex_unlock(&bg->lock);
+
+        sfree(desc);
+        sfree(aux);
+    }
+
+    bg->ourgame->free_params(params);
+    return NULL;
+}
+
+void batch_generate(const game *ourgame, const game_params *params,
+                    const char *const *seeds, int nseeds, int nthreads,
+                    batchgen_result_fn result, void *ctx)
+{
+    struct batchgen bg;
+    pthread_t *threads;
+    int i, nstarted;
+
+    bg.ourgame = ourgame;
+    bg.params = params;
+    bg.seeds = seeds;
+    bg.nseeds = nseeds;
+    bg.result = result;
+    bg.ctx = ctx;
+    bg.next = 0;
+    pthread_mutex_init(&bg.lock, NULL);
+
+    if (nthreads > nseeds)
+        nthreads = nseeds;
+
+    threads = snewn(nthreads > 0 ? nthreads : 1, pthread_t);
+    for (nstarted = 0; nstarted < nthreads; nstarted++)
+        if (pthread_create(&threads[nstarted], NULL, batchgen_worker, &bg))
+            break;
+
+    /*
+     * If we couldn't start any threads at all (or weren't asked to),
+     * do the whole job on the calling thread. Otherwise the calling
+     * thread just waits; anything left over when a thread failed to
+     * start is picked up by the ones that did.
+     */
+    if (nstarted == 0)
+        batchgen_worker(&bg);
+    for (i = 0; i < nstarted; i++)
+        pthread_join(threads[i], NULL);
+    assert(bg.next >= nseeds);
+
+    sfree(threads);
+    pthread_mutex_destroy(&bg.lock);
+}
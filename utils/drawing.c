@@ -39,6 +39,18 @@ struct drawing {
      * this may set it to NULL. */
     midend *me;
     char *laststatus;
+    /* Tiles already rasterised by draw_cached_tile() */
+    struct cached_tile *tiles;
+    int ntiles;
+};
+
+#define MAX_CACHED_TILES 64
+
+struct cached_tile {
+    tile_painter paint;
+    int id, w, h;
+    bool highlight;
+    blitter *bl;
 };
 
 drawing *drawing_new(const drawing_api *api, midend *me, void *handle)
@@ -49,11 +61,24 @@ drawing *drawing_new(const drawing_api *api, midend *me, void *handle)
     dr->scale = 1.0F;
     dr->me = me;
     dr->laststatus = NULL;
+    dr->tiles = NULL;
+    dr->ntiles = 0;
     return dr;
 }
 
+static void drawing_free_tiles(drawing *dr)
+{
+    int i;
+
+    for (i = 0; i < dr->ntiles; i++)
+        blitter_free(dr, dr->tiles[i].bl);
+    dr->ntiles = 0;
+}
+
 void drawing_free(drawing *dr)
 {
+    drawing_free_tiles(dr);
+    sfree(dr->tiles);
     sfree(dr->laststatus);
     sfree(dr);
 }
@@ -221,3 +246,49 @@ void blitter_load(drawing *dr, blitter *bl, int x, int y)
     dr->api->blitter_load(dr->handle, bl, x, y);
 }
 
+/*
+ * Draw a w x h tile of texture 'id' at (x,y). The first time a given
+ * texture, size and highlight is asked for, paint() draws it, clipped
+ * to the tile, and the result is saved to a blitter; after that the
+ * tile is a single blitter_load. paint() must depend only on its
+ * arguments and draw the same pixels relative to (x,y) wherever the
+ * tile is placed.
+ */
+void draw_cached_tile(drawing *dr, tile_painter paint, int x, int y,
+                      int w, int h, int id, bool highlight)
+{
+    struct cached_tile *t;
+    int i;
+
+    if (!dr->api->blitter_new) {
+        paint(dr, x, y, w, h, id, highlight);
+        return;
+    }
+
+    for (i = 0; i < dr->ntiles; i++) {
+        t = &dr->tiles[i];
+        if (t->paint == paint && t->id == id && t->w == w && t->h == h &&
+            t->highlight == highlight) {
+            blitter_load(dr, t->bl, x, y);
+            return;
+        }
+    }
+
+    clip(dr, x, y, w, h);
+    paint(dr, x, y, w, h, id, highlight);
+    unclip(dr);
+
+    /* Tile sizes only change on a resize, so just start afresh */
+    if (dr->ntiles == MAX_CACHED_TILES)
+        drawing_free_tiles(dr);
+    if (!dr->tiles)
+        dr->tiles = snewn(MAX_CACHED_TILES, struct cached_tile);
+    t = &dr->tiles[dr->ntiles++];
+    t->paint = paint;
+    t->id = id;
+    t->w = w;
+    t->h = h;
+    t->highlight = highlight;
+    t->bl = blitter_new(dr, w, h);
+    blitter_save(dr, t->bl, x, y);
+}
@@ -52,6 +52,21 @@ struct DSF {
      * If n is not a canonical element, min[n] is unused.
      */
     unsigned *min;
+
+    /*
+     * Undo log, kept while there are checkpoints outstanding (depth >
+     * 0). Each merge records the root that stopped being canonical,
+     * the size of its class and the previous minimum of the root it
+     * was merged into. Path compression is suspended meanwhile, so
+     * that the old root's parent is still the new root when the merge
+     * is undone. Since every merge reduces the number of classes, the
+     * log never needs more than size entries.
+     */
+    struct dsf_undo {
+        unsigned child, size, min;
+    } *undo;
+    size_t nundo;
+    int depth;
 };
 
 static DSF *dsf_new_internal(int size, bool flip, bool min)
@@ -65,6 +80,9 @@ static DSF *dsf_new_internal(int size, bool flip, bool min)
     dsf->parent_or_size = snewn(size, unsigned);
     dsf->flip = flip ? snewn(size, unsigned char) : NULL;
     dsf->min = min ? snewn(size, unsigned) : NULL;
+    dsf->undo = NULL;
+    dsf->nundo = 0;
+    dsf->depth = 0;
 
     dsf_reinit(dsf);
 
@@ -90,6 +108,8 @@ void dsf_reinit(DSF *dsf)
 {
     size_t i;
 
+    assert(dsf->depth == 0 && "dsf_reinit with a checkpoint outstanding");
+
     /* Every element starts as the root of an equivalence class of size 1 */
     for (i = 0; i < dsf->size; i++)
         dsf->parent_or_size[i] = DSF_FLAG_CANONICAL | 1;
@@ -107,6 +127,7 @@ void dsf_reinit(DSF *dsf)
 void dsf_copy(DSF *to, DSF *from)
 {
     assert(to->size == from->size && "Mismatch in dsf_copy");
+    assert(to->depth == 0 && "dsf_copy with a checkpoint outstanding");
     memcpy(to->parent_or_size, from->parent_or_size,
            to->size * sizeof(*to->parent_or_size));
     if (to->flip) {
@@ -126,6 +147,7 @@ void dsf_free(DSF *dsf)
         sfree(dsf->parent_or_size);
         sfree(dsf->flip);
         sfree(dsf->min);
+        sfree(dsf->undo);
         sfree(dsf);
     }
 }
@@ -139,6 +161,8 @@ static inline size_t dsf_find_root(DSF *dsf, size_t n)
 
 static inline void dsf_path_compress(DSF *dsf, size_t n, size_t root)
 {
+    if (dsf->depth)
+        return;
     while (!(dsf->parent_or_size[n] & DSF_FLAG_CANONICAL)) {
         size_t prev = n;
         n = dsf->parent_or_size[n];
@@ -147,6 +171,20 @@ static inline void dsf_path_compress(DSF *dsf, size_t n, size_t root)
     assert(n == root);
 }
 
+static inline void dsf_log_merge(DSF *dsf, size_t child, size_t root,
+                                 size_t childsize)
+{
+    struct dsf_undo *u;
+
+    if (!dsf->depth)
+        return;
+    assert(dsf->nundo < dsf->size);
+    u = &dsf->undo[dsf->nundo++];
+    u->child = child;
+    u->size = childsize;
+    u->min = dsf->min ? dsf->min[root] : 0;
+}
+
 int dsf_canonify(DSF *dsf, int n)
 {
     size_t root;
@@ -180,8 +218,10 @@ void dsf_merge(DSF *dsf, int n1, int n2)
         s1 = dsf->parent_or_size[r1] & DSF_INDEX_MASK;
         s2 = dsf->parent_or_size[r2] & DSF_INDEX_MASK;
         if (s1 > s2) {
+            dsf_log_merge(dsf, r2, r1, s2);
             dsf->parent_or_size[r2] = root = r1;
         } else {
+            dsf_log_merge(dsf, r1, r2, s1);
             dsf->parent_or_size[r1] = root = r2;
         }
         dsf->parent_or_size[root] = (s1 + s2) | DSF_FLAG_CANONICAL;
@@ -222,6 +262,8 @@ static inline size_t dsf_find_root_flip(DSF *dsf, size_t n, unsigned *flip)
 static inline void dsf_path_compress_flip(DSF *dsf, size_t n, size_t root,
                                           unsigned flip)
 {
+    if (dsf->depth)
+        return;
     while (!(dsf->parent_or_size[n] & DSF_FLAG_CANONICAL)) {
         size_t prev = n;
         unsigned flip_prev = flip;
@@ -271,10 +313,12 @@ void dsf_merge_flip(DSF *dsf, int n1, int n2, bool inverse)
         s1 = dsf->parent_or_size[r1] & DSF_INDEX_MASK;
         s2 = dsf->parent_or_size[r2] & DSF_INDEX_MASK;
         if (s1 > s2) {
+            dsf_log_merge(dsf, r2, r1, s2);
             dsf->parent_or_size[r2] = root = r1;
             dsf->flip[r2] = f1 ^ f2 ^ inverse;
             f2 ^= dsf->flip[r2];
         } else {
+            dsf_log_merge(dsf, r1, r2, s1);
             root = r2;
             dsf->parent_or_size[r1] = root = r2;
             dsf->flip[r1] = f1 ^ f2 ^ inverse;
@@ -303,3 +347,43 @@ int dsf_minimal(DSF *dsf, int n)
     root = dsf_canonify(dsf, n);
     return dsf->min[root];
 }
+
+int dsf_checkpoint(DSF *dsf)
+{
+    if (!dsf->undo)
+        dsf->undo = snewn(dsf->size, struct dsf_undo);
+    dsf->depth++;
+    return dsf->nundo;
+}
+
+void dsf_rollback(DSF *dsf, int checkpoint)
+{
+    assert(dsf->depth > 0 && "dsf_rollback without a checkpoint");
+    assert(0 <= checkpoint && (size_t)checkpoint <= dsf->nundo &&
+           "Bad checkpoint in dsf_rollback");
+
+    while (dsf->nundo > (size_t)checkpoint) {
+        struct dsf_undo *u = &dsf->undo[--dsf->nundo];
+        size_t root = dsf->parent_or_size[u->child];
+
+        assert(!(root & DSF_FLAG_CANONICAL));
+        dsf->parent_or_size[root] =
+            ((dsf->parent_or_size[root] & DSF_INDEX_MASK) - u->size) |
+            DSF_FLAG_CANONICAL;
+        dsf->parent_or_size[u->child] = u->size | DSF_FLAG_CANONICAL;
+        if (dsf->min)
+            dsf->min[root] = u->min;
+    }
+
+    dsf_commit(dsf, checkpoint);
+}
+
+void dsf_commit(DSF *dsf, int checkpoint)
+{
+    assert(dsf->depth > 0 && "dsf_commit without a checkpoint");
+    assert(0 <= checkpoint && (size_t)checkpoint <= dsf->nundo &&
+           "Bad checkpoint in dsf_commit");
+
+    if (--dsf->depth == 0)
+        dsf->nundo = 0;
+}
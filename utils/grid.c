@@ -14,20 +14,28 @@
 #include <float.h>
 #include <limits.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "puzzles.h"
 #include "tree234.h"
 #include "grid.h"
 
+static void grid_free_spatial(struct grid_spatial *sp);
+
 /* ----------------------------------------------------------------------
  * Deallocate or dereference a grid
  */
+grid *grid_ref(grid *g)
+{
+    __atomic_add_fetch(&g->refcount, 1, __ATOMIC_RELAXED);
+    return g;
+}
+
 void grid_free(grid *g)
 {
-    assert(g->refcount);
+    assert(__atomic_load_n(&g->refcount, __ATOMIC_RELAXED));
 
-    g->refcount--;
-    if (g->refcount == 0) {
+    if (__atomic_sub_fetch(&g->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
         int i;
         for (i = 0; i < g->num_faces; i++) {
             sfree(g->faces[i]->dots);
@@ -45,6 +53,7 @@ void grid_free(grid *g)
         sfree(g->faces);
         sfree(g->edges);
         sfree(g->dots);
+        grid_free_spatial(g->spatial);
         sfree(g);
     }
 }
@@ -61,6 +70,7 @@ static grid *grid_empty(void)
     g->size_faces = g->size_edges = g->size_dots = 0;
     g->refcount = 1;
     g->lowest_x = g->lowest_y = g->highest_x = g->highest_y = 0;
+    g->spatial = NULL;
     return g;
 }
 
@@ -88,6 +98,163 @@ static double point_line_distance(long px, long py,
     return det / len;
 }
 
+/* ----------------------------------------------------------------------
+ * Spatial index for hit-testing.
+ *
+ * The grid's bounding box is divided into square buckets about one
+ * tile across, and every edge, face and dot is listed in each bucket
+ * that its region of interest overlaps: for a face that's its
+ * bounding box, for an edge it's the area in which grid_nearest_edge
+ * would accept it (its bounding box widened by half its length on
+ * every side), and a dot goes in the one bucket containing it.
+ * Each bucket's list is in increasing index order, so scanning a
+ * bucket visits candidates in the same order as a scan of the whole
+ * grid would, and ties are resolved the same way.
+ *
+ * The lists are stored compactly: the items in bucket b are
+ * list[start[b]] to list[start[b+1]-1].
+ */
+struct grid_spatial_lists {
+    int *start;
+    int *list;
+};
+
+struct grid_spatial {
+    int x0, y0;          /* grid coordinates of the corner of bucket 0 */
+    int cellsize;
+    int w, h;            /* number of buckets in each direction */
+    struct grid_spatial_lists edges, faces, dots;
+};
+
+static void grid_free_spatial(struct grid_spatial *sp)
+{
+    if (sp) {
+        sfree(sp->edges.start);
+        sfree(sp->edges.list);
+        sfree(sp->faces.start);
+        sfree(sp->faces.list);
+        sfree(sp->dots.start);
+        sfree(sp->dots.list);
+        sfree(sp);
+    }
+}
+
+/* Clamp a coordinate to a bucket column or row. */
+static int grid_spatial_col(const struct grid_spatial *sp, int x)
+{
+    int c = (x < sp->x0 ? -1 : (x - sp->x0) / sp->cellsize);
+    return max(0, min(c, sp->w - 1));
+}
+static int grid_spatial_row(const struct grid_spatial *sp, int y)
+{
+    int r = (y < sp->y0 ? -1 : (y - sp->y0) / sp->cellsize);
+    return max(0, min(r, sp->h - 1));
+}
+
+/*
+ * Fill in one set of bucket lists, given the rectangle of interest of
+ * each of n items. Done in two passes: count, then place.
+ */
+static void grid_spatial_fill(struct grid_spatial *sp,
+                              struct grid_spatial_lists *l, int n,
+                              const int *rects)
+{
+    int nb = sp->w * sp->h, pass, i, r, c;
+    int *pos = snewn(nb + 1, int);
+
+    l->start = snewn(nb + 1, int);
+    for (i = 0; i <= nb; i++)
+        l->start[i] = 0;
+
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < n; i++) {
+            const int *rc = rects + 4*i;
+            int c1 = grid_spatial_col(sp, rc[0]), c2 = grid_spatial_col(sp, rc[2]);
+            int r1 = grid_spatial_row(sp, rc[1]), r2 = grid_spatial_row(sp, rc[3]);
+            for (r = r1; r <= r2; r++)
+                for (c = c1; c <= c2; c++) {
+                    if (pass == 0)
+                        l->start[r * sp->w + c + 1]++;
+                    else
+                        l->list[pos[r * sp->w + c]++] = i;
+                }
+        }
+        if (pass == 0) {
+            for (i = 0; i < nb; i++)
+                l->start[i+1] += l->start[i];
+            l->list = snewn(max(l->start[nb], 1), int);
+            for (i = 0; i <= nb; i++)
+                pos[i] = l->start[i];
+        }
+    }
+
+    sfree(pos);
+}
+
+static struct grid_spatial *grid_get_spatial(grid *g)
+{
+    struct grid_spatial *sp;
+    int *rects, i, j, n;
+    int minx = INT_MAX, miny = INT_MAX, maxx = INT_MIN, maxy = INT_MIN;
+
+    if (g->spatial)
+        return g->spatial;
+
+    for (i = 0; i < g->num_dots; i++) {
+        minx = min(minx, g->dots[i]->x);
+        maxx = max(maxx, g->dots[i]->x);
+        miny = min(miny, g->dots[i]->y);
+        maxy = max(maxy, g->dots[i]->y);
+    }
+    if (g->num_dots == 0)
+        minx = miny = maxx = maxy = 0;
+
+    sp = snew(struct grid_spatial);
+    sp->x0 = minx;
+    sp->y0 = miny;
+    sp->cellsize = max(g->tilesize, 1);
+    sp->w = (maxx - minx) / sp->cellsize + 1;
+    sp->h = (maxy - miny) / sp->cellsize + 1;
+
+    n = max(max(g->num_edges, g->num_faces), g->num_dots);
+    rects = snewn(4 * max(n, 1), int);
+
+    for (i = 0; i < g->num_edges; i++) {
+        grid_edge *e = g->edges[i];
+        long e2 = SQ((long)e->dot1->x - (long)e->dot2->x) +
+                  SQ((long)e->dot1->y - (long)e->dot2->y);
+        int margin = (int)ceil(sqrt((double)e2) / 2) + 1;
+        rects[4*i+0] = min(e->dot1->x, e->dot2->x) - margin;
+        rects[4*i+1] = min(e->dot1->y, e->dot2->y) - margin;
+        rects[4*i+2] = max(e->dot1->x, e->dot2->x) + margin;
+        rects[4*i+3] = max(e->dot1->y, e->dot2->y) + margin;
+    }
+    grid_spatial_fill(sp, &sp->edges, g->num_edges, rects);
+
+    for (i = 0; i < g->num_faces; i++) {
+        grid_face *f = g->faces[i];
+        rects[4*i+0] = rects[4*i+2] = f->dots[0]->x;
+        rects[4*i+1] = rects[4*i+3] = f->dots[0]->y;
+        for (j = 1; j < f->order; j++) {
+            rects[4*i+0] = min(rects[4*i+0], f->dots[j]->x);
+            rects[4*i+1] = min(rects[4*i+1], f->dots[j]->y);
+            rects[4*i+2] = max(rects[4*i+2], f->dots[j]->x);
+            rects[4*i+3] = max(rects[4*i+3], f->dots[j]->y);
+        }
+    }
+    grid_spatial_fill(sp, &sp->faces, g->num_faces, rects);
+
+    for (i = 0; i < g->num_dots; i++) {
+        rects[4*i+0] = rects[4*i+2] = g->dots[i]->x;
+        rects[4*i+1] = rects[4*i+3] = g->dots[i]->y;
+    }
+    grid_spatial_fill(sp, &sp->dots, g->num_dots, rects);
+
+    sfree(rects);
+    g->spatial = sp;
+    return sp;
+}
+
 /* Determine nearest edge to where the user clicked.
  * (x, y) is the clicked location, converted to grid coordinates.
  * Returns the nearest edge, or NULL if no edge is reasonably
@@ -109,14 +276,17 @@ static double point_line_distance(long px, long py,
  */
 grid_edge *grid_nearest_edge(grid *g, int x, int y)
 {
+    struct grid_spatial *sp = grid_get_spatial(g);
     grid_edge *best_edge;
     double best_distance = 0;
-    int i;
+    int b, k;
 
     best_edge = NULL;
 
-    for (i = 0; i < g->num_edges; i++) {
-        grid_edge *e = g->edges[i];
+    /* Only the edges listed in the bucket under (x, y) can qualify. */
+    b = grid_spatial_row(sp, y) * sp->w + grid_spatial_col(sp, x);
+    for (k = sp->edges.start[b]; k < sp->edges.start[b+1]; k++) {
+        grid_edge *e = g->edges[sp->edges.list[k]];
         long e2; /* squared length of edge */
         long a2, b2; /* squared lengths of other sides */
         double dist;
@@ -156,6 +326,97 @@ grid_edge *grid_nearest_edge(grid *g, int x, int y)
     return best_edge;
 }
 
+/*
+ * Determine the face containing the point (x, y), in grid coordinates,
+ * or NULL if it's outside the grid. A point exactly on the boundary
+ * between faces goes to one of them, consistently: the first in
+ * g->faces[] order whose crossing-number test includes it.
+ */
+static bool grid_face_contains(const grid_face *f, long x, long y)
+{
+    bool inside = false;
+    int i, j;
+
+    for (i = 0, j = f->order - 1; i < f->order; j = i++) {
+        long xi = f->dots[i]->x, yi = f->dots[i]->y;
+        long xj = f->dots[j]->x, yj = f->dots[j]->y;
+        /* Does the edge cross the horizontal ray from (x,y) to +infinity? */
+        if ((yi > y) != (yj > y)) {
+            /* Compare x with the crossing point, without dividing */
+            long lhs = (x - xi) * (yj - yi), rhs = (xj - xi) * (y - yi);
+            if (yj > yi ? lhs < rhs : lhs > rhs)
+                inside = !inside;
+        }
+    }
+    return inside;
+}
+
+grid_face *grid_nearest_face(grid *g, int x, int y)
+{
+    struct grid_spatial *sp = grid_get_spatial(g);
+    int b, k;
+
+    if (x < sp->x0 || y < sp->y0 ||
+        x >= sp->x0 + sp->w * sp->cellsize || y >= sp->y0 + sp->h * sp->cellsize)
+        return NULL;
+
+    b = grid_spatial_row(sp, y) * sp->w + grid_spatial_col(sp, x);
+    for (k = sp->faces.start[b]; k < sp->faces.start[b+1]; k++) {
+        grid_face *f = g->faces[sp->faces.list[k]];
+        if (grid_face_contains(f, x, y))
+            return f;
+    }
+    return NULL;
+}
+
+/*
+ * Determine the dot closest to (x, y), lowest index first among equally
+ * close ones. Buckets are searched in growing square rings around the
+ * one nearest (x, y); every dot in ring r+1 or beyond is at least
+ * r * cellsize away, so once we have something closer than that we can
+ * stop.
+ */
+grid_dot *grid_nearest_dot(grid *g, int x, int y)
+{
+    struct grid_spatial *sp = grid_get_spatial(g);
+    grid_dot *best = NULL;
+    long bestd2 = 0;
+    int c0, r0, ring, r, c, k;
+
+    if (g->num_dots == 0)
+        return NULL;
+
+    c0 = grid_spatial_col(sp, x);
+    r0 = grid_spatial_row(sp, y);
+    for (ring = 0; ring < max(sp->w, sp->h); ring++) {
+        for (r = r0 - ring; r <= r0 + ring; r++) {
+            if (r < 0 || r >= sp->h)
+                continue;
+            for (c = c0 - ring; c <= c0 + ring; c++) {
+                int b;
+                if (c < 0 || c >= sp->w)
+                    continue;
+                if (r != r0 - ring && r != r0 + ring &&
+                    c != c0 - ring && c != c0 + ring)
+                    continue;          /* inside the ring, already done */
+                b = r * sp->w + c;
+                for (k = sp->dots.start[b]; k < sp->dots.start[b+1]; k++) {
+                    grid_dot *d = g->dots[sp->dots.list[k]];
+                    long d2 = SQ((long)d->x - x) + SQ((long)d->y - y);
+                    if (!best || d2 < bestd2 ||
+                        (d2 == bestd2 && d->index < best->index)) {
+                        best = d;
+                        bestd2 = d2;
+                    }
+                }
+            }
+        }
+        if (best && bestd2 < SQ((long)ring * sp->cellsize))
+            break;
+    }
+    return best;
+}
+
 /* ----------------------------------------------------------------------
  * Grid generation
  */
@@ -2749,12 +3010,104 @@ const char *grid_validate_desc(grid_type type, int width, int height,
     }
 }
 
+/* ----------------------------------------------------------------------
+ * Cache of recently made grids.
+ *
+ * A grid depends only on its type, size and description, and puzzle
+ * generators ask for the same one over and over: once per attempt at
+ * a new puzzle, again to check the description, and again when the
+ * game starts. So grid_new keeps the last few grids it made, most
+ * recently used first, holding a reference to each, and hands out
+ * further references to them.
+ *
+ * Since one grid can then be in use on several threads, everything
+ * grid.c would otherwise work out on first use (the incentres and the
+ * spatial index) is filled in before a grid goes into the cache, and
+ * after that nothing writes to it.
+ */
+
+#define GRID_CACHE_SIZE 4
+
+struct grid_cache_entry {
+    grid_type type;
+    int width, height;
+    char *desc;
+    grid *g;
+};
+
+static struct grid_cache_entry grid_cache[GRID_CACHE_SIZE];
+static int grid_cache_count;
+static pthread_mutex_t grid_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Look for a grid in the cache, moving it to the front if found.
+ * Must be called with the lock held. Returns a new reference.
+ */
+static grid *grid_cache_find(grid_type type, int width, int height,
+                             const char *desc)
+{
+    struct grid_cache_entry e;
+    int i;
+
+    for (i = 0; i < grid_cache_count; i++) {
+        e = grid_cache[i];
+        if (e.type == type && e.width == width && e.height == height &&
+            (e.desc ? desc && !strcmp(e.desc, desc) : !desc)) {
+            memmove(grid_cache + 1, grid_cache, i * sizeof(*grid_cache));
+            grid_cache[0] = e;
+            return grid_ref(e.g);
+        }
+    }
+    return NULL;
+}
+
 grid *grid_new(grid_type type, int width, int height, const char *desc)
 {
     const char *err = grid_validate_desc(type, width, height, desc);
+    struct grid_cache_entry evicted;
+    grid *g, *cached;
+    int i;
+
     if (err) assert(!"Invalid grid description.");
 
-    return grid_news[type](width, height, desc);
+    pthread_mutex_lock(&grid_cache_lock);
+    g = grid_cache_find(type, width, height, desc);
+    pthread_mutex_unlock(&grid_cache_lock);
+    if (g)
+        return g;
+
+    /* Make the grid without holding the lock, since it can take a while */
+    g = grid_news[type](width, height, desc);
+    for (i = 0; i < g->num_faces; i++)
+        grid_find_incentre(g->faces[i]);
+    grid_get_spatial(g);
+
+    pthread_mutex_lock(&grid_cache_lock);
+    cached = grid_cache_find(type, width, height, desc);
+    if (cached) {
+        /* Another thread got there first */
+        pthread_mutex_unlock(&grid_cache_lock);
+        grid_free(g);
+        return cached;
+    }
+    evicted.g = NULL;
+    evicted.desc = NULL;
+    if (grid_cache_count == GRID_CACHE_SIZE)
+        evicted = grid_cache[--grid_cache_count];
+    memmove(grid_cache + 1, grid_cache,
+            grid_cache_count * sizeof(*grid_cache));
+    grid_cache[0].type = type;
+    grid_cache[0].width = width;
+    grid_cache[0].height = height;
+    grid_cache[0].desc = desc ? dupstr(desc) : NULL;
+    grid_cache[0].g = grid_ref(g);
+    grid_cache_count++;
+    pthread_mutex_unlock(&grid_cache_lock);
+
+    if (evicted.g)
+        grid_free(evicted.g);
+    sfree(evicted.desc);
+    return g;
 }
 
 void grid_compute_size(grid_type type, int width, int height,
@@ -18,6 +18,79 @@ static int latin_solver_top(struct latin_solver *solver, int maxdiff,
                             usersolver_t const *usersolvers, validator_t valid,
                             void *ctx, ctxnew_t ctxnew, ctxfree_t ctxfree);
 
+#define LATIN_FULLMASK(o) ((o) >= LATIN_MAXORDER ? ~(latin_mask)0 : \
+                           ((latin_mask)1 << (o)) - 1)
+
+static int mask_count(latin_mask m)
+{
+#ifdef __GNUC__
+    return __builtin_popcount(m);
+#else
+    int count = 0;
+    for (; m; m &= m - 1)
+        count++;
+    return count;
+#endif
+}
+
+/* Index of the lowest set bit; m must be non-zero. */
+static int mask_first(latin_mask m)
+{
+#ifdef __GNUC__
+    return __builtin_ctz(m);
+#else
+    int i = 0;
+    while (!(m & 1))
+        m >>= 1, i++;
+    return i;
+#endif
+}
+
+void latin_solver_clear(struct latin_solver *solver, int x, int y, int n)
+{
+    int o = solver->o;
+
+    cube(x,y,n) = false;
+    solver->cellmask[y*o+x] &= ~((latin_mask)1 << (n-1));
+    solver->rowpos[y*o+n-1] &= ~((latin_mask)1 << x);
+    solver->colpos[x*o+n-1] &= ~((latin_mask)1 << y);
+}
+
+/* As latin_solver_clear, given a position in the cube. */
+static void latin_solver_clear_pos(struct latin_solver *solver, int pos)
+{
+    int o = solver->o;
+    int x, y, n;
+
+    n = 1 + pos % o;
+    y = pos / o;
+    x = y / o;
+    y %= o;
+    latin_solver_clear(solver, x, y, n);
+}
+
+/*
+ * Rebuild the bitmasks from the cube, after something other than
+ * latin_solver_clear or latin_solver_place has written to it.
+ */
+void latin_solver_sync(struct latin_solver *solver)
+{
+    int o = solver->o;
+    int x, y, n;
+
+    memset(solver->cellmask, 0, o*o * sizeof(latin_mask));
+    memset(solver->rowpos, 0, o*o * sizeof(latin_mask));
+    memset(solver->colpos, 0, o*o * sizeof(latin_mask));
+    for (x = 0; x < o; x++)
+        for (y = 0; y < o; y++)
+            for (n = 1; n <= o; n++)
+                if (cube(x,y,n)) {
+                    solver->cellmask[y*o+x] |= (latin_mask)1 << (n-1);
+                    solver->rowpos[y*o+n-1] |= (latin_mask)1 << x;
+                    solver->colpos[x*o+n-1] |= (latin_mask)1 << y;
+                }
+}
+
 /*
  * Function called when we are certain that a particular square has
  * a particular number in it. The y-coordinate passed in here is
@@ -26,6 +99,7 @@ static int latin_solver_top(struct latin_solver *solver, int maxdiff,
 void latin_solver_place(struct latin_solver *solver, int x, int y, int n)
 {
     int i, o = solver->o;
+    latin_mask m;
 
     assert(n <= o);
     assert(cube(x,y,n));
@@ -33,23 +107,29 @@ void latin_solver_place(struct latin_solver *solver, int x, int y, int n)
     /*
      * Rule out all other numbers in this square.
      */
-    for (i = 1; i <= o; i++)
+    for (m = solver->cellmask[y*o+x]; m; m &= m - 1) {
+        i = mask_first(m) + 1;
         if (i != n)
-            cube(x,y,i) = false;
+            latin_solver_clear(solver, x, y, i);
+    }
 
     /*
      * Rule out this number in all other positions in the row.
      */
-    for (i = 0; i < o; i++)
+    for (m = solver->colpos[x*o+n-1]; m; m &= m - 1) {
+        i = mask_first(m);
         if (i != y)
-            cube(x,i,n) = false;
+            latin_solver_clear(solver, x, i, n);
+    }
 
     /*
      * Rule out this number in all other positions in the column.
      */
-    for (i = 0; i < o; i++)
+    for (m = solver->rowpos[y*o+n-1]; m; m &= m - 1) {
+        i = mask_first(m);
         if (i != x)
-            cube(i,y,n) = false;
+            latin_solver_clear(solver, i, y, n);
+    }
 
     /*
      * Enter the number in the result grid.
@@ -101,20 +181,27 @@ int latin_solver_elim(struct latin_solver *solver, int start, int step)
 }
 
 struct latin_solver_scratch {
-    unsigned char *grid, *rowidx, *colidx, *set;
+    unsigned char *grid, *rowidx, *colidx;
+    latin_mask *rows, *subrows;
     int *neighbours, *bfsqueue;
 };
 
-int latin_solver_set(struct latin_solver *solver,
-                     struct latin_solver_scratch *scratch,
-                     int start, int step1, int step2)
+/*
+ * Set elimination on an o-by-o matrix of booleans, passed in as one
+ * mask per row (bit j of rows[i] being entry (i,j)). Entry (i,j)
+ * corresponds to position start+i*step1+j*step2 in the cube.
+ */
+static int latin_solver_set_rows(struct latin_solver *solver,
+                                 struct latin_solver_scratch *scratch,
+                                 const latin_mask *rows,
+                                 int start, int step1, int step2)
 {
     int o = solver->o;
     int i, j, n, count;
-    unsigned char *grid = scratch->grid;
     unsigned char *rowidx = scratch->rowidx;
     unsigned char *colidx = scratch->colidx;
-    unsigned char *set = scratch->set;
+    latin_mask *grid = scratch->subrows;
+    latin_mask set, full;
 
     /*
      * We are passed a o-by-o matrix of booleans. Our first job
@@ -125,14 +212,10 @@ int latin_solver_set(struct latin_solver *solver,
     memset(rowidx, true, o);
     memset(colidx, true, o);
     for (i = 0; i < o; i++) {
-        int count = 0, first = -1;
-        for (j = 0; j < o; j++)
-            if (solver->cube[start+i*step1+j*step2])
-                first = j, count++;
-
+        count = mask_count(rows[i]);
         if (count == 0) return -1;
         if (count == 1)
-            rowidx[i] = colidx[first] = false;
+            rowidx[i] = colidx[mask_first(rows[i])] = false;
     }
 
     /*
@@ -149,11 +232,16 @@ int latin_solver_set(struct latin_solver *solver,
     assert(n == j);
 
     /*
-     * And create the smaller matrix.
+     * And create the smaller matrix. Column j of it is stored as bit
+     * n-1-j, so that counting upwards through the candidate sets
+     * below visits them in the order the solver always has.
      */
-    for (i = 0; i < n; i++)
+    for (i = 0; i < n; i++) {
+        grid[i] = 0;
         for (j = 0; j < n; j++)
-            grid[i*o+j] = solver->cube[start+rowidx[i]*step1+colidx[j]*step2];
+            if (rows[rowidx[i]] & ((latin_mask)1 << colidx[j]))
+                grid[i] |= (latin_mask)1 << (n-1-j);
+    }
 
     /*
      * Having done that, we now have a matrix in which every row
@@ -162,31 +250,23 @@ int latin_solver_set(struct latin_solver *solver,
      * `rectangle', i.e. a subset of rows crossed with a subset of
      * columns) whose width and height add up to n.
      */
-
-    memset(set, 0, n);
-    count = 0;
-    while (1) {
+    full = LATIN_FULLMASK(n);
+    for (set = 0; ; set++) {
         /*
          * We have a candidate set. If its size is <=1 or >=n-1
          * then we move on immediately.
          */
+        count = mask_count(set);
         if (count > 1 && count < n-1) {
             /*
              * The number of rows we need is n-count. See if we can
              * find that many rows which each have a zero in all
              * the positions listed in `set'.
              */
-            int rows = 0;
-            for (i = 0; i < n; i++) {
-                bool ok = true;
-                for (j = 0; j < n; j++)
-                    if (set[j] && grid[i*o+j]) {
-                        ok = false;
-                        break;
-                    }
-                if (ok)
-                    rows++;
-            }
+            int rows_ok = 0;
+            for (i = 0; i < n; i++)
+                if (!(grid[i] & set))
+                    rows_ok++;
 
             /*
              * We expect never to be able to get _more_ than
@@ -196,11 +276,11 @@ int latin_solver_set(struct latin_solver *solver,
              * indicates a faulty deduction before this point or
              * even a bogus clue.
              */
-            if (rows > n - count) {
+            if (rows_ok > n - count) {
                 return -1;
             }
 
-            if (rows >= n - count) {
+            if (rows_ok >= n - count) {
                 bool progress = false;
 
                 /*
@@ -215,20 +295,15 @@ int latin_solver_set(struct latin_solver *solver,
                  * positions in the cube to meddle with.
                  */
                 for (i = 0; i < n; i++) {
-                    bool ok = true;
-                    for (j = 0; j < n; j++)
-                        if (set[j] && grid[i*o+j]) {
-                            ok = false;
-                            break;
-                        }
-                    if (!ok) {
-                        for (j = 0; j < n; j++)
-                            if (!set[j] && grid[i*o+j]) {
-                                int fpos = (start+rowidx[i]*step1+
-                                            colidx[j]*step2);
-                                progress = true;
-                                solver->cube[fpos] = false;
-                            }
+                    latin_mask elim;
+                    if (!(grid[i] & set))
+                        continue;
+                    for (elim = grid[i] & ~set; elim; elim &= elim - 1) {
+                        j = n-1 - mask_first(elim);
+                        latin_solver_clear_pos(solver, start +
+                                               rowidx[i]*step1 +
+                                               colidx[j]*step2);
+                        progress = true;
                     }
                 }
 
@@ -238,22 +313,30 @@ int latin_solver_set(struct latin_solver *solver,
             }
         }
 
-        /*
-         * Binary increment: change the rightmost 0 to a 1, and
-         * change all 1s to the right of it to 0s.
-         */
-        i = n;
-        while (i > 0 && set[i-1])
-            set[--i] = 0, count--;
-        if (i > 0)
-            set[--i] = 1, count++;
-        else
+        if (set == full)
             break;                     /* done */
     }
 
     return 0;
 }
 
+int latin_solver_set(struct latin_solver *solver,
+                     struct latin_solver_scratch *scratch,
+                     int start, int step1, int step2)
+{
+    int o = solver->o;
+    int i, j;
+
+    for (i = 0; i < o; i++) {
+        scratch->rows[i] = 0;
+        for (j = 0; j < o; j++)
+            if (solver->cube[start+i*step1+j*step2])
+                scratch->rows[i] |= (latin_mask)1 << j;
+    }
+    return latin_solver_set_rows(solver, scratch, scratch->rows,
+                                 start, step1, step2);
+}
+
 /*
  * Look for forcing chains. A forcing chain is a path of
  * pairwise-exclusive squares (i.e. each pair of adjacent squares
@@ -301,7 +384,8 @@ int latin_solver_forcing(struct latin_solver *solver,
 
     for (y = 0; y < o; y++)
         for (x = 0; x < o; x++) {
-            int count, t, n;
+            latin_mask m = solver->cellmask[y*o+x];
+            int t, n;
 
             /*
              * If this square doesn't have exactly two candidate
@@ -312,17 +396,15 @@ int latin_solver_forcing(struct latin_solver *solver,
              * `the other one' (since we will shortly know there
              * are exactly two).
              */
-            for (count = t = 0, n = 1; n <= o; n++)
-                if (cube(x, y, n))
-                    count++, t += n;
-            if (count != 2)
+            if (mask_count(m) != 2)
                 continue;
+            t = mask_first(m) + mask_first(m & (m - 1)) + 2;
 
             /*
              * Now attempt a bfs for each candidate.
              */
             for (n = 1; n <= o; n++)
-                if (cube(x, y, n)) {
+                if (m & ((latin_mask)1 << (n-1))) {
                     int orign, currn, head, tail;
 
                     /*
@@ -357,7 +439,7 @@ int latin_solver_forcing(struct latin_solver *solver,
                          * Try visiting each of those neighbours.
                          */
                         for (i = 0; i < nneighbours; i++) {
-                            int cc, tt, nn;
+                            latin_mask mt;
 
                             xt = neighbours[i] % o;
                             yt = neighbours[i] / o;
@@ -369,7 +451,8 @@ int latin_solver_forcing(struct latin_solver *solver,
                              */
                             if (number[yt*o+xt] <= o)
                                 continue;
-                            if (!cube(xt, yt, currn))
+                            mt = solver->cellmask[yt*o+xt];
+                            if (!(mt & ((latin_mask)1 << (currn-1))))
                                 continue;
 
                             /*
@@ -384,12 +467,10 @@ int latin_solver_forcing(struct latin_solver *solver,
                              * this square to have exactly two
                              * possible numbers.
                              */
-                            for (cc = tt = 0, nn = 1; nn <= o; nn++)
-                                if (cube(xt, yt, nn))
-                                    cc++, tt += nn;
-                            if (cc == 2) {
+                            if (mask_count(mt) == 2) {
                                 bfsqueue[tail++] = yt*o+xt;
-                                number[yt*o+xt] = tt - currn;
+                                number[yt*o+xt] = mask_first(mt) +
+                                    mask_first(mt & (mt - 1)) + 2 - currn;
                             }
 
                             /*
@@ -401,7 +482,7 @@ int latin_solver_forcing(struct latin_solver *solver,
                              */
                             if (currn == orign &&
                                 (xt == x || yt == y)) {
-                                cube(xt, yt, orign) = false;
+                                latin_solver_clear(solver, xt, yt, orign);
                                 return 1;
                             }
                         }
@@ -414,42 +495,48 @@ int latin_solver_forcing(struct latin_solver *solver,
 
 struct latin_solver_scratch *latin_solver_new_scratch(struct latin_solver *solver)
 {
-    struct latin_solver_scratch *scratch = snew(struct latin_solver_scratch);
+    arena *a = solver->arena;
+    struct latin_solver_scratch *scratch = anew(a, struct latin_solver_scratch);
     int o = solver->o;
-    scratch->grid = snewn(o*o, unsigned char);
-    scratch->rowidx = snewn(o, unsigned char);
-    scratch->colidx = snewn(o, unsigned char);
-    scratch->set = snewn(o, unsigned char);
-    scratch->neighbours = snewn(3*o, int);
-    scratch->bfsqueue = snewn(o*o, int);
+    scratch->grid = anewn(a, o*o, unsigned char);
+    scratch->rowidx = anewn(a, o, unsigned char);
+    scratch->colidx = anewn(a, o, unsigned char);
+    scratch->rows = anewn(a, o, latin_mask);
+    scratch->subrows = anewn(a, o, latin_mask);
+    scratch->neighbours = anewn(a, 3*o, int);
+    scratch->bfsqueue = anewn(a, o*o, int);
     return scratch;
 }
 
-void latin_solver_free_scratch(struct latin_solver_scratch *scratch)
-{
-    sfree(scratch->bfsqueue);
-    sfree(scratch->neighbours);
-    sfree(scratch->set);
-    sfree(scratch->colidx);
-    sfree(scratch->rowidx);
-    sfree(scratch->grid);
-    sfree(scratch);
-}
-
-bool latin_solver_alloc(struct latin_solver *solver, digit *grid, int o)
+/*
+ * Set up a solver whose memory comes from an existing arena. The
+ * recursive solver uses this for its subsolvers, so that a whole
+ * solve uses only the one arena.
+ */
+static bool latin_solver_setup(struct latin_solver *solver, arena *a,
+                               digit *grid, int o)
 {
     int x, y;
 
+    assert(o <= LATIN_MAXORDER);
     solver->o = o;
-    solver->cube = snewn(o*o*o, unsigned char);
+    solver->arena = a;
+    solver->cube = anewn(a, o*o*o, unsigned char);
     solver->grid = grid;                /* write straight back to the input */
     memset(solver->cube, 1, o*o*o);
 
-    solver->row = snewn(o*o, unsigned char);
-    solver->col = snewn(o*o, unsigned char);
+    solver->row = anewn(a, o*o, unsigned char);
+    solver->col = anewn(a, o*o, unsigned char);
     memset(solver->row, 0, o*o);
     memset(solver->col, 0, o*o);
 
+    solver->cellmask = anewn(a, o*o, latin_mask);
+    solver->rowpos = anewn(a, o*o, latin_mask);
+    solver->colpos = anewn(a, o*o, latin_mask);
+    for (x = 0; x < o*o; x++)
+        solver->cellmask[x] = solver->rowpos[x] = solver->colpos[x] =
+            LATIN_FULLMASK(o);
+
     for (x = 0; x < o; x++) {
         for (y = 0; y < o; y++) {
             int n = grid[y*o+x];
@@ -465,16 +552,40 @@ bool latin_solver_alloc(struct latin_solver *solver, digit *grid, int o)
     return true;
 }
 
+bool latin_solver_alloc(struct latin_solver *solver, digit *grid, int o)
+{
+    /* Enough for the solver and its scratch space in one block */
+    return latin_solver_setup(solver, arena_new(2*o*o*o + 32*o*o + 256),
+                              grid, o);
+}
+
 void latin_solver_free(struct latin_solver *solver)
 {
-    sfree(solver->cube);
-    sfree(solver->row);
-    sfree(solver->col);
+    arena_free(solver->arena);
+}
+
+/*
+ * latin_solver_elim on a section of the cube given as a mask, whose
+ * only set bit (if it has just one) stands for digit n at x,y.
+ */
+static int latin_solver_elim_mask(struct latin_solver *solver, latin_mask m,
+                                  int x, int y, int n)
+{
+    if (m == 0)
+        return -1;
+    if (m & (m - 1))
+        return 0;
+    if (!solver->grid[y*solver->o+x]) {
+        latin_solver_place(solver, x, y, n);
+        return +1;
+    }
+    return 0;
 }
 
 int latin_solver_diff_simple(struct latin_solver *solver)
 {
     int x, y, n, ret, o = solver->o;
+    latin_mask m;
 
     /*
      * Row-wise positional elimination.
@@ -482,7 +593,9 @@ int latin_solver_diff_simple(struct latin_solver *solver)
     for (y = 0; y < o; y++)
         for (n = 1; n <= o; n++)
             if (!solver->row[y*o+n-1]) {
-                ret = latin_solver_elim(solver, cubepos(0,y,n), o*o);
+                m = solver->rowpos[y*o+n-1];
+                ret = latin_solver_elim_mask(solver, m,
+                                             m ? mask_first(m) : 0, y, n);
                 if (ret != 0) return ret;
             }
     /*
@@ -491,7 +604,9 @@ int latin_solver_diff_simple(struct latin_solver *solver)
     for (x = 0; x < o; x++)
         for (n = 1; n <= o; n++)
             if (!solver->col[x*o+n-1]) {
-                ret = latin_solver_elim(solver, cubepos(x,0,n), o);
+                m = solver->colpos[x*o+n-1];
+                ret = latin_solver_elim_mask(solver, m,
+                                             x, m ? mask_first(m) : 0, n);
                 if (ret != 0) return ret;
             }
 
@@ -501,7 +616,9 @@ int latin_solver_diff_simple(struct latin_solver *solver)
     for (x = 0; x < o; x++)
         for (y = 0; y < o; y++)
             if (!solver->grid[y*o+x]) {
-                ret = latin_solver_elim(solver, cubepos(x,y,1), 1);
+                m = solver->cellmask[y*o+x];
+                ret = latin_solver_elim_mask(solver, m,
+                                             x, y, m ? mask_first(m) + 1 : 0);
                 if (ret != 0) return ret;
             }
     return 0;
@@ -517,14 +634,19 @@ int latin_solver_diff_set(struct latin_solver *solver,
          * Row-wise set elimination.
          */
         for (y = 0; y < o; y++) {
-            ret = latin_solver_set(solver, scratch, cubepos(0,y,1), o*o, 1);
+            ret = latin_solver_set_rows(solver, scratch,
+                                        solver->cellmask + y*o,
+                                        cubepos(0,y,1), o*o, 1);
             if (ret != 0) return ret;
         }
         /*
          * Column-wise set elimination.
          */
         for (x = 0; x < o; x++) {
-            ret = latin_solver_set(solver, scratch, cubepos(x,0,1), o, 1);
+            for (y = 0; y < o; y++)
+                scratch->rows[y] = solver->cellmask[y*o+x];
+            ret = latin_solver_set_rows(solver, scratch, scratch->rows,
+                                        cubepos(x,0,1), o, 1);
             if (ret != 0) return ret;
         }
     } else {
@@ -533,7 +655,10 @@ int latin_solver_diff_set(struct latin_solver *solver,
          * (much tricker for a human to do!)
          */
         for (n = 1; n <= o; n++) {
-            ret = latin_solver_set(solver, scratch, cubepos(0,0,n), o*o, o);
+            for (x = 0; x < o; x++)
+                scratch->rows[x] = solver->colpos[x*o+n-1];
+            ret = latin_solver_set_rows(solver, scratch, scratch->rows,
+                                        cubepos(0,0,n), o*o, o);
             if (ret != 0) return ret;
         }
     }
@@ -557,7 +682,7 @@ static int latin_solver_recurse
      ctxnew_t ctxnew, ctxfree_t ctxfree)
 {
     int best, bestcount;
-    int o = solver->o, x, y, n;
+    int o = solver->o, x, y;
 
     best = -1;
     bestcount = o+1;
@@ -565,16 +690,11 @@ static int latin_solver_recurse
     for (y = 0; y < o; y++)
         for (x = 0; x < o; x++)
             if (!solver->grid[y*o+x]) {
-                int count;
-
                 /*
                  * An unfilled square. Count the number of
                  * possible digits in it.
                  */
-                count = 0;
-                for (n = 1; n <= o; n++)
-                    if (cube(x,y,n))
-                        count++;
+                int count = mask_count(solver->cellmask[y*o+x]);
 
                 /*
                  * We should have found any impossibilities
@@ -595,6 +715,7 @@ static int latin_solver_recurse
         int i, j;
         digit *list, *ingrid, *outgrid;
         int diff = diff_impossible;    /* no solution found yet */
+        arena_pos start = arena_save(solver->arena);
 
         /*
          * Attempt recursion.
@@ -602,15 +723,17 @@ static int latin_solver_recurse
         y = best / o;
         x = best % o;
 
-        list = snewn(o, digit);
-        ingrid = snewn(o*o, digit);
-        outgrid = snewn(o*o, digit);
+        list = anewn(solver->arena, o, digit);
+        ingrid = anewn(solver->arena, o*o, digit);
+        outgrid = anewn(solver->arena, o*o, digit);
         memcpy(ingrid, solver->grid, o*o);
 
         /* Make a list of the possible digits. */
-        for (j = 0, n = 1; n <= o; n++)
-            if (cube(x,y,n))
-                list[j++] = n;
+        {
+            latin_mask m;
+            for (j = 0, m = solver->cellmask[y*o+x]; m; m &= m - 1)
+                list[j++] = mask_first(m) + 1;
+        }
 
         /*
          * And step along the list, recursing back into the
@@ -620,6 +743,7 @@ static int latin_solver_recurse
             int ret;
             void *newctx;
             struct latin_solver subsolver;
+            arena_pos branch = arena_save(solver->arena);
 
             memcpy(outgrid, ingrid, o*o);
             outgrid[y*o+x] = list[i];
@@ -629,7 +753,7 @@ static int latin_solver_recurse
             } else {
                 newctx = ctx;
             }
-            if (latin_solver_alloc(&subsolver, outgrid, o))
+            if (latin_solver_setup(&subsolver, solver->arena, outgrid, o))
                 ret = latin_solver_top(&subsolver, diff_recursive,
                                        diff_simple, diff_set_0, diff_set_1,
                                        diff_forcing, diff_recursive,
@@ -637,7 +761,7 @@ static int latin_solver_recurse
                                        ctxnew, ctxfree);
             else
                 ret = diff_impossible;
-            latin_solver_free(&subsolver);
+            arena_restore(solver->arena, branch);
             if (ctxnew)
                 ctxfree(newctx);
 
@@ -673,9 +797,7 @@ static int latin_solver_recurse
                 break;
         }
 
-        sfree(outgrid);
-        sfree(ingrid);
-        sfree(list);
+        arena_restore(solver->arena, start);
 
         if (diff == diff_impossible)
             return -1;
@@ -694,6 +816,7 @@ static int latin_solver_top(struct latin_solver *solver, int maxdiff,
                             usersolver_t const *usersolvers, validator_t valid,
                             void *ctx, ctxnew_t ctxnew, ctxfree_t ctxfree)
 {
+    arena_pos start = arena_save(solver->arena);
     struct latin_solver_scratch *scratch = latin_solver_new_scratch(solver);
     int ret, diff = diff_simple;
 
@@ -710,9 +833,12 @@ static int latin_solver_top(struct latin_solver *solver, int maxdiff,
 
         cont:
         for (i = 0; i <= maxdiff; i++) {
-            if (usersolvers[i])
+            if (usersolvers[i]) {
                 ret = usersolvers[i](solver, ctx);
-            else
+                /* Game-specific deductions write the cube directly. */
+                if (ret > 0)
+                    latin_solver_sync(solver);
+            } else
                 ret = 0;
             if (ret == 0 && i == diff_simple)
                 ret = latin_solver_diff_simple(solver);
@@ -778,8 +904,7 @@ static int latin_solver_top(struct latin_solver *solver, int maxdiff,
         diff = diff_impossible;
     }
 
-    latin_solver_free_scratch(scratch);
-
+    arena_restore(solver->arena, start);
     return diff;
 }
 
@@ -791,6 +916,8 @@ int latin_solver_main(struct latin_solver *solver, int maxdiff,
 {
     int diff;
 
+    /* The caller may have edited the cube since latin_solver_alloc. */
+    latin_solver_sync(solver);
     diff = latin_solver_top(solver, maxdiff,
                             diff_simple, diff_set_0, diff_set_1,
                             diff_forcing, diff_recursive,
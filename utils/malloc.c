@@ -2,16 +2,29 @@
  * malloc.c: safe wrappers around malloc, realloc, free, strdup
  */
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include "puzzles.h"
 
+/*
+ * Running count of allocations made through smalloc and srealloc,
+ * for the benefit of dev/puzzlebench. Generators may allocate from
+ * several threads at once, so it is bumped atomically.
+ */
+static unsigned long nallocs = 0;
+
+unsigned long smalloc_count(void) {
+    return __atomic_load_n(&nallocs, __ATOMIC_RELAXED);
+}
+
 /*
  * smalloc should guarantee to return a useful pointer - we
  * can do nothing except die when it's out of memory anyway.
  */
 void *smalloc(size_t size) {
     void *p;
+    __atomic_add_fetch(&nallocs, 1, __ATOMIC_RELAXED);
     p = malloc(size);
     if (!p) fatal("out of memory");
     return p;
@@ -32,6 +45,7 @@ void sfree(void *p) {
  */
 void *srealloc(void *p, size_t size) {
     void *q;
+    __atomic_add_fetch(&nallocs, 1, __ATOMIC_RELAXED);
     if (p) {
         q = realloc(p, size);
     } else {
@@ -50,3 +64,105 @@ char *dupstr(const char *s) {
     strcpy(r,s);
     return r;
 }
+
+/* ----------------------------------------------------------------------
+ * Arena allocator.
+ *
+ * An arena is a chain of blocks. Blocks up to and including `cur'
+ * are in use, the last of them only up to its `used' mark; blocks
+ * after `cur' are spares kept from before an arena_reset or
+ * arena_restore, and are reused before any new block is allocated.
+ */
+
+#define ARENA_BLOCKSIZE 4096
+
+/* Every allocation is rounded up to a multiple of this, so that it's
+ * suitably aligned for anything a solver might put in it. */
+union arena_align {
+    long l;
+    double d;
+    void *p;
+};
+#define ARENA_ALIGN (sizeof(union arena_align))
+
+struct arena_block {
+    struct arena_block *next;
+    size_t size, used;
+    union arena_align data[];
+};
+
+struct arena {
+    struct arena_block *first, *cur;
+    size_t blocksize;
+};
+
+arena *arena_new(size_t blocksize) {
+    arena *a = snew(arena);
+    a->first = a->cur = NULL;
+    a->blocksize = blocksize ? blocksize : ARENA_BLOCKSIZE;
+    return a;
+}
+
+void *arena_alloc(arena *a, size_t size) {
+    struct arena_block *b;
+
+    size = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    if (size == 0)
+        size = ARENA_ALIGN;
+
+    b = a->cur;
+    if (b && b->size - b->used >= size) {
+        void *p = (char *)b->data + b->used;
+        b->used += size;
+        return p;
+    }
+
+    /*
+     * Move on to the next block, reusing a spare one if it's big
+     * enough and otherwise inserting a new one in front of it.
+     */
+    b = a->cur ? a->cur->next : a->first;
+    if (!b || b->size < size) {
+        size_t bsize = size > a->blocksize ? size : a->blocksize;
+        struct arena_block *nb = smalloc(offsetof(struct arena_block, data)
+                                         + bsize);
+        nb->size = bsize;
+        nb->next = b;
+        if (a->cur)
+            a->cur->next = nb;
+        else
+            a->first = nb;
+        b = nb;
+    }
+    a->cur = b;
+    b->used = size;
+    return b->data;
+}
+
+arena_pos arena_save(arena *a) {
+    arena_pos pos;
+    pos.block = a->cur;
+    pos.used = a->cur ? a->cur->used : 0;
+    return pos;
+}
+
+void arena_restore(arena *a, arena_pos pos) {
+    a->cur = pos.block;
+    if (a->cur)
+        a->cur->used = pos.used;
+}
+
+void arena_reset(arena *a) {
+    a->cur = NULL;
+}
+
+void arena_free(arena *a) {
+    if (a) {
+        while (a->first) {
+            struct arena_block *b = a->first;
+            a->first = b->next;
+            sfree(b);
+        }
+        sfree(a);
+    }
+}
@@ -10,6 +10,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include "puzzles.h"
 
@@ -35,6 +36,50 @@ struct midend_serialise_buf_read_ctx {
     int len, pos;
 };
 
+/*
+ * Background generation pool. A worker thread runs new_desc() for a
+ * short queue of seeds, so that midend_new_game() can usually pick
+ * up a ready-made game instead of making the user wait for the
+ * generator.
+ *
+ * Each entry is keyed on the full encoding of the parameters it was
+ * queued for, so entries survive midend_set_params() and are still
+ * there if the user switches back. The seeds themselves are drawn
+ * from me->random on the main thread at queueing time, and each
+ * description is generated from a private random_state seeded with
+ * its seed string, exactly as midend_new_game() would do; so a given
+ * seed still always produces the same game.
+ *
+ * The pool is shared between the midend and the worker thread and
+ * freed by whichever of the two lets go of it last, so that
+ * midend_free() never has to wait for a generation in progress.
+ */
+#define PREGEN_MAX_KEYS 4      /* parameter sets kept in the pool */
+#define MIDEND_UNDO_BUDGET 32  /* full states kept with UNDO_KEYFRAMES */
+
+struct midend_pregen_entry {
+    int id;
+    char *parstr;              /* encode_params(params, true) */
+    game_params *params;
+    char *seed;
+    char *desc, *aux;          /* desc is NULL until generated */
+    bool busy;                 /* worker is generating this one now */
+};
+
+struct midend_pregen {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    const game *ourgame;
+    bool interactive;
+    int depth;
+    int refcount;
+    bool quit;
+    int nextid;
+    int nentries, entriessize;
+    struct midend_pregen_entry *entries;
+};
+
 struct midend {
     frontend *frontend;
     random_state *random;
@@ -72,6 +117,7 @@ struct midend {
 
     int nstates, statesize, statepos;
     struct midend_state_entry *states;
+    int undo_budget;          /* full states to keep; 0 means keep all */
 
     struct midend_serialise_buf newgame_undo, newgame_redo;
     bool newgame_can_store_undo;
@@ -103,6 +149,8 @@ struct midend {
     void *game_id_change_notify_ctx;
 
     bool one_key_shortcuts;
+
+    struct midend_pregen *pregen;
 };
 
 #define ensure(me) do { \
@@ -186,6 +234,8 @@ midend *midend_new(frontend *fe, const game *ourgame,
     me->random = random_new(randseed, randseedsize);
     me->nstates = me->statesize = me->statepos = 0;
     me->states = NULL;
+    me->undo_budget = (ourgame->flags & UNDO_KEYFRAMES) ?
+        MIDEND_UNDO_BUDGET : 0;
     me->newgame_undo.buf = NULL;
     me->newgame_undo.size = me->newgame_undo.len = 0;
     me->newgame_redo.buf = NULL;
@@ -241,6 +291,8 @@ midend *midend_new(frontend *fe, const game *ourgame,
 
     me->one_key_shortcuts = false;
 
+    me->pregen = NULL;
+
     midend_reset_tilesize(me);
 
     sfree(randseed);
@@ -256,18 +308,158 @@ const game *midend_which_game(midend *me)
 static void midend_purge_states(midend *me)
 {
     while (me->nstates > me->statepos) {
-        me->ourgame->free_game(me->states[--me->nstates].state);
+        if (me->states[--me->nstates].state)
+            me->ourgame->free_game(me->states[me->nstates].state);
         if (me->states[me->nstates].movestr)
             sfree(me->states[me->nstates].movestr);
     }
     me->newgame_redo.len = 0;
 }
 
+/*
+ * Keyframed undo chain, for games with the UNDO_KEYFRAMES flag.
+ *
+ * Normally every entry in me->states[] holds a complete game_state.
+ * For games with large states and long sessions that adds up, so
+ * for these the midend only keeps a full state in states[0], in
+ * every `interval'th entry (the keyframes), and in the entries either
+ * side of the current position, which are the ones the rest of the
+ * midend looks at (for animation, flashes and changed_state). Every
+ * other entry has a NULL state and is rebuilt on demand by replaying
+ * the move strings forward from the nearest earlier state, exactly
+ * as deserialisation builds them in the first place.
+ *
+ * The interval is chosen so that no more than about undo_budget full
+ * states are kept, so it grows as the chain gets longer.
+ *
+ * A game loaded from a save file starts out with nothing but states[0]
+ * and the current position and its neighbours, and the keyframes (or
+ * with no budget, all states) are filled in as the rebuilding passes
+ * them.
+ */
+static int midend_keyframe_interval(midend *me)
+{
+    return me->undo_budget ? 1 + me->nstates / me->undo_budget : 0;
+}
+
+static game_state *midend_rebuild_state(midend *me, int i)
+{
+    int j, interval = midend_keyframe_interval(me);
+
+    if (me->states[i].state)
+        return me->states[i].state;
+
+    /* A RESTART entry can be rebuilt from scratch. */
+    for (j = i; !me->states[j].state && me->states[j].movetype != RESTART; j--)
+        assert(j > 0);
+
+    /*
+     * If the game can apply a move to a state in place, the states in
+     * between are never looked at, so we work on a single copy.
+     */
+    if (me->ourgame->execute_move_in_place) {
+        game_state *s = NULL;
+
+        for (; j <= i; j++) {
+            if (me->states[j].state) {
+                /* Only j itself, at the start of the run. */
+                s = me->ourgame->dup_game(me->states[j].state);
+            } else if (me->states[j].movetype == RESTART) {
+                if (s)
+                    me->ourgame->free_game(s);
+                s = me->ourgame->new_game(me, me->params,
+                                          me->states[j].movestr);
+            } else if (!me->ourgame->execute_move_in_place(
+                           s, me->ui, me->states[j].movestr)) {
+                /* The keyframes filled in so far are still good. */
+                me->ourgame->free_game(s);
+                return NULL;
+            }
+            if (j < i && (!interval || j % interval == 0) &&
+                !me->states[j].state)
+                me->states[j].state = me->ourgame->dup_game(s);
+        }
+        me->states[i].state = s;
+        return s;
+    }
+
+    for (; j <= i; j++) {
+        if (me->states[j].state)
+            continue;
+        if (me->states[j].movetype == RESTART) {
+            me->states[j].state = me->ourgame->new_game(
+                me, me->params, me->states[j].movestr);
+        } else {
+            me->states[j].state = me->ourgame->execute_move(
+                me->states[j-1].state, me->ui, me->states[j].movestr);
+        }
+        if (!me->states[j].state)
+            return NULL;
+    }
+
+    return me->states[i].state;
+}
+
+static void midend_trim_states(midend *me)
+{
+    int i, base, badbase, interval;
+    bool ok = true;
+
+    /*
+     * Bring in the current position and its neighbours. Should a move
+     * fail to replay, the positions beyond it can't be reached any
+     * more: a broken redo chain is thrown away, and midend_undo()
+     * refuses to step back into a missing state.
+     */
+    if (me->statepos >= 2 && !midend_rebuild_state(me, me->statepos - 2))
+        ok = false;
+    if (me->statepos < me->nstates &&
+        !midend_rebuild_state(me, me->statepos)) {
+        midend_purge_states(me);
+        ok = false;
+    }
+    if (!ok)
+        return;
+
+    /*
+     * Drop everything that isn't one of those or a keyframe, but only
+     * once the keyframe it would be rebuilt from is there, so that
+     * nothing is thrown away that can't be got back.
+     */
+    interval = midend_keyframe_interval(me);
+    if (!interval)
+        return;
+    badbase = -1;
+    for (i = 1; i < me->nstates; i++) {
+        if (!me->states[i].state || i % interval == 0 ||
+            (i >= me->statepos - 2 && i <= me->statepos))
+            continue;
+        base = i - i % interval;
+        if (base == badbase)
+            continue;
+        if (!midend_rebuild_state(me, base)) {
+            badbase = base;
+            continue;
+        }
+        me->ourgame->free_game(me->states[i].state);
+        me->states[i].state = NULL;
+    }
+}
+
+void midend_set_undo_budget(midend *me, int nstates)
+{
+    if (!(me->ourgame->flags & UNDO_KEYFRAMES))
+        return;
+    me->undo_budget = nstates > 0 ? nstates : 0;
+    midend_trim_states(me);
+}
+
 static void midend_free_game(midend *me)
 {
     while (me->nstates > 0) {
         me->nstates--;
-        me->ourgame->free_game(me->states[me->nstates].state);
+        if (me->states[me->nstates].state)
+            me->ourgame->free_game(me->states[me->nstates].state);
         if (me->states[me->nstates].movestr)
             sfree(me->states[me->nstates].movestr);
     }
@@ -291,10 +483,15 @@ static void midend_free_preset_menu(midend *me, struct preset_menu *menu)
     }
 }
 
+static void pregen_release(struct midend_pregen *pg);
+
 void midend_free(midend *me)
 {
     int i;
 
+    if (me->pregen)
+        pregen_release(me->pregen);
+
     midend_free_game(me);
 
     for (i = 0; i < me->n_encoded_presets; i++)
@@ -520,6 +717,252 @@ static bool midend_serialise_buf_read(void *ctx, void *buf, int len)
     return true;
 }
 
+/*
+ * Generate a new random seed. 15 digits comes to about 48 bits,
+ * which should be more than enough.
+ *
+ * I'll avoid putting a leading zero on the number, just in case it
+ * confuses anybody who thinks it's processed as an integer rather
+ * than a string.
+ */
+static char *midend_make_seed(midend *me)
+{
+    char newseed[16];
+    int i;
+    newseed[15] = '\0';
+    newseed[0] = '1' + (char)random_upto(me->random, 9);
+    for (i = 1; i < 15; i++)
+        newseed[i] = '0' + (char)random_upto(me->random, 10);
+    return dupstr(newseed);
+}
+
+static void pregen_free_entry(struct midend_pregen *pg,
+                              struct midend_pregen_entry *e)
+{
+    sfree(e->parstr);
+    pg->ourgame->free_params(e->params);
+    sfree(e->seed);
+    sfree(e->desc);
+    sfree(e->aux);
+}
+
+static void pregen_remove_entry(struct midend_pregen *pg, int i)
+{
+    pregen_free_entry(pg, &pg->entries[i]);
+    memmove(pg->entries + i, pg->entries + i + 1,
+            (pg->nentries - i - 1) * sizeof(*pg->entries));
+    pg->nentries--;
+}
+
+/* Must be called with the lock held. Frees the pool if it was the
+ * last reference, in which case the lock is gone afterwards. */
+static bool pregen_unref_locked(struct midend_pregen *pg)
+{
+    if (--pg->refcount > 0)
+        return false;
+
+    pthread_mutex_unlock(&pg->lock);
+    while (pg->nentries > 0)
+        pregen_remove_entry(pg, pg->nentries - 1);
+    sfree(pg->entries);
+    pthread_cond_destroy(&pg->cond);
+    pthread_mutex_destroy(&pg->lock);
+    sfree(pg);
+    return true;
+}
+
+static void *pregen_thread(void *vctx)
+{
+    struct midend_pregen *pg = (struct midend_pregen *)vctx;
+
+    pthread_mutex_lock(&pg->lock);
+    while (!pg->quit) {
+        struct midend_pregen_entry *e = NULL;
+        game_params *params;
+        random_state *rs;
+        char *seed, *desc, *aux = NULL;
+        int i, id;
+
+        for (i = 0; i < pg->nentries; i++)
+            if (!pg->entries[i].desc) {
+                e = &pg->entries[i];
+                break;
+            }
+        if (!e) {
+            pthread_cond_wait(&pg->cond, &pg->lock);
+            continue;
+        }
+
+        /*
+         * Take private copies of everything new_desc needs, so that
+         * the entries array can be rearranged while we work.
+         */
+        e->busy = true;
+        id = e->id;
+        params = pg->ourgame->dup_params(e->params);
+        seed = dupstr(e->seed);
+        pthread_mutex_unlock(&pg->lock);
+
+        rs = random_new(seed, strlen(seed));
+        desc = pg->ourgame->new_desc(params, rs, &aux, pg->interactive);
+        random_free(rs);
+        pg->ourgame->free_params(params);
+        sfree(seed);
+
+        pthread_mutex_lock(&pg->lock);
+        for (i = 0; i < pg->nentries; i++)
+            if (pg->entries[i].id == id)
+                break;
+        assert(i < pg->nentries);      /* busy entries are never removed */
+        pg->entries[i].desc = desc;
+        pg->entries[i].aux = aux;
+        pg->entries[i].busy = false;
+    }
+    if (!pregen_unref_locked(pg))
+        pthread_mutex_unlock(&pg->lock);
+
+    return NULL;
+}
+
+static void pregen_release(struct midend_pregen *pg)
+{
+    pthread_mutex_lock(&pg->lock);
+    pg->quit = true;
+    pthread_cond_signal(&pg->cond);
+    if (!pregen_unref_locked(pg))
+        pthread_mutex_unlock(&pg->lock);
+}
+
+/*
+ * Top up the queue for the current parameters to the configured
+ * depth, and throw out stale entries for other parameter sets if the
+ * pool has grown too large.
+ */
+static void pregen_fill(midend *me, const char *parstr)
+{
+    struct midend_pregen *pg = me->pregen;
+    int i, have = 0;
+    bool added = false;
+
+    pthread_mutex_lock(&pg->lock);
+    for (i = 0; i < pg->nentries; i++)
+        if (!strcmp(pg->entries[i].parstr, parstr))
+            have++;
+
+    for (; have < pg->depth; have++) {
+        struct midend_pregen_entry *e;
+
+        if (pg->nentries >= pg->entriessize) {
+            pg->entriessize = pg->nentries + 8;
+            pg->entries = sresize(pg->entries, pg->entriessize,
+                                  struct midend_pregen_entry);
+        }
+        e = &pg->entries[pg->nentries++];
+        e->id = pg->nextid++;
+        e->parstr = dupstr(parstr);
+        e->params = me->ourgame->dup_params(me->params);
+        e->seed = midend_make_seed(me);
+        e->desc = e->aux = NULL;
+        e->busy = false;
+        added = true;
+    }
+
+    /* Entries are in queueing order, so the oldest go first. */
+    i = 0;
+    while (pg->nentries > pg->depth * PREGEN_MAX_KEYS && i < pg->nentries) {
+        if (!pg->entries[i].busy && strcmp(pg->entries[i].parstr, parstr))
+            pregen_remove_entry(pg, i);
+        else
+            i++;
+    }
+
+    if (added)
+        pthread_cond_signal(&pg->cond);
+    pthread_mutex_unlock(&pg->lock);
+}
+
+/*
+ * Pop a finished game for the given parameters out of the pool, if
+ * there is one. Ownership of the strings passes to the caller.
+ */
+static bool pregen_take(midend *me, const char *parstr,
+                        char **seed, char **desc, char **aux)
+{
+    struct midend_pregen *pg = me->pregen;
+    bool found = false;
+    int i;
+
+    pthread_mutex_lock(&pg->lock);
+    for (i = 0; i < pg->nentries; i++) {
+        struct midend_pregen_entry *e = &pg->entries[i];
+        if (e->desc && !strcmp(e->parstr, parstr)) {
+            *seed = e->seed;
+            *desc = e->desc;
+            *aux = e->aux;
+            e->seed = e->desc = e->aux = NULL;
+            pregen_remove_entry(pg, i);
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pg->lock);
+
+    return found;
+}
+
+void midend_enable_pregeneration(midend *me, int depth)
+{
+    struct midend_pregen *pg;
+
+    if (me->pregen || depth <= 0)
+        return;
+
+    pg = snew(struct midend_pregen);
+    pthread_mutex_init(&pg->lock, NULL);
+    pthread_cond_init(&pg->cond, NULL);
+    pg->ourgame = me->ourgame;
+    pg->interactive = (me->drawing != NULL);
+    pg->depth = depth;
+    pg->refcount = 2;                  /* midend and worker thread */
+    pg->quit = false;
+    pg->nextid = 0;
+    pg->nentries = pg->entriessize = 0;
+    pg->entries = NULL;
+
+    if (pthread_create(&pg->thread, NULL, pregen_thread, pg)) {
+        /* No thread, no pool; we just generate synchronously. */
+        pthread_cond_destroy(&pg->cond);
+        pthread_mutex_destroy(&pg->lock);
+        sfree(pg);
+        return;
+    }
+    pthread_detach(pg->thread);
+    me->pregen = pg;
+}
+
+bool midend_pregenerated_available(midend *me)
+{
+    bool found = false;
+    char *parstr;
+    int i;
+
+    if (!me->pregen || me->genmode != GOT_NOTHING)
+        return false;
+
+    parstr = encode_params(me, me->params, true);
+    pthread_mutex_lock(&me->pregen->lock);
+    for (i = 0; i < me->pregen->nentries; i++)
+        if (me->pregen->entries[i].desc &&
+            !strcmp(me->pregen->entries[i].parstr, parstr)) {
+            found = true;
+            break;
+        }
+    pthread_mutex_unlock(&me->pregen->lock);
+    sfree(parstr);
+
+    return found;
+}
+
 void midend_new_game(midend *me)
 {
     me->newgame_undo.len = 0;
@@ -551,30 +994,35 @@ void midend_new_game(midend *me)
         me->genmode = GOT_NOTHING;
     } else {
         random_state *rs;
+        char *parstr = NULL;
+        char *seed, *desc, *aux;
 
         if (me->genmode == GOT_SEED) {
             me->genmode = GOT_NOTHING;
         } else {
-            /*
-             * Generate a new random seed. 15 digits comes to about
-             * 48 bits, which should be more than enough.
-             * 
-             * I'll avoid putting a leading zero on the number,
-             * just in case it confuses anybody who thinks it's
-             * processed as an integer rather than a string.
-             */
-            char newseed[16];
-            int i;
-            newseed[15] = '\0';
-            newseed[0] = '1' + (char)random_upto(me->random, 9);
-            for (i = 1; i < 15; i++)
-                newseed[i] = '0' + (char)random_upto(me->random, 10);
-            sfree(me->seedstr);
-            me->seedstr = dupstr(newseed);
+            if (me->curparams)
+                me->ourgame->free_params(me->curparams);
+            me->curparams = me->ourgame->dup_params(me->params);
+
+            if (me->pregen) {
+                parstr = encode_params(me, me->params, true);
+                if (pregen_take(me, parstr, &seed, &desc, &aux)) {
+                    sfree(me->seedstr);
+                    me->seedstr = seed;
+                    sfree(me->desc);
+                    sfree(me->privdesc);
+                    sfree(me->aux_info);
+                    me->desc = desc;
+                    me->privdesc = NULL;
+                    me->aux_info = aux;
+                    pregen_fill(me, parstr);
+                    sfree(parstr);
+                    goto generated;
+                }
+            }
 
-        if (me->curparams)
-            me->ourgame->free_params(me->curparams);
-        me->curparams = me->ourgame->dup_params(me->params);
+            sfree(me->seedstr);
+            me->seedstr = midend_make_seed(me);
         }
 
         sfree(me->desc);
@@ -582,6 +1030,15 @@ void midend_new_game(midend *me)
         sfree(me->aux_info);
         me->aux_info = NULL;
 
+        /*
+         * Queue up the next game for the worker before generating
+         * this one, so that the two run side by side.
+         */
+        if (parstr) {
+            pregen_fill(me, parstr);
+            sfree(parstr);
+        }
+
         rs = random_new(me->seedstr, strlen(me->seedstr));
         /*
          * If this midend has been instantiated without providing a
@@ -595,6 +1052,8 @@ void midend_new_game(midend *me)
         random_free(rs);
     }
 
+    generated:
+
     ensure(me);
 
     /*
@@ -674,7 +1133,9 @@ void midend_save_prefs(midend *me,
 
 bool midend_can_undo(midend *me)
 {
-    return (me->statepos > 1 || me->newgame_undo.len);
+    if (me->statepos > 1)
+        return me->states[me->statepos-2].state != NULL;
+    return me->newgame_undo.len;
 }
 
 bool midend_can_redo(midend *me)
@@ -741,12 +1202,15 @@ static const char *newgame_undo_deserialise_check(
 static bool midend_undo(midend *me)
 {
     if (me->statepos > 1) {
+        if (!me->states[me->statepos-2].state)
+            return false;              /* see midend_trim_states() */
         if (me->ui)
             me->ourgame->changed_state(me->ui,
                                        me->states[me->statepos-1].state,
                                        me->states[me->statepos-2].state);
         me->statepos--;
         me->dir = -1;
+        midend_trim_states(me);
         return true;
     } else if (me->newgame_undo.len) {
         struct midend_serialise_buf_read_ctx rctx;
@@ -816,6 +1280,7 @@ static bool midend_redo(midend *me)
                                        me->states[me->statepos].state);
         me->statepos++;
         me->dir = +1;
+        midend_trim_states(me);
         return true;
     } else if (me->newgame_redo.len) {
         struct midend_serialise_buf_read_ctx rctx;
@@ -948,6 +1413,7 @@ void midend_restart_game(midend *me)
         me->ourgame->changed_state(me->ui,
                                    me->states[me->statepos-2].state,
                                    me->states[me->statepos-1].state);
+    midend_trim_states(me);
     me->flash_pos = me->flash_time = 0.0F;
     midend_finish_move(me);
     midend_redraw(me);
@@ -1043,6 +1509,7 @@ static int midend_really_process_key(midend *me, int x, int y, int button, bool
                 me->ourgame->changed_state(me->ui,
                        me->states[me->statepos-2].state,
                        me->states[me->statepos-1].state);
+            midend_trim_states(me);
         } else {
             goto done;
         }
@@ -2048,6 +2515,7 @@ const char *midend_solve(midend *me)
         me->ourgame->changed_state(me->ui,
                                    me->states[me->statepos-2].state,
                                    me->states[me->statepos-1].state);
+    midend_trim_states(me);
     me->dir = +1;
     if (me->ourgame->flags & SOLVE_ANIMATES) {
     me->oldstate = me->ourgame->dup_game(me->states[me->statepos-2].state);
@@ -2066,6 +2534,60 @@ const char *midend_solve(midend *me)
     return NULL;
 }
 
+const char *midend_hint(midend *me)
+{
+    game_state *s;
+    const char *msg;
+    char *movestr;
+
+    if (!me->ourgame->hint)
+        return "This game does not support hints";
+
+    if (me->statepos < 1 || !me->ui)
+        return "No game set up to hint";
+
+    msg = NULL;
+    movestr = me->ourgame->hint(me->states[me->statepos-1].state,
+                                me->ui, &msg);
+    if (!movestr) {
+        if (!msg)
+            msg = "No hint available";
+        return msg;
+    }
+    s = me->ourgame->execute_move(me->states[me->statepos-1].state, me->ui, movestr);
+    assert(s);
+
+    /*
+     * A hint is an ordinary move as far as the undo chain is
+     * concerned, so it is entered and animated exactly like one.
+     */
+    midend_stop_anim(me);
+    midend_purge_states(me);
+    ensure(me);
+    me->states[me->nstates].state = s;
+    me->states[me->nstates].movestr = movestr;
+    me->states[me->nstates].movetype = MOVE;
+    me->statepos = ++me->nstates;
+    me->ourgame->changed_state(me->ui,
+                               me->states[me->statepos-2].state,
+                               me->states[me->statepos-1].state);
+    midend_trim_states(me);
+    me->dir = +1;
+    me->oldstate = me->ourgame->dup_game(me->states[me->statepos-2].state);
+    me->anim_time = me->ourgame->anim_length(me->states[me->statepos-2].state,
+                                             me->states[me->statepos-1].state,
+                                             +1, me->ui);
+    me->anim_pos = 0.0;
+    if (me->anim_time <= 0) {
+        me->anim_time = 0.0;
+        midend_finish_move(me);
+    }
+    if (me->drawing)
+        midend_redraw(me);
+    midend_set_timer(me);
+    return NULL;
+}
+
 int midend_status(midend *me)
 {
     /*
@@ -2305,7 +2827,8 @@ static const char *midend_deserialise_internal(
 {
     struct deserialise_data data;
     int gotstates = 0;
-    bool started = false;
+    bool started = false, lazy, owned;
+    game_state *s;
     int i;
 
     char *val = NULL;
@@ -2548,14 +3071,42 @@ static const char *midend_deserialise_internal(
     data.states[0].state = me->ourgame->new_game(
         me, data.cparams, data.privdesc ? data.privdesc : data.desc);
 
+    /*
+     * Replay the moves. With a keyframed undo chain, only the
+     * positions midend_trim_states() would bring in anyway are kept,
+     * and the rest are left to midend_rebuild_state() for when the
+     * user undoes back to them. Every move is still replayed, so that
+     * a bad move anywhere in the file is rejected here.
+     */
+    lazy = (me->ourgame->flags & UNDO_KEYFRAMES) && me->undo_budget;
+    s = data.states[0].state;
+    owned = false;                     /* s is in data.states[] */
     for (i = 1; i < data.nstates; i++) {
+        game_state *next;
+
         assert(data.states[i].movetype != NEWGAME);
         switch (data.states[i].movetype) {
             case MOVE:
             case SOLVE:
-                data.states[i].state = me->ourgame->execute_move(
-                    data.states[i-1].state, me->ui, data.states[i].movestr);
-                if (data.states[i].state == NULL) {
+                if (lazy && me->ourgame->execute_move_in_place) {
+                    if (!owned)
+                        s = me->ourgame->dup_game(s);
+                    owned = true;
+                    if (!me->ourgame->execute_move_in_place(
+                            s, me->ui, data.states[i].movestr)) {
+                        me->ourgame->free_game(s);
+                        ret = "Save file contained an invalid move";
+                        goto cleanup;
+                    }
+                    break;
+                }
+                next = me->ourgame->execute_move(
+                    s, me->ui, data.states[i].movestr);
+                if (owned)
+                    me->ourgame->free_game(s);
+                s = next;
+                owned = true;
+                if (s == NULL) {
                     ret = "Save file contained an invalid move";
                     goto cleanup;
                 }
@@ -2563,14 +3114,26 @@ static const char *midend_deserialise_internal(
             case RESTART:
                 if (me->ourgame->validate_desc(
                     data.cparams, data.states[i].movestr)) {
+                    if (owned)
+                        me->ourgame->free_game(s);
                     ret = "Save file contained an invalid restart move";
                     goto cleanup;
                 }
-                data.states[i].state = me->ourgame->new_game(
+                next = me->ourgame->new_game(
                     me, data.cparams, data.states[i].movestr);
+                if (owned)
+                    me->ourgame->free_game(s);
+                s = next;
+                owned = true;
                 break;
         }
+        if (!lazy || (i >= data.statepos - 2 && i <= data.statepos)) {
+            data.states[i].state = s;
+            owned = false;
+        }
     }
+    if (owned)
+        me->ourgame->free_game(s);
 
     data.ui = me->ourgame->new_ui(data.states[0].state);
     midend_apply_prefs(me, data.ui);
@@ -2624,6 +3187,7 @@ static const char *midend_deserialise_internal(
         data.states = tmp;
     }
     me->statepos = data.statepos;
+    midend_trim_states(me);
 
     /*
      * Don't save the "new game undo/redo" state.  So "new game" twice or
@@ -4,6 +4,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -355,6 +356,67 @@ int compare_integers(const void *av, const void *bv) {
         return 0;
 }
 
+/*
+ * Move string parsing. Move strings are replayed in bulk when a game
+ * is loaded or an undo chain is rebuilt, and a solve move can run to
+ * one item per square, so these avoid the overhead of sscanf().
+ */
+bool move_read_int(const char **p, int *n)
+{
+    const char *q = *p;
+    bool neg = false;
+    int v = 0;
+
+    if (*q == '-') {
+        neg = true;
+        q++;
+    }
+    if (!isdigit((unsigned char)*q))
+        return false;
+    while (isdigit((unsigned char)*q)) {
+        int d = *q++ - '0';
+        if (v > (INT_MAX - d) / 10)
+            return false;              /* out of range */
+        v = v * 10 + d;
+    }
+
+    *n = neg ? -v : v;
+    *p = q;
+    return true;
+}
+
+int move_read_ints(const char **p, int *out, int max)
+{
+    int i;
+
+    for (i = 0; i < max; i++) {
+        const char *q = *p;
+        if (i > 0 && *q++ != ',')
+            break;
+        if (!move_read_int(&q, &out[i]))
+            break;
+        *p = q;
+    }
+    return i;
+}
+
+int move_next_item(const char **p, move_item *item)
+{
+    const char *q = *p;
+
+    if (!*q)
+        return 0;
+    item->c = *q++;
+    item->nargs = move_read_ints(&q, item->args, MOVE_ITEM_MAXARGS);
+    if (*q == ';')
+        q++;
+    else if (*q)
+        return -1;
+
+    *p = q;
+    return 1;
+}
+
 char *move_cursor(int button, int *x, int *y, int maxw, int maxh, bool wrap,
     bool *visible)
 {
@@ -31,19 +31,35 @@ static void SHA_Core_Init(uint32 h[5])
     h[4] = 0xc3d2e1f0;
 }
 
+/*
+ * The 80 rounds are written out in full, with the message schedule
+ * kept as a rolling window of 16 words, and the five working
+ * variables rotated by renaming rather than by moving them about.
+ */
+#define SHA_W(t) ( w[(t)&15] = rol(w[((t)+13)&15] ^ w[((t)+8)&15] ^ \
+                                   w[((t)+2)&15] ^ w[(t)&15], 1) )
+#define SHA_F0(b,c,d) ( (((c) ^ (d)) & (b)) ^ (d) )
+#define SHA_F1(b,c,d) ( (b) ^ (c) ^ (d) )
+#define SHA_F2(b,c,d) ( ((b) & (c)) | (((b) | (c)) & (d)) )
+#define SHA_ROUND(a,b,c,d,e,f,k,x) do { \
+        e += rol(a, 5) + f(b, c, d) + (x) + (k); \
+        b = rol(b, 30); \
+    } while (0)
+#define SHA_FIVE(f,k,x,t) do { \
+        SHA_ROUND(a, b, c, d, e, f, k, x(t)); \
+        SHA_ROUND(e, a, b, c, d, f, k, x((t)+1)); \
+        SHA_ROUND(d, e, a, b, c, f, k, x((t)+2)); \
+        SHA_ROUND(c, d, e, a, b, f, k, x((t)+3)); \
+        SHA_ROUND(b, c, d, e, a, f, k, x((t)+4)); \
+    } while (0)
+#define SHA_W0(t) ( w[t] )
+
 static void SHATransform(uint32 * digest, uint32 * block)
 {
-    uint32 w[80];
+    uint32 w[16];
     uint32 a, b, c, d, e;
-    int t;
 
-    for (t = 0; t < 16; t++)
-        w[t] = block[t];
-
-    for (t = 16; t < 80; t++) {
-        uint32 tmp = w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16];
-        w[t] = rol(tmp, 1);
-    }
+    memcpy(w, block, sizeof(w));
 
     a = digest[0];
     b = digest[1];
@@ -51,41 +67,29 @@ static void SHATransform(uint32 * digest, uint32 * block)
     d = digest[3];
     e = digest[4];
 
-    for (t = 0; t < 20; t++) {
-        uint32 tmp =
-            rol(a, 5) + ((b & c) | (d & ~b)) + e + w[t] + 0x5a827999;
-        e = d;
-        d = c;
-        c = rol(b, 30);
-        b = a;
-        a = tmp;
-    }
-    for (t = 20; t < 40; t++) {
-        uint32 tmp = rol(a, 5) + (b ^ c ^ d) + e + w[t] + 0x6ed9eba1;
-        e = d;
-        d = c;
-        c = rol(b, 30);
-        b = a;
-        a = tmp;
-    }
-    for (t = 40; t < 60; t++) {
-        uint32 tmp = rol(a,
-                         5) + ((b & c) | (b & d) | (c & d)) + e + w[t] +
-            0x8f1bbcdc;
-        e = d;
-        d = c;
-        c = rol(b, 30);
-        b = a;
-        a = tmp;
-    }
-    for (t = 60; t < 80; t++) {
-        uint32 tmp = rol(a, 5) + (b ^ c ^ d) + e + w[t] + 0xca62c1d6;
-        e = d;
-        d = c;
-        c = rol(b, 30);
-        b = a;
-        a = tmp;
-    }
+    SHA_FIVE(SHA_F0, 0x5a827999, SHA_W0, 0);
+    SHA_FIVE(SHA_F0, 0x5a827999, SHA_W0, 5);
+    SHA_FIVE(SHA_F0, 0x5a827999, SHA_W0, 10);
+    SHA_ROUND(a, b, c, d, e, SHA_F0, 0x5a827999, w[15]);
+    SHA_ROUND(e, a, b, c, d, SHA_F0, 0x5a827999, SHA_W(16));
+    SHA_ROUND(d, e, a, b, c, SHA_F0, 0x5a827999, SHA_W(17));
+    SHA_ROUND(c, d, e, a, b, SHA_F0, 0x5a827999, SHA_W(18));
+    SHA_ROUND(b, c, d, e, a, SHA_F0, 0x5a827999, SHA_W(19));
+
+    SHA_FIVE(SHA_F1, 0x6ed9eba1, SHA_W, 20);
+    SHA_FIVE(SHA_F1, 0x6ed9eba1, SHA_W, 25);
+    SHA_FIVE(SHA_F1, 0x6ed9eba1, SHA_W, 30);
+    SHA_FIVE(SHA_F1, 0x6ed9eba1, SHA_W, 35);
+
+    SHA_FIVE(SHA_F2, 0x8f1bbcdc, SHA_W, 40);
+    SHA_FIVE(SHA_F2, 0x8f1bbcdc, SHA_W, 45);
+    SHA_FIVE(SHA_F2, 0x8f1bbcdc, SHA_W, 50);
+    SHA_FIVE(SHA_F2, 0x8f1bbcdc, SHA_W, 55);
+
+    SHA_FIVE(SHA_F1, 0xca62c1d6, SHA_W, 60);
+    SHA_FIVE(SHA_F1, 0xca62c1d6, SHA_W, 65);
+    SHA_FIVE(SHA_F1, 0xca62c1d6, SHA_W, 70);
+    SHA_FIVE(SHA_F1, 0xca62c1d6, SHA_W, 75);
 
     digest[0] += a;
     digest[1] += b;
@@ -207,6 +211,47 @@ struct random_state {
     int pos;
 };
 
+/*
+ * databuf = SHA_Simple(seedbuf, 40). Forty bytes always pad out to
+ * exactly one block, so this builds that block directly and skips
+ * the general byte-string machinery.
+ */
+static void random_hash_seedbuf(random_state *state)
+{
+    uint32 block[16], h[5];
+    const unsigned char *p = state->seedbuf;
+    unsigned char *q = state->databuf;
+    int i;
+
+    for (i = 0; i < 10; i++, p += 4)
+        block[i] = ((uint32)p[0] << 24) | ((uint32)p[1] << 16) |
+                   ((uint32)p[2] << 8) | (uint32)p[3];
+    block[10] = 0x80000000;
+    for (i = 11; i < 15; i++)
+        block[i] = 0;
+    block[15] = 40 * 8;
+
+    SHA_Core_Init(h);
+    SHATransform(h, block);
+
+    for (i = 0; i < 5; i++, q += 4) {
+        q[0] = (unsigned char)(h[i] >> 24);
+        q[1] = (unsigned char)(h[i] >> 16);
+        q[2] = (unsigned char)(h[i] >> 8);
+        q[3] = (unsigned char)h[i];
+    }
+}
+
+/* Step the counter in the first half of seedbuf and rehash. */
+static void random_refill(random_state *state)
+{
+    int i;
+
+    for (i = 0; i < 20 && ++state->seedbuf[i] == 0; i++);
+    random_hash_seedbuf(state);
+    state->pos = 0;
+}
+
 random_state *random_new(const char *seed, int len)
 {
     random_state *state;
@@ -215,7 +260,7 @@ random_state *random_new(const char *seed, int len)
 
     SHA_Simple(seed, len, state->seedbuf);
     SHA_Simple(state->seedbuf, 20, state->seedbuf + 20);
-    SHA_Simple(state->seedbuf, 40, state->databuf);
+    random_hash_seedbuf(state);
     state->pos = 0;
 
     return state;
@@ -234,23 +279,25 @@ random_state *random_copy(random_state *tocopy)
 unsigned long random_bits(random_state *state, int bits)
 {
     unsigned long ret = 0;
-    int n;
-
-    for (n = 0; n < bits; n += 8) {
-        if (state->pos >= 20) {
-            int i;
-
-            for (i = 0; i < 20; i++) {
-                if (state->seedbuf[i] != 0xFF) {
-                    state->seedbuf[i]++;
-                    break;
-                } else
-                    state->seedbuf[i] = 0;
-            }
-            SHA_Simple(state->seedbuf, 40, state->databuf);
-            state->pos = 0;
+    int nbytes = (bits + 7) / 8;
+
+    /*
+     * The output is the next nbytes bytes of the stream, big-endian.
+     * Usually they are all in databuf already, and can be read off
+     * without checking for a refill at every byte.
+     */
+    if (state->pos + nbytes > 20) {
+        while (nbytes > 0) {
+            if (state->pos >= 20)
+                random_refill(state);
+            ret = (ret << 8) | state->databuf[state->pos++];
+            nbytes--;
         }
-        ret = (ret << 8) | state->databuf[state->pos++];
+    } else {
+        const unsigned char *p = state->databuf + state->pos;
+        state->pos += nbytes;
+        while (nbytes-- > 0)
+            ret = (ret << 8) | *p++;
     }
 
     /*
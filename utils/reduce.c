@@ -0,0 +1,221 @@
+/*
+ * reduce.c: the clue-removal loop shared by puzzle generators.
+ *
+ * A generator that starts from a fully clued puzzle typically goes
+ * through the clues in a random order, removing each one whose
+ * absence still leaves the puzzle uniquely solvable. This runs that
+ * loop on the caller's behalf, given a function that checks a clue
+ * set for uniqueness, and can speed it up in two ways without
+ * changing which clues end up removed:
+ *
+ *  - With REDUCE_MONOTONE, the caller promises that putting clues
+ *    back never turns a uniquely solvable set into one that isn't.
+ *    Then a whole run of clues can be removed with a single check,
+ *    and only when that fails does the run get split in half to find
+ *    the clues that have to stay. Early on, when almost every
+ *    removal succeeds, this saves most of the checks.
+ *
+ *  - With more than one thread, the next few candidates are checked
+ *    at once, each on the assumption that all the ones before it in
+ *    the batch will fail. Results are then taken in order up to and
+ *    including the first success, and the rest are thrown away,
+ *    since they were made against a clue set that no longer holds.
+ *    Late on, when most removals fail, this gets through the list
+ *    several clues at a time.
+ *
+ * The two are not combined: with REDUCE_MONOTONE the thread count is
+ * ignored.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "puzzles.h"
+
+struct reducer {
+    reduce_check_fn check;
+    void *ctx;
+    bool *present;
+    int nclues;
+};
+
+/* ----------------------------------------------------------------------
+ * Batch removal, for monotone checks.
+ */
+
+static void reduce_split(struct reducer *r, const int *list, int n);
+
+/*
+ * Try removing all of list[] at once. If that fails, work out which
+ * of them can go after all.
+ */
+static void reduce_try(struct reducer *r, const int *list, int n)
+{
+    int i;
+
+    if (n == 0)
+        return;
+    for (i = 0; i < n; i++)
+        r->present[list[i]] = false;
+    if (r->check(r->ctx, r->present))
+        return;
+    for (i = 0; i < n; i++)
+        r->present[list[i]] = true;
+    reduce_split(r, list, n);
+}
+
+/*
+ * Removing all of list[] is known to fail. A single clue must then
+ * stay. Otherwise try the first half: if it can go, the second half
+ * must still fail as a whole, and if it can't, the second half is an
+ * open question.
+ */
+static void reduce_split(struct reducer *r, const int *list, int n)
+{
+    int i, h = n / 2;
+
+    if (n <= 1)
+        return;
+    for (i = 0; i < h; i++)
+        r->present[list[i]] = false;
+    if (r->check(r->ctx, r->present)) {
+        reduce_split(r, list + h, n - h);
+    } else {
+        for (i = 0; i < h; i++)
+            r->present[list[i]] = true;
+        reduce_split(r, list, h);
+        reduce_try(r, list + h, n - h);
+    }
+}
+
+static void reduce_batched(struct reducer *r, const int *cands, int ncands)
+{
+    int pos = 0, batch = 1;
+
+    while (pos < ncands) {
+        int n = min(batch, ncands - pos);
+        int i;
+
+        for (i = 0; i < n; i++)
+            r->present[cands[pos+i]] = false;
+        if (r->check(r->ctx, r->present)) {
+            batch *= 2;
+        } else {
+            for (i = 0; i < n; i++)
+                r->present[cands[pos+i]] = true;
+            reduce_split(r, cands + pos, n);
+            batch = max(batch / 2, 1);
+        }
+        pos += n;
+    }
+}
+
+/* ----------------------------------------------------------------------
+ * Speculative checks on several threads.
+ */
+
+struct reduce_job {
+    struct reducer *r;
+    bool *present;                     /* this job's own copy */
+    int clue;
+    bool result;
+};
+
+static void *reduce_worker(void *vjob)
+{
+    struct reduce_job *job = (struct reduce_job *)vjob;
+
+    memcpy(job->present, job->r->present, job->r->nclues * sizeof(bool));
+    job->present[job->clue] = false;
+    job->result = job->r->check(job->r->ctx, job->present);
+    return NULL;
+}
+
+static void reduce_threaded(struct reducer *r, const int *cands, int ncands,
+                            int nthreads)
+{
+    struct reduce_job *jobs = snewn(nthreads, struct reduce_job);
+    pthread_t *threads = snewn(nthreads, pthread_t);
+    bool *started = snewn(nthreads, bool);
+    int pos = 0, i, n;
+
+    for (i = 0; i < nthreads; i++) {
+        jobs[i].r = r;
+        jobs[i].present = snewn(r->nclues, bool);
+    }
+
+    while (pos < ncands) {
+        n = min(nthreads, ncands - pos);
+        for (i = 0; i < n; i++)
+            jobs[i].clue = cands[pos+i];
+
+        /* The first job runs here; if a thread won't start, so does
+         * its job. */
+        for (i = 1; i < n; i++)
+            started[i] = !pthread_create(&threads[i], NULL,
+                                         reduce_worker, &jobs[i]);
+        reduce_worker(&jobs[0]);
+        for (i = 1; i < n; i++) {
+            if (started[i])
+                pthread_join(threads[i], NULL);
+            else
+                reduce_worker(&jobs[i]);
+        }
+
+        for (i = 0; i < n; i++)
+            if (jobs[i].result)
+                break;
+        if (i < n) {
+            r->present[jobs[i].clue] = false;
+            i++;
+        }
+        pos += i;
+    }
+
+    for (i = 0; i < nthreads; i++)
+        sfree(jobs[i].present);
+    sfree(started);
+    sfree(threads);
+    sfree(jobs);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void reduce_clues(const int *order, int nclues, bool *present,
+                  reduce_check_fn check, void *ctx, int flags, int nthreads)
+{
+    struct reducer r;
+    int *cands = snewn(nclues, int);
+    int i, ncands = 0;
+
+    r.check = check;
+    r.ctx = ctx;
+    r.present = present;
+    r.nclues = nclues;
+
+    /* Clues that are already absent can't be removed again */
+    for (i = 0; i < nclues; i++)
+        if (present[order[i]])
+            cands[ncands++] = order[i];
+
+    if (nthreads <= 0) {
+        long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = ncpus > 0 ? (int)ncpus : 1;
+    }
+
+    if (flags & REDUCE_MONOTONE) {
+        reduce_batched(&r, cands, ncands);
+    } else if (nthreads > 1) {
+        reduce_threaded(&r, cands, ncands, nthreads);
+    } else {
+        for (i = 0; i < ncands; i++) {
+            present[cands[i]] = false;
+            if (!check(ctx, present))
+                present[cands[i]] = true;
+        }
+    }
+
+    sfree(cands);
+}
@@ -34,30 +34,111 @@
 
 #include "puzzles.h"                       /* for smalloc/sfree */
 
+/*
+ * Nodes are carved out of slabs belonging to a pool, so that
+ * creating a tree and filling it up costs a handful of mallocs
+ * rather than one per node, and freeing the whole tree just hands
+ * the slabs back. Nodes freed individually go on a free list
+ * (threaded through their parent pointers) for reuse.
+ *
+ * A tree normally has a pool to itself. split234 and splitpos234
+ * leave the two halves sharing one, since each half contains nodes
+ * from the original; the pool counts its users and only gives up
+ * its slabs when the last of them is freed.
+ */
+#define NODE234_FIRST_SLAB 8
+#define NODE234_MAX_SLAB 512
+
+struct node234_slab {
+    struct node234_slab *next;
+    node234 nodes[];
+};
+
+struct node234_pool {
+    int refcount;
+    struct node234_slab *slabs;
+    node234 *freelist;
+    int nfresh, slabsize;           /* untouched nodes left in slabs */
+};
+
+static struct node234_pool *newpool234(void) {
+    struct node234_pool *pool = snew(struct node234_pool);
+    pool->refcount = 1;
+    pool->slabs = NULL;
+    pool->freelist = NULL;
+    pool->nfresh = 0;
+    pool->slabsize = NODE234_FIRST_SLAB / 2;
+    return pool;
+}
+
+static void freepool234(struct node234_pool *pool) {
+    struct node234_slab *slab, *next;
+    for (slab = pool->slabs; slab; slab = next) {
+        next = slab->next;
+        sfree(slab);
+    }
+    sfree(pool);
+}
+
+static node234 *newnode234(struct node234_pool *pool) {
+    node234 *n;
+
+    if (pool->freelist) {
+        n = pool->freelist;
+        pool->freelist = n->parent;
+        return n;
+    }
+    if (!pool->nfresh) {
+        struct node234_slab *slab;
+        if (pool->slabsize < NODE234_MAX_SLAB)
+            pool->slabsize *= 2;
+        slab = smalloc(sizeof(struct node234_slab) +
+                       pool->slabsize * sizeof(node234));
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->nfresh = pool->slabsize;
+    }
+    return &pool->slabs->nodes[pool->slabsize - pool->nfresh--];
+}
+
+static void freenode234(struct node234_pool *pool, node234 *n) {
+    n->parent = pool->freelist;
+    pool->freelist = n;
+}
+
 /*
  * Create a 2-3-4 tree.
  */
-tree234 *newtree234(cmpfn234 cmp) {
+static tree234 *newtree234_pool(cmpfn234 cmp, struct node234_pool *pool) {
     tree234 *ret = snew(tree234);
     ret->root = NULL;
     ret->cmp = cmp;
+    ret->pool = pool;
     return ret;
 }
+tree234 *newtree234(cmpfn234 cmp) {
+    return newtree234_pool(cmp, newpool234());
+}
 
 /*
- * Free a 2-3-4 tree (not including freeing the elements).
+ * Free a 2-3-4 tree (not including freeing the elements). If the
+ * tree has its pool to itself this doesn't need to look at the
+ * nodes at all.
  */
-static void freenode234(node234 *n) {
+static void freesubtree234(struct node234_pool *pool, node234 *n) {
     if (!n)
         return;
-    freenode234(n->kids[0]);
-    freenode234(n->kids[1]);
-    freenode234(n->kids[2]);
-    freenode234(n->kids[3]);
-    sfree(n);
+    freesubtree234(pool, n->kids[0]);
+    freesubtree234(pool, n->kids[1]);
+    freesubtree234(pool, n->kids[2]);
+    freesubtree234(pool, n->kids[3]);
+    freenode234(pool, n);
 }
 void freetree234(tree234 *t) {
-    freenode234(t->root);
+    if (--t->pool->refcount == 0)
+        freepool234(t->pool);
+    else
+        freesubtree234(t->pool, t->root);
     sfree(t);
 }
 
@@ -91,7 +172,8 @@ int count234(tree234 *t) {
  * Propagate a node overflow up a tree until it stops. Returns 0 or
  * 1, depending on whether the root had to be split or not.
  */
-static int add234_insert(node234 *left, void *e, node234 *right,
+static int add234_insert(struct node234_pool *pool,
+                         node234 *left, void *e, node234 *right,
                          node234 **root, node234 *n, int ki) {
     int lcount, rcount;
     /*
@@ -149,7 +231,7 @@ static int add234_insert(node234 *left, void *e, node234 *right,
             if (n->kids[3]) n->kids[3]->parent = n;
             break;
         } else {
-            node234 *m = snew(node234);
+            node234 *m = newnode234(pool);
             m->parent = n->parent;
             /*
              * Insert in a 4-node; split into a 2-node and a
@@ -236,7 +318,7 @@ static int add234_insert(node234 *left, void *e, node234 *right,
         }
         return 0;                       /* root unchanged */
     } else {
-        (*root) = snew(node234);
+        (*root) = newnode234(pool);
         (*root)->kids[0] = left;     (*root)->counts[0] = lcount;
         (*root)->elems[0] = e;
         (*root)->kids[1] = right;    (*root)->counts[1] = rcount;
@@ -262,7 +344,7 @@ static void *add234_internal(tree234 *t, void *e, int index) {
     int c;
 
     if (t->root == NULL) {
-        t->root = snew(node234);
+        t->root = newnode234(t->pool);
         t->root->elems[1] = t->root->elems[2] = NULL;
         t->root->kids[0] = t->root->kids[1] = NULL;
         t->root->kids[2] = t->root->kids[3] = NULL;
@@ -322,7 +404,7 @@ static void *add234_internal(tree234 *t, void *e, int index) {
         n = n->kids[ki];
     } while (n);
 
-    add234_insert(NULL, e, NULL, &t->root, n, ki);
+    add234_insert(t->pool, NULL, e, NULL, &t->root, n, ki);
 
     return orig_e;
 }
@@ -638,7 +720,8 @@ static void trans234_subtree_left(node234 *n, int ki, int *k, int *index) {
  *   /     \       ->        |
  *  a   b B c C d      a A b B c C d
  */
-static void trans234_subtree_merge(node234 *n, int ki, int *k, int *index) {
+static void trans234_subtree_merge(struct node234_pool *pool,
+                                   node234 *n, int ki, int *k, int *index) {
     node234 *left, *right;
     int i, leftlen, rightlen, lsize, rsize;
 
@@ -662,7 +745,7 @@ static void trans234_subtree_merge(node234 *n, int ki, int *k, int *index) {
 
     n->counts[ki] += rightlen + 1;
 
-    sfree(right);
+    freenode234(pool, right);
 
     /*
      * Move the rest of n up by one.
@@ -759,7 +842,8 @@ static void *delpos234_internal(tree234 *t, int index) {
                  * ki is small with only small neighbours. Pick a
                  * neighbour and merge with it.
                  */
-                trans234_subtree_merge(n, ki>0 ? ki-1 : ki, &ki, &index);
+                trans234_subtree_merge(t->pool, n, ki>0 ? ki-1 : ki,
+                                       &ki, &index);
                 sub = n->kids[ki];
 
                 if (!n->elems[0]) {
@@ -769,7 +853,7 @@ static void *delpos234_internal(tree234 *t, int index) {
                      */
                     t->root = sub;
                     sub->parent = NULL;
-                    sfree(n);
+                    freenode234(t->pool, n);
                     n = NULL;
                 }
             }
@@ -800,7 +884,7 @@ static void *delpos234_internal(tree234 *t, int index) {
      */
     if (!n->elems[0]) {
         assert(n == t->root);
-        sfree(n);
+        freenode234(t->pool, n);
         t->root = NULL;
     }
 
@@ -832,7 +916,8 @@ void *del234(tree234 *t, void *e) {
  * resulting tree is the same height as the original larger one, or
  * one higher.
  */
-static node234 *join234_internal(node234 *left, void *sep,
+static node234 *join234_internal(struct node234_pool *pool,
+                                 node234 *left, void *sep,
                                  node234 *right, int *height) {
     node234 *root, *node;
     int relht = *height;
@@ -845,7 +930,7 @@ static node234 *join234_internal(node234 *left, void *sep,
          * nodes.
          */
         node234 *newroot;
-        newroot = snew(node234);
+        newroot = newnode234(pool);
         newroot->kids[0] = left;     newroot->counts[0] = countnode234(left);
         newroot->elems[0] = sep;
         newroot->kids[1] = right;    newroot->counts[1] = countnode234(right);
@@ -904,7 +989,7 @@ static node234 *join234_internal(node234 *left, void *sep,
     /*
      * Now proceed as for addition.
      */
-    *height = add234_insert(left, sep, right, &root, node, ki);
+    *height = add234_insert(pool, left, sep, right, &root, node, ki);
 
     return root;
 }
@@ -917,6 +1002,27 @@ int height234(tree234 *t) {
     }
     return level;
 }
+
+/*
+ * Joining trees that don't share a pool means one tree's nodes have
+ * to be moved into the other's pool first, so that each pool still
+ * owns every node in the trees using it. This makes the join linear
+ * in the size of the tree being moved, but trees being rejoined
+ * after a split do share a pool, and don't pay for it.
+ */
+static node234 *copynode234(struct node234_pool *pool, node234 *n,
+                            copyfn234 copyfn, void *copyfnstate);
+static void movetree234(struct node234_pool *pool, tree234 *t) {
+    node234 *n;
+
+    if (t->pool == pool || !t->root)
+        return;
+    n = copynode234(pool, t->root, NULL, NULL);
+    n->parent = NULL;
+    freesubtree234(t->pool, t->root);
+    t->root = n;
+}
+
 tree234 *join234(tree234 *t1, tree234 *t2) {
     int size2 = countnode234(t2->root);
     if (size2 > 0) {
@@ -931,8 +1037,10 @@ tree234 *join234(tree234 *t1, tree234 *t2) {
         }
 
         element = delpos234(t2, 0);
+        movetree234(t1->pool, t2);
         relht = height234(t1) - height234(t2);
-        t1->root = join234_internal(t1->root, element, t2->root, &relht);
+        t1->root = join234_internal(t1->pool, t1->root, element, t2->root,
+                                    &relht);
         t2->root = NULL;
     }
     return t1;
@@ -951,8 +1059,10 @@ tree234 *join234r(tree234 *t1, tree234 *t2) {
         }
 
         element = delpos234(t1, size1-1);
+        movetree234(t2->pool, t1);
         relht = height234(t1) - height234(t2);
-        t2->root = join234_internal(t1->root, element, t2->root, &relht);
+        t2->root = join234_internal(t2->pool, t1->root, element, t2->root,
+                                    &relht);
         t1->root = NULL;
     }
     return t2;
@@ -1010,7 +1120,7 @@ static node234 *split234_internal(tree234 *t, int index) {
          * new node pointers in halves[0] and halves[1], and go up
          * a level.
          */
-        sib = snew(node234);
+        sib = newnode234(t->pool);
         for (i = 0; i < 3; i++) {
             if (i+ki < 3 && n->elems[i+ki]) {
                 sib->elems[i] = n->elems[i+ki];
@@ -1069,7 +1179,7 @@ static node234 *split234_internal(tree234 *t, int index) {
          */
         while (halves[half] && !halves[half]->elems[0]) {
             halves[half] = halves[half]->kids[0];
-            sfree(halves[half]->parent);
+            freenode234(t->pool, halves[half]->parent);
             halves[half]->parent = NULL;
         }
 
@@ -1114,7 +1224,7 @@ static node234 *split234_internal(tree234 *t, int index) {
                      * Neighbour is small, or possibly neighbour is
                      * medium and we are undersize.
                      */
-                    trans234_subtree_merge(n, merge, NULL, NULL);
+                    trans234_subtree_merge(t->pool, n, merge, NULL, NULL);
                     sub = n->kids[merge];
                     if (!n->elems[0]) {
                         /*
@@ -1124,7 +1234,7 @@ static node234 *split234_internal(tree234 *t, int index) {
                         assert(!n->parent);
                         halves[half] = sub;
                         halves[half]->parent = NULL;
-                        sfree(n);
+                        freenode234(t->pool, n);
                     }
                 } else {
                     /* Neighbour is big enough to move trees over. */
@@ -1148,7 +1258,8 @@ tree234 *splitpos234(tree234 *t, int index, bool before) {
     count = countnode234(t->root);
     if (index < 0 || index > count)
         return NULL;                       /* error */
-    ret = newtree234(t->cmp);
+    ret = newtree234_pool(t->cmp, t->pool);
+    t->pool->refcount++;
     n = split234_internal(t, index);
     if (before) {
         /* We want to return the ones before the index. */
@@ -1181,9 +1292,10 @@ tree234 *split234(tree234 *t, void *e, cmpfn234 cmp, int rel) {
     return splitpos234(t, index+1, before);
 }
 
-static node234 *copynode234(node234 *n, copyfn234 copyfn, void *copyfnstate) {
+static node234 *copynode234(struct node234_pool *pool, node234 *n,
+                            copyfn234 copyfn, void *copyfnstate) {
     int i;
-    node234 *n2 = snew(node234);
+    node234 *n2 = newnode234(pool);
 
     for (i = 0; i < 3; i++) {
         if (n->elems[i] && copyfn)
@@ -1194,7 +1306,8 @@ static node234 *copynode234(node234 *n, copyfn234 copyfn, void *copyfnstate) {
 
     for (i = 0; i < 4; i++) {
         if (n->kids[i]) {
-            n2->kids[i] = copynode234(n->kids[i], copyfn, copyfnstate);
+            n2->kids[i] = copynode234(pool, n->kids[i],
+                                      copyfn, copyfnstate);
             n2->kids[i]->parent = n2;
         } else {
             n2->kids[i] = NULL;
@@ -1209,10 +1322,72 @@ tree234 *copytree234(tree234 *t, copyfn234 copyfn, void *copyfnstate) {
 
     t2 = newtree234(t->cmp);
     if (t->root) {
-        t2->root = copynode234(t->root, copyfn, copyfnstate);
+        t2->root = copynode234(t2->pool, t->root, copyfn, copyfnstate);
         t2->root->parent = NULL;
     } else
         t2->root = NULL;
 
     return t2;
 }
+
+/*
+ * Build a subtree of exactly the given height out of the n elements
+ * starting at elems. All leaves of a 2-3-4 tree are at the same
+ * depth, so each child of a node of height h must be given between
+ * 2^(h-1)-1 and 4^(h-1)-1 elements. Taking as few children as will
+ * hold everything and sharing the elements out evenly between them
+ * keeps every child within those limits, provided n itself is within
+ * the limits for height h.
+ */
+static node234 *buildnode234(struct node234_pool *pool, void **elems,
+                             int n, int height) {
+    node234 *node = newnode234(pool);
+    int i, k, each, extra, max;
+
+    node->parent = NULL;
+    for (i = 0; i < 4; i++) {
+        node->kids[i] = NULL;
+        node->counts[i] = 0;
+    }
+    for (i = 0; i < 3; i++)
+        node->elems[i] = NULL;
+
+    if (height == 1) {
+        assert(n >= 1 && n <= 3);
+        for (i = 0; i < n; i++)
+            node->elems[i] = elems[i];
+        return node;
+    }
+
+    for (max = 0, i = 1; i < height; i++)
+        max = max * 4 + 3;             /* largest subtree below us */
+    for (k = 2; k < 4 && n - (k-1) > k * max; k++)
+        continue;
+    each = (n - (k-1)) / k;
+    extra = (n - (k-1)) % k;
+
+    for (i = 0; i < k; i++) {
+        int size = each + (i < extra ? 1 : 0);
+        node->kids[i] = buildnode234(pool, elems, size, height-1);
+        node->kids[i]->parent = node;
+        node->counts[i] = size;
+        elems += size;
+        if (i < k-1)
+            node->elems[i] = *elems++;
+    }
+
+    return node;
+}
+tree234 *buildtree234_sorted(cmpfn234 cmp, void **elems, int n) {
+    tree234 *t = newtree234(cmp);
+    int height, max;
+
+    if (n > 0) {
+        /* Use the lowest tree that will hold everything */
+        for (height = 1, max = 3; max < n; height++)
+            max = max * 4 + 3;
+        t->root = buildnode234(t->pool, elems, n, height);
+    }
+
+    return t;
+}